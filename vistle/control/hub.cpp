@@ -8,6 +8,8 @@
 #include <cstdlib>
 #include <sstream>
 #include <cassert>
+#include <set>
+#include <vector>
 
 #include <vistle/util/hostname.h>
 #include <vistle/util/directory.h>
@@ -1720,6 +1722,39 @@ bool Hub::processScript() {
 #endif
 }
 
+bool Hub::prioritizeVisible() const {
+
+   auto param = std::dynamic_pointer_cast<IntParameter>(m_stateTracker.getParameter(Id::Vistle, "prioritize_visible"));
+   return param && param->getValue();
+}
+
+void Hub::cancelRunning(int id) {
+
+   // results of the running execution are superseded, also for all modules processing them
+   std::set<int> visited;
+   std::vector<int> pending{id};
+   while (!pending.empty()) {
+      int mod = pending.back();
+      pending.pop_back();
+      if (!visited.insert(mod).second)
+         continue;
+
+      for (auto &output: m_stateTracker.portTracker()->getOutputPorts(mod)) {
+         for (auto &conn: output->connections())
+            pending.push_back(conn->getModuleID());
+      }
+
+      auto it = m_stateTracker.runningMap.find(mod);
+      if (it == m_stateTracker.runningMap.end() || !it->second.busy)
+         continue;
+
+      CERR << "canceling execution of " << mod << " in favor of new request" << std::endl;
+      auto cancel = make.message<message::CancelExecute>(mod);
+      cancel.setDestId(mod);
+      sendManager(cancel, it->second.hub);
+   }
+}
+
 bool Hub::handlePriv(const message::Execute &exec) {
 
    auto toSend = make.message<message::Execute>(exec);
@@ -1728,8 +1763,20 @@ bool Hub::handlePriv(const message::Execute &exec) {
    if (exec.getExecutionCount() < 0)
       toSend.setExecutionCount(++m_execCount);
 
+   const bool prioritize = exec.what() == message::Execute::ComputeExecute && prioritizeVisible();
+   if (exec.hasAnimationTime()) {
+      m_animationTime = exec.animationRealTime();
+      m_animationStepDuration = exec.animationStepDuration();
+   } else if (prioritize) {
+      // requests from UIs do not know what is shown: start with the timestep shown most recently
+      toSend.setAnimationRealTime(m_animationTime);
+      toSend.setAnimationStepDuration(m_animationStepDuration);
+   }
+
    if (Id::isModule(exec.getModule())) {
       const int hub = m_stateTracker.getHub(exec.getModule());
+      if (prioritize)
+         cancelRunning(exec.getModule());
       toSend.setDestId(exec.getModule());
       sendManager(toSend, hub);
    } else {
@@ -1746,6 +1793,8 @@ bool Hub::handlePriv(const message::Execute &exec) {
                isSource = false;
          }
          if (isSource) {
+            if (prioritize)
+               cancelRunning(id);
             toSend.setModule(id);
             toSend.setDestId(id);
             sendManager(toSend, hub);
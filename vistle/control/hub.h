@@ -132,6 +132,11 @@ private:
    message::Type m_traceMessages;
 
    int m_execCount;
+   double m_animationTime = 0., m_animationStepDuration = 0.; //!< what renderers showed when execution was last requested
+   //! whether executions should start with visible timesteps and supersede running executions
+   bool prioritizeVisible() const;
+   //! cancel execution of module and of modules downstream of it if they are still running
+   void cancelRunning(int id);
 
    bool m_barrierActive;
    unsigned m_barrierReached;
@@ -0,0 +1,261 @@
+#include "accelcache.h"
+#include "celltreenode.h"
+
+#include <vistle/util/filesystem.h>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <cstdlib>
+
+namespace vistle {
+
+namespace {
+
+enum Kind {
+   KindCelltree = 1,
+   KindVertexOwnerList = 2,
+};
+
+//! file header, arrays follow at 8 byte aligned offsets
+struct Header {
+   char magic[8];
+   uint32_t kind;
+   uint32_t indexSize;
+   uint32_t scalarSize;
+   uint32_t nodeSize;
+   uint64_t key;
+   uint64_t size[2]; //< number of entries in the two arrays following the header
+   double bounds[6];
+};
+
+const char Magic[8] = "VISACC1";
+
+size_t padded(size_t size) {
+   return (size+7)/8*8;
+}
+
+Header makeHeader(Kind kind, uint64_t key, uint64_t size0, uint64_t size1) {
+   Header h;
+   memset(&h, 0, sizeof(h));
+   memcpy(h.magic, Magic, sizeof(h.magic));
+   h.kind = kind;
+   h.indexSize = sizeof(Index);
+   h.scalarSize = sizeof(Scalar);
+   h.nodeSize = sizeof(AccelerationCache::Celltree::Node);
+   h.key = key;
+   h.size[0] = size0;
+   h.size[1] = size1;
+   return h;
+}
+
+bool writeFile(const std::string &path, const Header &header, const void *data0, size_t bytes0, const void *data1, size_t bytes1) {
+
+   // write to a temporary file and rename, so that concurrent readers never see partial files
+   filesystem::path tmp = filesystem::path(path).parent_path() / filesystem::unique_path("%%%%-%%%%-%%%%-%%%%.tmp");
+   {
+      std::ofstream out(tmp.string(), std::ios::binary);
+      if (!out)
+         return false;
+      const char zero[8] = {};
+      out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+      out.write(static_cast<const char *>(data0), bytes0);
+      out.write(zero, padded(bytes0)-bytes0);
+      out.write(static_cast<const char *>(data1), bytes1);
+      out.write(zero, padded(bytes1)-bytes1);
+      if (!out) {
+         out.close();
+         boost::system::error_code ec;
+         filesystem::remove(tmp, ec);
+         return false;
+      }
+   }
+
+   boost::system::error_code ec;
+   filesystem::rename(tmp, path, ec);
+   if (ec) {
+      filesystem::remove(tmp, ec);
+      return false;
+   }
+   return true;
+}
+
+//! map file and validate header
+bool mapFile(const std::string &path, Kind kind, uint64_t key, boost::interprocess::mapped_region &region, const Header *&header) {
+
+   namespace bi = boost::interprocess;
+
+   boost::system::error_code ec;
+   if (!filesystem::exists(path, ec))
+      return false;
+
+   try {
+      bi::file_mapping file(path.c_str(), bi::read_only);
+      bi::mapped_region r(file, bi::read_only);
+      region.swap(r);
+   } catch (bi::interprocess_exception &ex) {
+      std::cerr << "AccelerationCache: failed to map " << path << ": " << ex.what() << std::endl;
+      return false;
+   }
+
+   if (region.get_size() < sizeof(Header))
+      return false;
+   header = static_cast<const Header *>(region.get_address());
+   const Header expected = makeHeader(kind, key, 0, 0);
+   if (memcmp(header->magic, expected.magic, sizeof(expected.magic)) != 0
+         || header->kind != expected.kind
+         || header->indexSize != expected.indexSize
+         || header->scalarSize != expected.scalarSize
+         || header->nodeSize != expected.nodeSize
+         || header->key != key) {
+      std::cerr << "AccelerationCache: ignoring incompatible file " << path << std::endl;
+      return false;
+   }
+
+   return true;
+}
+
+} // anonymous namespace
+
+AccelerationCache &AccelerationCache::the() {
+
+   static AccelerationCache cache;
+   return cache;
+}
+
+AccelerationCache::AccelerationCache() {
+
+   if (const char *dir = getenv("VISTLE_ACCEL_CACHE")) {
+      setDirectory(dir);
+   }
+}
+
+bool AccelerationCache::enabled() const {
+
+   return !m_directory.empty();
+}
+
+const std::string &AccelerationCache::directory() const {
+
+   return m_directory;
+}
+
+void AccelerationCache::setDirectory(const std::string &dir) {
+
+   std::lock_guard<std::mutex> guard(m_mutex);
+   m_directory.clear();
+   if (dir.empty())
+      return;
+
+   boost::system::error_code ec;
+   filesystem::create_directories(dir, ec);
+   if (!filesystem::is_directory(dir, ec)) {
+      std::cerr << "AccelerationCache: cannot use " << dir << " as cache directory, disabled" << std::endl;
+      return;
+   }
+   m_directory = dir;
+}
+
+std::string AccelerationCache::path(const std::string &kind, uint64_t key) const {
+
+   std::stringstream str;
+   str << kind << "-" << std::hex << std::setw(16) << std::setfill('0') << key << ".vac";
+   return (filesystem::path(m_directory) / str.str()).string();
+}
+
+AccelerationCache::Celltree::ptr AccelerationCache::loadCelltree(uint64_t key) const {
+
+   if (!enabled())
+      return Celltree::ptr();
+
+   boost::interprocess::mapped_region region;
+   const Header *header = nullptr;
+   if (!mapFile(path("celltree3", key), KindCelltree, key, region, header))
+      return Celltree::ptr();
+
+   const size_t numNodes = header->size[0], numCells = header->size[1];
+   const size_t nodeBytes = numNodes*sizeof(Celltree::Node), cellBytes = numCells*sizeof(Index);
+   if (numNodes == 0 || region.get_size() < sizeof(Header)+padded(nodeBytes)+cellBytes)
+      return Celltree::ptr();
+
+   const char *base = static_cast<const char *>(region.get_address());
+   const Celltree::Node *nodes = reinterpret_cast<const Celltree::Node *>(base+sizeof(Header));
+   const Index *cells = reinterpret_cast<const Index *>(base+sizeof(Header)+padded(nodeBytes));
+
+   Celltree::ptr ct(new Celltree(Index(0)));
+   for (int d=0; d<3; ++d) {
+      ct->min()[d] = Scalar(header->bounds[d]);
+      ct->max()[d] = Scalar(header->bounds[3+d]);
+   }
+   ct->nodes().resize(numNodes);
+   memcpy(ct->nodes().data(), nodes, nodeBytes);
+   ct->cells().resize(numCells);
+   memcpy(ct->cells().data(), cells, cellBytes);
+
+   return ct;
+}
+
+bool AccelerationCache::storeCelltree(uint64_t key, Celltree::const_ptr ct) const {
+
+   if (!enabled() || !ct)
+      return false;
+
+   const auto &nodes = ct->nodes();
+   const auto &cells = ct->cells();
+   Header header = makeHeader(KindCelltree, key, nodes.size(), cells.size());
+   for (int d=0; d<3; ++d) {
+      header.bounds[d] = ct->min()[d];
+      header.bounds[3+d] = ct->max()[d];
+   }
+   return writeFile(path("celltree3", key), header,
+                    nodes.data(), nodes.size()*sizeof(Celltree::Node),
+                    cells.data(), cells.size()*sizeof(Index));
+}
+
+VertexOwnerList::ptr AccelerationCache::loadVertexOwnerList(uint64_t key) const {
+
+   if (!enabled())
+      return VertexOwnerList::ptr();
+
+   boost::interprocess::mapped_region region;
+   const Header *header = nullptr;
+   if (!mapFile(path("vertexownerlist", key), KindVertexOwnerList, key, region, header))
+      return VertexOwnerList::ptr();
+
+   const size_t numVertexList = header->size[0], numCellList = header->size[1];
+   const size_t vertexBytes = numVertexList*sizeof(Index), cellBytes = numCellList*sizeof(Index);
+   if (numVertexList == 0 || region.get_size() < sizeof(Header)+padded(vertexBytes)+cellBytes)
+      return VertexOwnerList::ptr();
+
+   const char *base = static_cast<const char *>(region.get_address());
+   const Index *vertexList = reinterpret_cast<const Index *>(base+sizeof(Header));
+   const Index *cellList = reinterpret_cast<const Index *>(base+sizeof(Header)+padded(vertexBytes));
+
+   VertexOwnerList::ptr vol(new VertexOwnerList(numVertexList-1));
+   memcpy(vol->vertexList().data(), vertexList, vertexBytes);
+   vol->cellList().resize(numCellList);
+   memcpy(vol->cellList().data(), cellList, cellBytes);
+   vol->refresh();
+
+   return vol;
+}
+
+bool AccelerationCache::storeVertexOwnerList(uint64_t key, VertexOwnerList::const_ptr vol) const {
+
+   if (!enabled() || !vol)
+      return false;
+
+   const Index numVertexList = vol->getNumVertices()+1;
+   const Index numCellList = vol->vertexList()[numVertexList-1];
+   Header header = makeHeader(KindVertexOwnerList, key, numVertexList, numCellList);
+   return writeFile(path("vertexownerlist", key), header,
+                    vol->vertexList(), numVertexList*sizeof(Index),
+                    vol->cellList(), numCellList*sizeof(Index));
+}
+
+} // namespace vistle
@@ -0,0 +1,48 @@
+#ifndef VISTLE_ACCELCACHE_H
+#define VISTLE_ACCELCACHE_H
+
+#include "export.h"
+#include "index.h"
+#include "celltree.h"
+#include "vertexownerlist.h"
+
+#include <string>
+#include <mutex>
+#include <cstdint>
+
+namespace vistle {
+
+//! persistent on-disk cache for acceleration structures derived from grids
+/*!
+ * Derived structures are stored in files named by a hash of the grid content they were computed from,
+ * so that they survive re-executions and session restarts as long as the grid does not change.
+ * The cache is enabled by setting the environment variable VISTLE_ACCEL_CACHE to a local directory.
+ */
+class V_COREEXPORT AccelerationCache {
+
+ public:
+   typedef CelltreeInterface<3>::Celltree Celltree;
+
+   static AccelerationCache &the();
+
+   bool enabled() const;
+   const std::string &directory() const;
+   //! set cache directory, empty: disable cache
+   void setDirectory(const std::string &dir);
+
+   Celltree::ptr loadCelltree(uint64_t key) const;
+   bool storeCelltree(uint64_t key, Celltree::const_ptr ct) const;
+
+   VertexOwnerList::ptr loadVertexOwnerList(uint64_t key) const;
+   bool storeVertexOwnerList(uint64_t key, VertexOwnerList::const_ptr vol) const;
+
+ private:
+   AccelerationCache();
+   std::string path(const std::string &kind, uint64_t key) const;
+
+   mutable std::mutex m_mutex;
+   std::string m_directory;
+};
+
+} // namespace vistle
+#endif
@@ -0,0 +1,91 @@
+#include "attributekeys.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace vistle {
+
+AttributeKeys::Table::Table(const Shm::void_allocator &alloc)
+: names(alloc)
+{
+}
+
+AttributeKeys &AttributeKeys::the() {
+
+   static AttributeKeys keys;
+   return keys;
+}
+
+void AttributeKeys::attach(Table *table) {
+
+   auto &k = the();
+   std::lock_guard<std::mutex> guard(k.m_mutex);
+   k.m_table = table;
+   k.m_synced = 0;
+   k.m_ids.clear();
+   k.m_names.clear();
+}
+
+void AttributeKeys::sync() {
+
+   assert(m_table);
+   const auto &names = m_table->names;
+   while (m_synced < names.size()) {
+      const char *name = &names[m_synced];
+      const size_t len = strlen(name);
+      add(std::string(name, len));
+      m_synced += len+1;
+   }
+}
+
+uint32_t AttributeKeys::add(const std::string &key) {
+
+   uint32_t id = m_names.size();
+   m_names.push_back(key);
+   m_ids.emplace(key, id);
+   return id;
+}
+
+uint32_t AttributeKeys::id(const std::string &key, bool create) {
+
+   auto &k = the();
+   std::lock_guard<std::mutex> guard(k.m_mutex);
+   auto it = k.m_ids.find(key);
+   if (it != k.m_ids.end())
+      return it->second;
+
+   if (!k.m_table) {
+      if (!create)
+         return Invalid;
+      return k.add(key);
+   }
+
+   std::unique_lock<decltype(k.m_table->mutex)> lock(k.m_table->mutex);
+   k.sync();
+   it = k.m_ids.find(key);
+   if (it != k.m_ids.end())
+      return it->second;
+   if (!create)
+      return Invalid;
+
+   auto &names = k.m_table->names;
+   names.insert(names.end(), key.c_str(), key.c_str()+key.length()+1);
+   k.sync();
+   assert(k.m_ids.find(key) != k.m_ids.end());
+   return k.m_ids[key];
+}
+
+std::string AttributeKeys::name(uint32_t id) {
+
+   auto &k = the();
+   std::lock_guard<std::mutex> guard(k.m_mutex);
+   if (id >= k.m_names.size() && k.m_table) {
+      std::unique_lock<decltype(k.m_table->mutex)> lock(k.m_table->mutex);
+      k.sync();
+   }
+   if (id >= k.m_names.size())
+      return std::string();
+   return k.m_names[id];
+}
+
+} // namespace vistle
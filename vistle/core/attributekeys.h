@@ -0,0 +1,62 @@
+#ifndef VISTLE_ATTRIBUTEKEYS_H
+#define VISTLE_ATTRIBUTEKEYS_H
+
+#include "export.h"
+#include "shm.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+
+#ifndef NO_SHMEM
+#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#endif
+
+namespace vistle {
+
+//! interned attribute keys
+/*!
+ * Attribute keys are stored only once per shared memory segment in an append-only table,
+ * objects refer to them by their index.
+ * Lookups are served from a process-local copy that is extended whenever an unknown key or id is encountered.
+ */
+class V_COREEXPORT AttributeKeys {
+
+ public:
+   static const uint32_t Invalid = ~uint32_t(0);
+
+   //! key table, resides in shared memory
+   struct Table {
+      Table(const Shm::void_allocator &alloc);
+#ifdef NO_SHMEM
+      std::mutex mutex;
+#else
+      boost::interprocess::interprocess_mutex mutex;
+#endif
+      shm<char>::vector names; //!< NUL-terminated key names, ids are assigned in order of appearance
+   };
+
+   //! make table available to this process, nullptr: use process-local table
+   static void attach(Table *table);
+
+   //! id of key, Invalid if key has not been interned and create is false
+   static uint32_t id(const std::string &key, bool create=true);
+   //! name of key with id, empty if unknown
+   static std::string name(uint32_t id);
+
+ private:
+   static AttributeKeys &the();
+   void sync(); //!< pick up keys added by other processes, requires m_mutex and table mutex
+   uint32_t add(const std::string &key); //!< requires m_mutex
+
+   std::mutex m_mutex;
+   Table *m_table = nullptr;
+   size_t m_synced = 0; //!< no. of bytes of m_table->names already parsed
+   std::unordered_map<std::string, uint32_t> m_ids;
+   std::vector<std::string> m_names;
+};
+
+} // namespace vistle
+#endif
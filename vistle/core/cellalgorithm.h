@@ -6,6 +6,9 @@
 #include "celltree.h"
 #include "grid.h"
 
+#include <vector>
+#include <algorithm>
+
 namespace vistle {
 
 V_COREEXPORT Vector trilinearInverse(const Vector &p0, const Vector p[8]);
@@ -180,6 +183,70 @@ class PointInclusionFunctor: public Celltree<Scalar, Index>::LeafFunctor {
 
 };
 
+template<class Grid, typename Scalar, typename Index>
+class PointsInclusionFunctor {
+
+ public:
+   PointsInclusionFunctor(const Grid *grid, const Vector *points, Index *cells, bool acceptGhost=false)
+      : m_grid(grid)
+      , m_points(points)
+      , m_cells(cells)
+      , m_acceptGhost(acceptGhost)
+   {
+   }
+
+   bool operator()(Index point, Index elem) {
+      if (m_acceptGhost || !m_grid->isGhostCell(elem)) {
+          if (m_grid->inside(elem, m_points[point])) {
+              m_cells[point] = elem;
+              return false; // stop traversal for this point
+          }
+      }
+      return true;
+   }
+   const Grid *m_grid;
+   const Vector *m_points;
+   Index *m_cells;
+   bool m_acceptGhost;
+};
+
+//! locate points with the celltree of grid, only those not inside their hint cell are searched for
+template<class Grid>
+void findCellsWithCelltree(const Grid *grid, const Vector *points, Index numPoints, Index *cells, const Index *hints, bool acceptGhost) {
+
+   std::vector<Index> todo;
+   if (hints) {
+      for (Index i=0; i<numPoints; ++i) {
+         if (hints[i] != InvalidIndex && grid->inside(hints[i], points[i])) {
+            cells[i] = hints[i];
+         } else {
+            cells[i] = InvalidIndex;
+            todo.push_back(i);
+         }
+      }
+   } else {
+      std::fill(cells, cells+numPoints, InvalidIndex);
+   }
+
+   auto ct = grid->getCelltree();
+   if (!hints) {
+      PointsInclusionFunctor<Grid, Scalar, Index> elemFunc(grid, points, cells, acceptGhost);
+      ct->traversePoints(points, numPoints, elemFunc);
+      return;
+   }
+
+   if (todo.empty())
+      return;
+   std::vector<Vector> remaining(todo.size());
+   std::vector<Index> found(todo.size(), InvalidIndex);
+   for (size_t i=0; i<todo.size(); ++i)
+      remaining[i] = points[todo[i]];
+   PointsInclusionFunctor<Grid, Scalar, Index> elemFunc(grid, remaining.data(), found.data(), acceptGhost);
+   ct->traversePoints(remaining.data(), remaining.size(), elemFunc);
+   for (size_t i=0; i<todo.size(); ++i)
+      cells[todo[i]] = found[i];
+}
+
 template<class Grid, typename Scalar, typename Index>
 class LineIntersectionFunctor: public Celltree<Scalar, Index>::LeafFunctor {
 
@@ -3,8 +3,28 @@
 #include "vec.h"
 #include "shm_reference_impl.h"
 
+#include <thread>
+#include <algorithm>
+
 namespace vistle {
 
+std::atomic<unsigned> CelltreeThreads::s_inUse(0);
+
+CelltreeThreads::CelltreeThreads(unsigned wanted) {
+
+   const unsigned limit = std::max(1u, std::thread::hardware_concurrency());
+   unsigned inUse = s_inUse;
+   do {
+      const unsigned avail = inUse < limit ? limit-inUse : 0;
+      m_count = std::max(1u, std::min(wanted, avail));
+   } while (!s_inUse.compare_exchange_weak(inUse, inUse+m_count));
+}
+
+CelltreeThreads::~CelltreeThreads() {
+
+   s_inUse -= m_count;
+}
+
 template class Celltree<Scalar, Index, 1>;
 template class Celltree<Scalar, Index, 2>;
 template class Celltree<Scalar, Index, 3>;
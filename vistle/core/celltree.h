@@ -10,6 +10,11 @@
 #include "geometry.h"
 #include "shmvector.h"
 
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <atomic>
+
 namespace vistle {
 
 // a bounding volume hierarchy, cf. C. Garth and K. I. Joy:
@@ -19,6 +24,26 @@ namespace vistle {
 template<size_t IndexSize, int NumDimensions>
 struct CelltreeNode;
 
+//! reservation of threads for building a celltree
+/*!
+ * Celltrees of several blocks are often built concurrently by a module's tasks,
+ * all builds within a process therefore share hardware_concurrency threads, including the calling ones.
+ */
+class V_COREEXPORT CelltreeThreads {
+ public:
+   //! reserve up to wanted threads, always at least the calling thread
+   explicit CelltreeThreads(unsigned wanted);
+   ~CelltreeThreads();
+   unsigned count() const { return m_count; }
+
+   CelltreeThreads(const CelltreeThreads &) = delete;
+   CelltreeThreads &operator=(const CelltreeThreads &) = delete;
+
+ private:
+   unsigned m_count;
+   static std::atomic<unsigned> s_inUse;
+};
+
 typedef CelltreeNode<sizeof(Index),1> CelltreeNode1;
 typedef CelltreeNode<sizeof(Index),2> CelltreeNode2;
 typedef CelltreeNode<sizeof(Index),3> CelltreeNode3;
@@ -85,7 +110,11 @@ class V_COREEXPORT Celltree: public Object {
    Celltree(const Index numCells,
          const Meta &meta=Meta());
 
-   void init(const Vector *min, const Vector *max, const Vector &gmin, const Vector &gmax);
+   //! build tree from cell bounds with a task-parallel binned builder on up to numThreads threads (0: all hardware threads),
+   //! shared with other builds running concurrently
+   void init(const Vector *min, const Vector *max, const Vector &gmin, const Vector &gmax, unsigned numThreads=0);
+   //! build tree from cell bounds by serial recursive refinement
+   void initSerial(const Vector *min, const Vector *max, const Vector &gmin, const Vector &gmax);
    void refine(const Vector *min, const Vector *max, Index nodeIdx, const Vector &gmin, const Vector &gmax);
    template<class BoundsFunctor>
    bool validateTree(BoundsFunctor &func) const;
@@ -106,6 +135,82 @@ class V_COREEXPORT Celltree: public Object {
       traverseNode(0, nodes().data(), cells().data(), visitNode, visitElement);
    }
 
+   //! number of points located together by traversePoints
+   static const int PacketSize = 16;
+
+   //! locate many points at once: visitElement(point, elem) is called for candidate elements of each point until it returns false
+   /*!
+    * Points are processed in packets of PacketSize with a stack-based traversal, the split plane tests
+    * for all points of a packet are done in one loop amenable to vectorization.
+    */
+   template<class PointElementFunctor>
+   void traversePoints(const Vector *points, Index numPoints, PointElementFunctor &visitElement) const {
+      typedef uint32_t Mask;
+      static_assert(PacketSize <= sizeof(Mask)*8, "mask type too small for packet size");
+
+      const Node *nodes = this->nodes().data();
+      const Index *cells = this->cells().data();
+      const Scalar *gmin = min(), *gmax = max();
+
+      std::vector<std::pair<Index, Mask>> stack;
+      for (Index p0=0; p0<numPoints; p0+=PacketSize) {
+         const int np = int(std::min(Index(PacketSize), numPoints-p0));
+
+         // structure-of-arrays layout for packet, points outside of tree bounds are inactive
+         Scalar coord[NumDimensions][PacketSize];
+         Mask active = 0;
+         for (int l=0; l<PacketSize; ++l) {
+            bool inside = l < np;
+            for (int d=0; d<NumDimensions; ++d) {
+               coord[d][l] = l<np ? points[p0+l][d] : gmin[d];
+               inside = inside && coord[d][l] >= gmin[d] && coord[d][l] <= gmax[d];
+            }
+            if (inside)
+               active |= Mask(1) << l;
+         }
+
+         stack.clear();
+         if (active)
+            stack.emplace_back(0, active);
+         while (!stack.empty() && active) {
+            const Index curNode = stack.back().first;
+            Mask mask = stack.back().second & active;
+            stack.pop_back();
+            if (!mask)
+               continue;
+
+            const Node &node = nodes[curNode];
+            if (node.isLeaf()) {
+               for (Index i = node.start; mask && i < node.start+node.size; ++i) {
+                  const Index cell = cells[i];
+                  for (int l=0; l<np; ++l) {
+                     const Mask bit = Mask(1) << l;
+                     if ((mask & bit) && !visitElement(p0+l, cell)) {
+                        active &= ~bit;
+                        mask &= ~bit;
+                     }
+                  }
+               }
+               continue;
+            }
+
+            const Scalar *c = coord[node.dim];
+            const Scalar Lmax = node.Lmax, Rmin = node.Rmin;
+            Mask left = 0, right = 0;
+            for (int l=0; l<PacketSize; ++l) {
+               left |= Mask(c[l] <= Lmax) << l;
+               right |= Mask(c[l] >= Rmin) << l;
+            }
+            left &= mask;
+            right &= mask;
+            if (right)
+               stack.emplace_back(node.right(), right);
+            if (left)
+               stack.emplace_back(node.left(), left);
+         }
+      }
+   }
+
  private:
    template<class BoundsFunctor>
    bool validateNode(BoundsFunctor &func, Index nodenum, const Vector &min, const Vector &max) const;
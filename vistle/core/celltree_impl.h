@@ -1,6 +1,12 @@
 #ifndef CELLTREE_IMPL_H
 #define CELLTREE_IMPL_H
 
+#include <vector>
+#include <future>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+
 namespace vistle {
 
 //#define CT_DEBUG
@@ -10,6 +16,342 @@ namespace vistle {
 
 const unsigned MaxLeafSize = 8;
 
+//! task-parallel celltree construction
+/*!
+ * Upper levels of the tree are split one node at a time, with binning and partitioning of large
+ * cell ranges distributed across threads. Once enough subtrees have been generated, these are
+ * refined independently by worker threads into thread-local node arrays, which are finally
+ * concatenated into the node layout expected by Celltree::traverse.
+ * Partitioning is stable, so the result does not depend on the number of threads.
+ */
+template<typename Scalar, typename Index, int NumDimensions>
+class CelltreeBuilder {
+ public:
+   typedef Celltree<Scalar, Index, NumDimensions> Tree;
+   typedef typename Tree::Vector Vector;
+   typedef typename Tree::Node Node;
+
+   CelltreeBuilder(const Vector *min, const Vector *max, Index *cells, unsigned numThreads)
+   : m_min(min)
+   , m_max(max)
+   , m_cells(cells)
+   , m_numThreads(std::max(1u, numThreads))
+   {}
+
+   //! build a tree for cells [0,numCells) of the cell array
+   std::vector<Node> build(Index numCells, const Vector &gmin, const Vector &gmax) const;
+
+ private:
+   static const int NumBuckets = 16;
+   static const Index ParallelThreshold = 1<<16; //< distribute binning/partitioning for larger nodes
+
+   struct Bins {
+      Vector cmin, cmax;
+      Index count[NumDimensions][NumBuckets];
+      Vector bmin[NumBuckets], bmax[NumBuckets];
+   };
+
+   struct Split {
+      int dim = -1;
+      Scalar Lmax = 0, Rmin = 0;
+      Index nleft = 0;
+      Vector lmin, lmax, rmin, rmax; //< bounds of left and right sub-volumes
+   };
+
+   struct Subtree {
+      Index node;
+      Vector gmin, gmax;
+   };
+
+   Vector center(Index c) const { return Scalar(0.5)*(m_min[c]+m_max[c]); }
+
+   static int bucket(Scalar center, Scalar cmin, Scalar crange) {
+      return crange == 0 ? 0 : std::min(int((center - cmin)/crange * NumBuckets), NumBuckets-1);
+   }
+
+   //! run func(begin, end, chunk) for numChunks consecutive parts of [begin,end)
+   template<class Func>
+   void forChunks(Index begin, Index end, unsigned numChunks, Func func) const {
+      const Index n = end-begin;
+      auto chunkBegin = [begin, n, numChunks](unsigned c) -> Index { return begin + Index(uint64_t(n)*c/numChunks); };
+      std::vector<std::future<void>> tasks;
+      for (unsigned c=1; c<numChunks; ++c) {
+         tasks.emplace_back(std::async(std::launch::async, [&func, chunkBegin, c]() { func(chunkBegin(c), chunkBegin(c+1), c); }));
+      }
+      func(chunkBegin(0), chunkBegin(1), 0);
+      for (auto &t: tasks)
+         t.get();
+   }
+
+   void initBins(Bins &bins) const {
+      const Scalar smax = std::numeric_limits<Scalar>::max();
+      bins.cmin.fill(smax);
+      bins.cmax.fill(-smax);
+      for (int i=0; i<NumBuckets; ++i) {
+         for (int d=0; d<NumDimensions; ++d)
+            bins.count[d][i] = 0;
+         bins.bmin[i].fill(smax);
+         bins.bmax[i].fill(-smax);
+      }
+   }
+
+   void centerBounds(Index begin, Index end, Bins &bins) const {
+      for (Index i=begin; i<end; ++i) {
+         const Vector cent = center(m_cells[i]);
+         for (int d=0; d<NumDimensions; ++d) {
+            bins.cmin[d] = std::min(bins.cmin[d], cent[d]);
+            bins.cmax[d] = std::max(bins.cmax[d], cent[d]);
+         }
+      }
+   }
+
+   void fillBins(Index begin, Index end, const Vector &cmin, const Vector &crange, Bins &bins) const {
+      for (Index i=begin; i<end; ++i) {
+         const Index cell = m_cells[i];
+         const Vector cent = center(cell);
+         for (int d=0; d<NumDimensions; ++d) {
+            const int b = bucket(cent[d], cmin[d], crange[d]);
+            ++bins.count[d][b];
+            bins.bmin[b][d] = std::min(bins.bmin[b][d], m_min[cell][d]);
+            bins.bmax[b][d] = std::max(bins.bmax[b][d], m_max[cell][d]);
+         }
+      }
+   }
+
+   //! find split for cells [start,start+size), partition cells accordingly
+   bool split(Index start, Index size, const Vector &gmin, const Vector &gmax, Split &result, unsigned numChunks) const;
+   //! serially refine subtree rooted at nodes[nodeIdx]
+   void refine(std::vector<Node> &nodes, Index nodeIdx, const Vector &gmin, const Vector &gmax) const;
+
+   const Vector *m_min, *m_max;
+   Index *m_cells;
+   unsigned m_numThreads;
+};
+
+template<typename Scalar, typename Index, int NumDimensions>
+bool CelltreeBuilder<Scalar, Index, NumDimensions>::split(Index start, Index size, const Vector &gmin, const Vector &gmax, Split &result, unsigned numChunks) const {
+
+   const Scalar smax = std::numeric_limits<Scalar>::max();
+   const Index end = start+size;
+
+   // find min/max extents of cell centers and sort cells into buckets for each possible split dimension
+   std::vector<Bins> partial(numChunks);
+   for (auto &b: partial)
+      initBins(b);
+   Bins &bins = partial[0];
+   if (numChunks > 1) {
+      forChunks(start, end, numChunks, [this, &partial](Index b, Index e, unsigned c) { centerBounds(b, e, partial[c]); });
+      for (unsigned c=1; c<numChunks; ++c) {
+         for (int d=0; d<NumDimensions; ++d) {
+            bins.cmin[d] = std::min(bins.cmin[d], partial[c].cmin[d]);
+            bins.cmax[d] = std::max(bins.cmax[d], partial[c].cmax[d]);
+         }
+      }
+   } else {
+      centerBounds(start, end, bins);
+   }
+   const Vector cmin = bins.cmin;
+   const Vector crange = bins.cmax - bins.cmin;
+   if (numChunks > 1) {
+      forChunks(start, end, numChunks, [this, &partial, cmin, crange](Index b, Index e, unsigned c) { fillBins(b, e, cmin, crange, partial[c]); });
+      for (unsigned c=1; c<numChunks; ++c) {
+         for (int i=0; i<NumBuckets; ++i) {
+            for (int d=0; d<NumDimensions; ++d) {
+               bins.count[d][i] += partial[c].count[d][i];
+               bins.bmin[i][d] = std::min(bins.bmin[i][d], partial[c].bmin[i][d]);
+               bins.bmax[i][d] = std::max(bins.bmax[i][d], partial[c].bmax[i][d]);
+            }
+         }
+      }
+   } else {
+      fillBins(start, end, cmin, crange, bins);
+   }
+
+   // adjust bucket bounds for empty buckets
+   for (int d=0; d<NumDimensions; ++d) {
+      for (int b=NumBuckets-2; b>=0; --b) {
+         if (bins.bmin[b][d] > bins.bmin[b+1][d])
+            bins.bmin[b][d] = bins.bmin[b+1][d];
+      }
+      for (int b=1; b<NumBuckets; ++b) {
+         if (bins.bmax[b][d] < bins.bmax[b-1][d])
+            bins.bmax[b][d] = bins.bmax[b-1][d];
+      }
+   }
+
+   // find best split dimension and plane by minimizing the cost of traversing both children
+   Scalar min_weight(smax);
+   int best_dim=-1, best_bucket=-1;
+   for (int d=0; d<NumDimensions; ++d) {
+      if (crange[d] <= 0)
+         continue;
+      Index nleft = 0;
+      for (int split_b=0; split_b<NumBuckets-1; ++split_b) {
+         nleft += bins.count[d][split_b];
+         const Index nright = size - nleft;
+         const Scalar weight = (nleft * (bins.bmax[split_b][d]-bins.bmin[0][d])
+               + nright * (bins.bmax[NumBuckets-1][d]-bins.bmin[split_b+1][d])) / (size * crange[d]);
+         if (nleft>0 && nright>0 && weight < min_weight) {
+            min_weight = weight;
+            best_dim = d;
+            best_bucket = split_b;
+         }
+      }
+   }
+   if (best_dim == -1)
+      return false;
+
+   const int D = best_dim;
+   result.dim = D;
+   result.Lmax = bins.bmax[best_bucket][D];
+   result.Rmin = bins.bmin[best_bucket+1][D];
+   result.lmin = result.rmin = gmin;
+   result.lmax = result.rmax = gmax;
+   result.lmin[D] = bins.bmin[0][D];
+   result.lmax[D] = bins.bmax[best_bucket][D];
+   result.rmin[D] = bins.bmin[best_bucket+1][D];
+   result.rmax[D] = bins.bmax[NumBuckets-1][D];
+
+   // stable partition of cells into left and right subnodes
+   const Scalar cminD = cmin[D], crangeD = crange[D];
+   auto isLeft = [this, D, cminD, crangeD, best_bucket](Index c) -> bool {
+      const Scalar cent = Scalar(0.5)*(m_min[c][D]+m_max[c][D]);
+      return bucket(cent, cminD, crangeD) <= best_bucket;
+   };
+   if (numChunks > 1) {
+      std::vector<Index> numLeft(numChunks+1), numRight(numChunks+1);
+      forChunks(start, end, numChunks, [this, &numLeft, isLeft](Index b, Index e, unsigned c) {
+         Index n = 0;
+         for (Index i=b; i<e; ++i)
+            if (isLeft(m_cells[i]))
+               ++n;
+         numLeft[c+1] = n;
+      });
+      for (unsigned c=0; c<numChunks; ++c)
+         numLeft[c+1] += numLeft[c];
+      result.nleft = numLeft[numChunks];
+      std::vector<Index> sorted(size);
+      forChunks(start, end, numChunks, [this, &numLeft, &sorted, &result, start, isLeft](Index b, Index e, unsigned c) {
+         Index l = numLeft[c], r = result.nleft + (b-start) - numLeft[c];
+         for (Index i=b; i<e; ++i) {
+            const Index cell = m_cells[i];
+            if (isLeft(cell))
+               sorted[l++] = cell;
+            else
+               sorted[r++] = cell;
+         }
+      });
+      forChunks(start, end, numChunks, [this, &sorted, start](Index b, Index e, unsigned) {
+         std::copy(sorted.begin()+(b-start), sorted.begin()+(e-start), m_cells+b);
+      });
+   } else {
+      Index *mid = std::stable_partition(m_cells+start, m_cells+end, isLeft);
+      result.nleft = mid - (m_cells+start);
+   }
+   assert(result.nleft > 0);
+   assert(result.nleft < size);
+
+   return true;
+}
+
+template<typename Scalar, typename Index, int NumDimensions>
+void CelltreeBuilder<Scalar, Index, NumDimensions>::refine(std::vector<Node> &nodes, Index nodeIdx, const Vector &gmin, const Vector &gmax) const {
+
+   const Index start = nodes[nodeIdx].start;
+   const Index size = nodes[nodeIdx].size;
+
+   // only split node if necessary
+   if (size <= MaxLeafSize)
+      return;
+
+   Split s;
+   if (!split(start, size, gmin, gmax, s, 1))
+      return;
+
+   const Index l = nodes.size();
+   nodes[nodeIdx] = Node(s.dim, s.Lmax, s.Rmin, l);
+   nodes.emplace_back(start, s.nleft);
+   nodes.emplace_back(start+s.nleft, size-s.nleft);
+
+   refine(nodes, l, s.lmin, s.lmax);
+   refine(nodes, l+1, s.rmin, s.rmax);
+}
+
+template<typename Scalar, typename Index, int NumDimensions>
+std::vector<typename CelltreeBuilder<Scalar, Index, NumDimensions>::Node> CelltreeBuilder<Scalar, Index, NumDimensions>::build(Index numCells, const Vector &gmin, const Vector &gmax) const {
+
+   std::vector<Node> tree;
+   tree.emplace_back(0, numCells);
+
+   // split upper levels breadth-first until there are enough independent subtrees
+   const Index subtreeSize = std::max(Index(4*MaxLeafSize), numCells/(8*m_numThreads));
+   std::vector<Subtree> queue, subtrees;
+   queue.push_back(Subtree{0, gmin, gmax});
+   for (size_t q=0; q<queue.size(); ++q) {
+      const Subtree st = queue[q];
+      const Index start = tree[st.node].start;
+      const Index size = tree[st.node].size;
+      if (size <= MaxLeafSize)
+         continue;
+      if (m_numThreads <= 1 || size <= subtreeSize) {
+         subtrees.push_back(st);
+         continue;
+      }
+
+      unsigned numChunks = std::min(m_numThreads, unsigned((size+ParallelThreshold-1)/ParallelThreshold));
+      Split s;
+      if (!split(start, size, st.gmin, st.gmax, s, numChunks))
+         continue;
+
+      const Index l = tree.size();
+      tree[st.node] = Node(s.dim, s.Lmax, s.Rmin, l);
+      tree.emplace_back(start, s.nleft);
+      tree.emplace_back(start+s.nleft, size-s.nleft);
+      queue.push_back(Subtree{l, s.lmin, s.lmax});
+      queue.push_back(Subtree{l+1, s.rmin, s.rmax});
+   }
+
+   // refine subtrees in parallel, largest first
+   std::vector<size_t> order(subtrees.size());
+   for (size_t i=0; i<order.size(); ++i)
+      order[i] = i;
+   std::stable_sort(order.begin(), order.end(), [&tree, &subtrees](size_t a, size_t b) {
+      return tree[subtrees[a].node].size > tree[subtrees[b].node].size;
+   });
+   std::vector<std::vector<Node>> local(subtrees.size());
+   std::atomic<size_t> next(0);
+   auto work = [this, &tree, &subtrees, &order, &local, &next]() {
+      for (size_t i = next++; i < order.size(); i = next++) {
+         const Subtree &st = subtrees[order[i]];
+         auto &nodes = local[order[i]];
+         nodes.push_back(tree[st.node]);
+         refine(nodes, 0, st.gmin, st.gmax);
+      }
+   };
+   std::vector<std::future<void>> workers;
+   for (unsigned t=1; t<std::min(size_t(m_numThreads), subtrees.size()); ++t) {
+      workers.emplace_back(std::async(std::launch::async, work));
+   }
+   work();
+   for (auto &w: workers)
+      w.get();
+
+   // append subtrees: local root replaces its placeholder, local node i>0 becomes base+i-1
+   for (size_t i=0; i<subtrees.size(); ++i) {
+      const auto &nodes = local[i];
+      const Index base = tree.size();
+      auto relocate = [base](const Node &n) -> Node {
+         return n.isLeaf() ? n : Node(n.dim, n.Lmax, n.Rmin, base+n.child-1);
+      };
+      tree[subtrees[i].node] = relocate(nodes[0]);
+      for (size_t n=1; n<nodes.size(); ++n)
+         tree.push_back(relocate(nodes[n]));
+   }
+
+   return tree;
+}
+
+
 template<typename Scalar, typename Index, int NumDimensions>
 Object::Type Celltree<Scalar, Index, NumDimensions>::type() {
 
@@ -22,6 +364,28 @@ V_COREEXPORT void Celltree<Scalar, Index, NumDimensions>::refreshImpl() const {
 
 template<typename Scalar, typename Index, int NumDimensions>
 void Celltree<Scalar, Index, NumDimensions>::init(const Vector *min, const Vector *max,
+      const Vector &gmin, const Vector &gmax, unsigned numThreads) {
+
+   assert(nodes().size() == 1);
+   for (int i=0; i<NumDimensions; ++i)
+      this->min()[i] = gmin[i];
+   for (int i=0; i<NumDimensions; ++i)
+      this->max()[i] = gmax[i];
+
+   if (numThreads == 0)
+      numThreads = std::thread::hardware_concurrency();
+   CelltreeThreads threads(numThreads);
+   CelltreeBuilder<Scalar, Index, NumDimensions> builder(min, max, cells().data(), threads.count());
+   std::vector<Node> tree = builder.build(nodes()[0].size, gmin, gmax);
+   nodes().resize(tree.size());
+   std::copy(tree.begin(), tree.end(), nodes().data());
+#ifdef CT_DEBUG
+   std::cerr << "created celltree: " << nodes().size() << " nodes, " << cells().size() << " cells" << std::endl;
+#endif
+}
+
+template<typename Scalar, typename Index, int NumDimensions>
+void Celltree<Scalar, Index, NumDimensions>::initSerial(const Vector *min, const Vector *max,
       const Vector &gmin, const Vector &gmax) {
 
    assert(nodes().size() == 1);
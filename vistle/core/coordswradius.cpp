@@ -40,7 +40,9 @@ void CoordsWithRadius::resetArrays() {
 
 void CoordsWithRadius::setSize(const Index size) {
     Base::setSize(size);
+    d()->r.makeUnique();
     d()->r->resize(size);
+    refresh();
 }
 
 
@@ -15,7 +15,7 @@ class  V_COREEXPORT CoordsWithRadius: public Coords {
    CoordsWithRadius(const Index numCoords,
          const Meta &meta=Meta());
 
-   shm<Scalar>::array &r() { return *(d()->r); }
+   shm<Scalar>::array &r() { if (d()->r.makeUnique()) refresh(); return *(d()->r); }
    const Scalar *r() const { return m_r; }
    void resetArrays() override;
    void setSize(const Index size) override;
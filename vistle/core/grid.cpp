@@ -5,6 +5,13 @@
 
 namespace vistle {
 
+void GridInterface::findCells(const Vector *points, Index numPoints, Index *cells, const Index *hints, int flags) const {
+
+    for (Index i=0; i<numPoints; ++i) {
+        cells[i] = findCell(points[i], hints ? hints[i] : InvalidIndex, flags);
+    }
+}
+
 bool GridInterface::Interpolator::check() const {
 
 #ifndef NDEBUG
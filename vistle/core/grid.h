@@ -22,6 +22,8 @@ class V_COREEXPORT GridInterface: virtual public ElementInterface {
 
    virtual bool isGhostCell(Index elem) const = 0;
    virtual Index findCell(const Vector &point, Index hint=InvalidIndex, int flags=NoFlags) const = 0;
+   //! locate numPoints points at once, storing cell index or InvalidIndex into cells, hints may be nullptr
+   virtual void findCells(const Vector *points, Index numPoints, Index *cells, const Index *hints=nullptr, int flags=NoFlags) const;
    virtual bool inside(Index elem, const Vector &point) const = 0;
    virtual std::pair<Vector, Vector> cellBounds(Index elem) const = 0;
    virtual Vector cellCenter(Index elem) const = 0; //< a point inside the convex hull of the cell
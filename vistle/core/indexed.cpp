@@ -1,5 +1,7 @@
 #include "indexed.h"
 #include "celltree_impl.h"
+#include "accelcache.h"
+#include <vistle/util/contenthash.h>
 #include <cassert>
 
 namespace vistle {
@@ -12,6 +14,28 @@ Indexed::Indexed(const Index numElements, const Index numCorners,
     refreshImpl();
 }
 
+namespace {
+
+//! key for derived structures in AccelerationCache: hash of topology and, optionally, coordinates
+uint64_t cacheKey(const Indexed *grid, uint64_t kind, bool withCoords) {
+
+   ContentHasher hasher(kind);
+   const Index numElem = grid->getNumElements(), numCorners = grid->getNumCorners(), numVert = grid->getNumVertices();
+   hasher.add(numElem);
+   hasher.add(numCorners);
+   hasher.add(numVert);
+   hasher.add(&grid->el()[0], (numElem+1)*sizeof(Index));
+   hasher.add(&grid->cl()[0], numCorners*sizeof(Index));
+   if (withCoords) {
+      hasher.add(&grid->x()[0], numVert*sizeof(Scalar));
+      hasher.add(&grid->y()[0], numVert*sizeof(Scalar));
+      hasher.add(&grid->z()[0], numVert*sizeof(Scalar));
+   }
+   return hasher.hash();
+}
+
+}
+
 bool Indexed::isEmpty() {
 
    return getNumElements()==0 || getNumCorners()==0;
@@ -65,7 +89,18 @@ Indexed::Celltree::const_ptr Indexed::getCelltree() const {
    Data::attachment_mutex_lock_type lock(d()->attachment_mutex);
    if (!hasAttachment("celltree")) {
       refresh();
-      createCelltree(getNumElements(), &el()[0], &cl()[0]);
+      auto &cache = AccelerationCache::the();
+      uint64_t key = 0;
+      if (cache.enabled()) {
+         key = cacheKey(this, Object::CELLTREE3, true);
+         if (auto ct = cache.loadCelltree(key))
+            addAttachment("celltree", ct);
+      }
+      if (!hasAttachment("celltree")) {
+         createCelltree(getNumElements(), &el()[0], &cl()[0]);
+         if (cache.enabled())
+            cache.storeCelltree(key, Celltree::as(getAttachment("celltree")));
+      }
    }
 
    m_celltree = Celltree::as(getAttachment("celltree"));
@@ -148,7 +183,19 @@ Indexed::VertexOwnerList::const_ptr Indexed::getVertexOwnerList() const {
    Data::attachment_mutex_lock_type lock(d()->attachment_mutex);
    if (!hasAttachment("vertexownerlist")) {
       refresh();
-      createVertexOwnerList();
+      auto &cache = AccelerationCache::the();
+      uint64_t key = 0;
+      if (cache.enabled()) {
+         key = cacheKey(this, Object::VERTEXOWNERLIST, false);
+         auto vol = cache.loadVertexOwnerList(key);
+         if (vol && vol->getNumVertices() == getNumVertices())
+            addAttachment("vertexownerlist", vol);
+      }
+      if (!hasAttachment("vertexownerlist")) {
+         createVertexOwnerList();
+         if (cache.enabled())
+            cache.storeVertexOwnerList(key, VertexOwnerList::as(getAttachment("vertexownerlist")));
+      }
    }
 
    m_vertexOwnerList = VertexOwnerList::as(getAttachment("vertexownerlist"));
@@ -30,8 +30,8 @@ class  V_COREEXPORT Indexed: public Coords, virtual public CelltreeInterface<3>
    Index getNumCorners() const;
    void resetCorners();
 
-   typename shm<Index>::array &el() { return *d()->el; }
-   typename shm<Index>::array &cl() { return *d()->cl; }
+   typename shm<Index>::array &el() { if (d()->el.makeUnique()) refresh(); return *d()->el; }
+   typename shm<Index>::array &cl() { if (d()->cl.makeUnique()) refresh(); return *d()->cl; }
    const Index *el() const { return m_el; }
    const Index *cl() const { return m_cl; }
 
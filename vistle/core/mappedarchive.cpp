@@ -0,0 +1,575 @@
+#include "mappedarchive.h"
+#include "shm.h"
+#include "shmvector.h"
+
+#include <vistle/util/fileio.h>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/mpl/for_each.hpp>
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define CERR std::cerr << "MappedArchive: "
+
+namespace vistle {
+
+namespace {
+
+const char Magic[8] = "VISMAP1";
+const uint32_t ByteOrderMark = 0x01020304;
+
+struct FileHeader {
+   char magic[8];
+   uint32_t version;
+   uint32_t byteOrder;
+   uint32_t indexSize;
+   uint32_t scalarSize;
+   uint64_t directoryOffset;
+   uint64_t directoryBytes;
+   uint64_t numEntries;
+   uint64_t numRoots;
+};
+
+struct DiskEntry {
+   uint32_t kind;
+   uint32_t compression;
+   uint32_t type;
+   uint32_t exact;
+   uint64_t size;
+   uint64_t dim[3];
+   uint64_t rawBytes;
+   uint64_t storedBytes;
+   uint64_t offset;
+   uint64_t nameLength;
+};
+
+struct DiskRoot {
+   int32_t port;
+   int32_t timestep;
+   int32_t block;
+   uint32_t nameLength;
+};
+
+size_t padded(size_t size, size_t alignment) {
+   return (size+alignment-1)/alignment*alignment;
+}
+
+FileHeader makeHeader() {
+   FileHeader h;
+   memset(&h, 0, sizeof(h));
+   memcpy(h.magic, Magic, sizeof(h.magic));
+   h.version = MappedArchive::Version;
+   h.byteOrder = ByteOrderMark;
+   h.indexSize = sizeof(Index);
+   h.scalarSize = sizeof(Scalar);
+   return h;
+}
+
+bool writeAll(int fd, const void *buf, size_t n) {
+   size_t tot = 0;
+   while (tot < n) {
+      ssize_t result = write(fd, static_cast<const char *>(buf)+tot, n-tot);
+      if (result < 0) {
+         if (errno == EINTR)
+            continue;
+         CERR << "write error: " << strerror(errno) << std::endl;
+         return false;
+      }
+      tot += result;
+   }
+   return true;
+}
+
+void appendToDirectory(buffer &dir, const void *data, size_t bytes) {
+   const char *p = static_cast<const char *>(data);
+   dir.insert(dir.end(), p, p+bytes);
+   dir.resize(padded(dir.size(), 8));
+}
+
+//! access raw contents of a ShmVector with element type determined at run time
+struct RawArrayAccess {
+   RawArrayAccess(const std::string &name, int type, const void *array): m_name(name), m_type(type), m_array(array) {}
+
+   template<typename T>
+   void operator()(T) {
+      if (shm<T>::array::typeId() != m_type)
+         return;
+      ShmVector<T> arr;
+      if (m_array) {
+         arr = *static_cast<const ShmVector<T> *>(m_array);
+      } else {
+         arr = Shm::the().getArrayFromName<T>(m_name);
+      }
+      if (!arr)
+         return;
+      m_ok = true;
+      m_ref = std::make_shared<ArrayLoader::Unreffer<T>>(arr);
+      m_data = arr->data();
+      m_size = arr->size();
+      m_bytes = m_size*sizeof(T);
+      m_exact = arr->exact();
+      for (int c=0; c<3; ++c)
+         m_dim[c] = arr->dimensionHint(c);
+   }
+
+   std::string m_name;
+   int m_type;
+   const void *m_array;
+   bool m_ok = false;
+   std::shared_ptr<ArrayLoader::ArrayOwner> m_ref;
+   const void *m_data = nullptr;
+   size_t m_size = 0, m_bytes = 0;
+   bool m_exact = false;
+   uint64_t m_dim[3] = {0, 1, 1};
+};
+
+//! create a ShmVector with element type determined at run time and fill it with the raw contents of an entry
+struct RawArrayRestore {
+   RawArrayRestore(const MappedArchive::Entry &ent, const char *raw): m_ent(ent), m_raw(raw) {}
+
+   template<typename T>
+   void operator()(T) {
+      if (shm<T>::array::typeId() != m_ent.type)
+         return;
+      if (m_ent.size*sizeof(T) != m_ent.rawBytes) {
+         CERR << "size mismatch for array " << m_ent.name << std::endl;
+         return;
+      }
+      ShmVector<T> arr;
+      arr.construct();
+      arr->resize(m_ent.size);
+      if (m_ent.rawBytes > 0)
+         memcpy(arr->data(), m_raw, m_ent.rawBytes);
+      if (m_ent.dim[0]*m_ent.dim[1]*m_ent.dim[2] == m_ent.size)
+         arr->setDimensionHint(m_ent.dim[0], m_ent.dim[1], m_ent.dim[2]);
+      arr->setExact(m_ent.exact);
+      m_name = arr.name().str();
+      m_owner = std::make_shared<ArrayLoader::Unreffer<T>>(arr);
+      m_ok = true;
+   }
+
+   const MappedArchive::Entry &m_ent;
+   const char *m_raw;
+   bool m_ok = false;
+   std::string m_name;
+   std::shared_ptr<ArrayLoader::ArrayOwner> m_owner;
+};
+
+} // anonymous namespace
+
+
+MappedArchiveWriter::MappedArchiveWriter(const std::string &filename)
+: m_filename(filename)
+{
+   m_fd = open(filename.c_str(), O_WRONLY|O_CREAT|O_TRUNC, S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH|S_IWOTH);
+   if (m_fd == -1) {
+      CERR << "could not open " << filename << " for writing: " << strerror(errno) << std::endl;
+      m_ok = false;
+      return;
+   }
+
+   // reserve first page for header, it is written when the directory is complete
+   std::vector<char> zero(MappedArchive::PageSize);
+   m_ok = writeAll(m_fd, zero.data(), zero.size());
+   m_offset = zero.size();
+}
+
+MappedArchiveWriter::~MappedArchiveWriter() {
+
+   close();
+}
+
+bool MappedArchiveWriter::isOpen() const {
+
+   return m_fd != -1 && m_ok;
+}
+
+void MappedArchiveWriter::setArrayCompression(message::CompressionMode mode, int speed, size_t minBytes) {
+
+   m_compression = mode;
+   m_compressionSpeed = speed;
+   m_compressionMinBytes = minBytes;
+}
+
+bool MappedArchiveWriter::append(const void *data, size_t bytes, size_t alignment, uint64_t &offset) {
+
+   if (!isOpen())
+      return false;
+
+   const uint64_t start = padded(m_offset, alignment);
+   if (start > m_offset) {
+      std::vector<char> zero(start-m_offset);
+      if (!writeAll(m_fd, zero.data(), zero.size())) {
+         m_ok = false;
+         return false;
+      }
+   }
+   if (!writeAll(m_fd, data, bytes)) {
+      m_ok = false;
+      return false;
+   }
+   offset = start;
+   m_offset = start+bytes;
+   return true;
+}
+
+void MappedArchiveWriter::saveArray(const std::string &name, int type, const void *array) {
+
+   if (!m_savedArrays.insert(name).second)
+      return;
+
+   RawArrayAccess acc(name, type, array);
+   boost::mpl::for_each<VectorTypes>(boost::reference_wrapper<RawArrayAccess>(acc));
+   if (!acc.m_ok) {
+      CERR << "failed to access array " << name << std::endl;
+      m_ok = false;
+      return;
+   }
+
+   MappedArchive::Entry ent;
+   ent.name = name;
+   ent.kind = MappedArchive::KindArray;
+   ent.type = type;
+   ent.exact = acc.m_exact;
+   ent.size = acc.m_size;
+   for (int c=0; c<3; ++c)
+      ent.dim[c] = acc.m_dim[c];
+   ent.rawBytes = acc.m_bytes;
+
+   const char *data = static_cast<const char *>(acc.m_data);
+   buffer compressed;
+   if (m_compression != message::CompressionNone && acc.m_bytes >= m_compressionMinBytes) {
+      message::CompressionMode mode = m_compression;
+      compressed = message::compressPayload(mode, data, acc.m_bytes, m_compressionSpeed);
+      // keep data uncompressed, and thus directly mappable, if compression does not save at least 1/8
+      if (mode != message::CompressionNone && compressed.size() < acc.m_bytes-acc.m_bytes/8) {
+         ent.compression = mode;
+         data = compressed.data();
+      }
+   }
+   ent.storedBytes = ent.compression==message::CompressionNone ? ent.rawBytes : compressed.size();
+
+   if (append(data, ent.storedBytes, MappedArchive::PageSize, ent.offset))
+      m_entries.push_back(ent);
+}
+
+void MappedArchiveWriter::saveObject(const std::string &name, obj_const_ptr obj) {
+
+   if (!m_savedObjects.insert(name).second)
+      return;
+
+   // referenced objects and arrays are appended by the callbacks from the archive
+   vecostreambuf<buffer> vb;
+   oarchive ar(vb);
+   ar.setSaver(shared_from_this());
+   obj->saveObject(ar);
+   const buffer &mem = vb.get_vector();
+
+   MappedArchive::Entry ent;
+   ent.name = name;
+   ent.kind = MappedArchive::KindObject;
+   ent.size = ent.rawBytes = ent.storedBytes = mem.size();
+   if (append(mem.data(), mem.size(), 8, ent.offset))
+      m_entries.push_back(ent);
+}
+
+bool MappedArchiveWriter::addObject(Object::const_ptr obj, int port) {
+
+   if (!obj || !isOpen())
+      return false;
+
+   saveObject(obj->getName(), obj);
+
+   MappedArchive::Root root;
+   root.port = port;
+   root.timestep = obj->getTimestep();
+   root.block = obj->getBlock();
+   root.object = obj->getName();
+   m_roots.push_back(root);
+
+   return isOpen();
+}
+
+bool MappedArchiveWriter::close() {
+
+   if (m_fd == -1)
+      return false;
+
+   buffer dir;
+   for (const auto &ent: m_entries) {
+      DiskEntry de;
+      memset(&de, 0, sizeof(de));
+      de.kind = ent.kind;
+      de.compression = ent.compression;
+      de.type = ent.type;
+      de.exact = ent.exact;
+      de.size = ent.size;
+      for (int c=0; c<3; ++c)
+         de.dim[c] = ent.dim[c];
+      de.rawBytes = ent.rawBytes;
+      de.storedBytes = ent.storedBytes;
+      de.offset = ent.offset;
+      de.nameLength = ent.name.length();
+      appendToDirectory(dir, &de, sizeof(de));
+      appendToDirectory(dir, ent.name.data(), ent.name.length());
+   }
+   for (const auto &root: m_roots) {
+      DiskRoot dr;
+      memset(&dr, 0, sizeof(dr));
+      dr.port = root.port;
+      dr.timestep = root.timestep;
+      dr.block = root.block;
+      dr.nameLength = root.object.length();
+      appendToDirectory(dir, &dr, sizeof(dr));
+      appendToDirectory(dir, root.object.data(), root.object.length());
+   }
+
+   FileHeader header = makeHeader();
+   header.directoryBytes = dir.size();
+   header.numEntries = m_entries.size();
+   header.numRoots = m_roots.size();
+   bool ok = append(dir.data(), dir.size(), 8, header.directoryOffset);
+   if (ok) {
+      ok = lseek(m_fd, 0, SEEK_SET) == 0 && writeAll(m_fd, &header, sizeof(header));
+   }
+
+   if (::close(m_fd) != 0)
+      ok = false;
+   m_fd = -1;
+   if (!ok)
+      CERR << "failed to write " << m_filename << std::endl;
+   return ok;
+}
+
+
+MappedArchiveReader::MappedArchiveReader(const std::string &filename)
+: m_filename(filename)
+{
+   namespace bi = boost::interprocess;
+
+   try {
+      bi::file_mapping file(filename.c_str(), bi::read_only);
+      bi::mapped_region r(file, bi::read_only);
+      m_region.swap(r);
+   } catch (bi::interprocess_exception &ex) {
+      CERR << "failed to map " << filename << ": " << ex.what() << std::endl;
+      return;
+   }
+   m_region.advise(bi::mapped_region::advice_sequential);
+
+   const char *base = static_cast<const char *>(m_region.get_address());
+   const size_t fileSize = m_region.get_size();
+   if (fileSize < sizeof(FileHeader)) {
+      CERR << filename << " is too short" << std::endl;
+      return;
+   }
+   FileHeader header;
+   memcpy(&header, base, sizeof(header));
+   const FileHeader expected = makeHeader();
+   if (memcmp(header.magic, expected.magic, sizeof(expected.magic)) != 0) {
+      CERR << filename << " is not a Vistle archive" << std::endl;
+      return;
+   }
+   if (header.version != expected.version || header.byteOrder != expected.byteOrder
+         || header.indexSize != expected.indexSize || header.scalarSize != expected.scalarSize) {
+      CERR << filename << " is incompatible: version " << header.version << ", Index size " << header.indexSize << ", Scalar size " << header.scalarSize << std::endl;
+      return;
+   }
+   if (header.directoryOffset > fileSize || header.directoryBytes > fileSize-header.directoryOffset) {
+      CERR << filename << " is truncated" << std::endl;
+      return;
+   }
+
+   const char *dir = base + header.directoryOffset;
+   const char *end = dir + header.directoryBytes;
+   auto readName = [&dir, end](uint64_t length, std::string &name) -> bool {
+      if (length > uint64_t(end-dir))
+         return false;
+      name.assign(dir, length);
+      dir += padded(length, 8);
+      return true;
+   };
+
+   for (uint64_t i=0; i<header.numEntries; ++i) {
+      DiskEntry de;
+      if (size_t(end-dir) < sizeof(de))
+         return;
+      memcpy(&de, dir, sizeof(de));
+      dir += padded(sizeof(de), 8);
+      MappedArchive::Entry ent;
+      if (!readName(de.nameLength, ent.name))
+         return;
+      ent.kind = MappedArchive::Kind(de.kind);
+      ent.compression = message::CompressionMode(de.compression);
+      ent.type = de.type;
+      ent.exact = de.exact;
+      ent.size = de.size;
+      for (int c=0; c<3; ++c)
+         ent.dim[c] = de.dim[c];
+      ent.rawBytes = de.rawBytes;
+      ent.storedBytes = de.storedBytes;
+      ent.offset = de.offset;
+      if (ent.offset > fileSize || ent.storedBytes > fileSize-ent.offset) {
+         CERR << "entry " << ent.name << " exceeds " << filename << std::endl;
+         return;
+      }
+      if (ent.kind == MappedArchive::KindArray)
+         m_arrays.emplace(ent.name, ent);
+      else
+         m_objects.emplace(ent.name, ent);
+   }
+
+   for (uint64_t i=0; i<header.numRoots; ++i) {
+      DiskRoot dr;
+      if (size_t(end-dir) < sizeof(dr))
+         return;
+      memcpy(&dr, dir, sizeof(dr));
+      dir += padded(sizeof(dr), 8);
+      MappedArchive::Root root;
+      if (!readName(dr.nameLength, root.object))
+         return;
+      root.port = dr.port;
+      root.timestep = dr.timestep;
+      root.block = dr.block;
+      m_roots.push_back(root);
+   }
+
+   m_ok = true;
+}
+
+MappedArchiveReader::~MappedArchiveReader() {
+}
+
+bool MappedArchiveReader::isOpen() const {
+
+   return m_ok;
+}
+
+const std::vector<MappedArchive::Root> &MappedArchiveReader::roots() const {
+
+   return m_roots;
+}
+
+const MappedArchive::Entry *MappedArchiveReader::find(const std::string &name, MappedArchive::Kind kind) const {
+
+   const auto &entries = kind==MappedArchive::KindArray ? m_arrays : m_objects;
+   auto it = entries.find(name);
+   if (it == entries.end())
+      return nullptr;
+   return &it->second;
+}
+
+const char *MappedArchiveReader::payload(const MappedArchive::Entry &ent) const {
+
+   return static_cast<const char *>(m_region.get_address()) + ent.offset;
+}
+
+Object::ptr MappedArchiveReader::loadObject(const std::string &name) {
+
+   Object::ptr result;
+   requestObject(name, [&result](Object::const_ptr obj){
+      result = std::const_pointer_cast<Object>(obj);
+   });
+   return result;
+}
+
+void MappedArchiveReader::releaseArrays() {
+
+   m_ownedArrays.clear();
+}
+
+void MappedArchiveReader::requestArray(const std::string &arname, int type, const ArrayCompletionHandler &completeCallback) {
+
+   auto ent = find(arname, MappedArchive::KindArray);
+   if (!ent) {
+      CERR << "did not find array " << arname << " in " << m_filename << std::endl;
+      return;
+   }
+   if (ent->type != uint32_t(type)) {
+      CERR << "type mismatch for array " << arname << std::endl;
+      return;
+   }
+
+   const char *raw = payload(*ent);
+   buffer decompressed;
+   if (ent->compression != message::CompressionNone) {
+      try {
+         decompressed = message::decompressPayload(ent->compression, ent->storedBytes, ent->rawBytes, raw);
+      } catch (const std::exception &ex) {
+         CERR << "failed to decompress array " << arname << ": " << ex.what() << std::endl;
+         return;
+      }
+      raw = decompressed.data();
+   }
+
+   RawArrayRestore restore(*ent, raw);
+   boost::mpl::for_each<VectorTypes>(boost::reference_wrapper<RawArrayRestore>(restore));
+   if (!restore.m_ok) {
+      CERR << "failed to restore array " << arname << std::endl;
+      return;
+   }
+   registerArrayNameTranslation(arname, restore.m_name);
+   m_ownedArrays.emplace(restore.m_owner);
+   if (completeCallback)
+      completeCallback(restore.m_name);
+}
+
+void MappedArchiveReader::requestObject(const std::string &arname, const ObjectCompletionHandler &completeCallback) {
+
+   auto ent = find(arname, MappedArchive::KindObject);
+   if (!ent) {
+      CERR << "did not find object " << arname << " in " << m_filename << std::endl;
+      return;
+   }
+
+   const char *raw = payload(*ent);
+   buffer mem(raw, raw+ent->storedBytes);
+   vecistreambuf<buffer> vb(mem);
+   iarchive ar(vb);
+   ar.setFetcher(shared_from_this());
+   Object::ptr obj(Object::loadObject(ar));
+   if (obj && obj->isComplete()) {
+      if (completeCallback)
+         completeCallback(obj);
+   } else {
+      CERR << "failed to load object " << arname << std::endl;
+   }
+}
+
+bool MappedArchiveReader::renameObjects() const {
+
+   return true;
+}
+
+std::string MappedArchiveReader::translateObjectName(const std::string &name) const {
+
+   auto it = m_transObject.find(name);
+   if (it == m_transObject.end())
+      return std::string();
+   return it->second;
+}
+
+std::string MappedArchiveReader::translateArrayName(const std::string &name) const {
+
+   auto it = m_transArray.find(name);
+   if (it == m_transArray.end())
+      return std::string();
+   return it->second;
+}
+
+void MappedArchiveReader::registerObjectNameTranslation(const std::string &arname, const std::string &name) {
+
+   m_transObject.emplace(arname, name);
+}
+
+void MappedArchiveReader::registerArrayNameTranslation(const std::string &arname, const std::string &name) {
+
+   m_transArray.emplace(arname, name);
+}
+
+}
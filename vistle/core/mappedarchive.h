@@ -0,0 +1,127 @@
+#ifndef VISTLE_MAPPEDARCHIVE_H
+#define VISTLE_MAPPEDARCHIVE_H
+
+#include "export.h"
+#include "archives.h"
+#include "message.h"
+#include "object.h"
+#include "archive_loader.h"
+
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <cstdint>
+
+namespace vistle {
+
+//! on-disk object format with raw, page-aligned array payloads
+/*!
+ * A file consists of a header page, the payloads of all objects and arrays and a directory of all entries at its end.
+ * Objects are stored as (small) archives referring to their arrays by name,
+ * arrays are stored as their raw contents starting at page boundaries, optionally compressed.
+ * Uncompressed arrays are read from a memory mapping of the file without a deserialization pass.
+ */
+struct MappedArchive {
+   static const uint32_t Version = 1;
+   static const size_t PageSize = 4096;
+
+   enum Kind {
+      KindObject = 1,
+      KindArray = 2,
+   };
+
+   struct Entry {
+      std::string name;
+      Kind kind = KindObject;
+      message::CompressionMode compression = message::CompressionNone;
+      bool exact = false;
+      uint32_t type = 0; //!< shm_array type id for arrays
+      uint64_t size = 0; //!< no. of array elements or bytes of object archive
+      uint64_t dim[3] = {0, 1, 1}; //!< dimension hint of array
+      uint64_t rawBytes = 0;
+      uint64_t storedBytes = 0;
+      uint64_t offset = 0; //!< start of payload within file
+   };
+
+   //! object that has been added for output on a port
+   struct Root {
+      int port = 0;
+      int timestep = -1;
+      int block = -1;
+      std::string object;
+   };
+};
+
+//! write objects and all objects and arrays they reference to a MappedArchive file
+class V_COREEXPORT MappedArchiveWriter: public Saver, public std::enable_shared_from_this<MappedArchiveWriter> {
+public:
+    MappedArchiveWriter(const std::string &filename);
+    ~MappedArchiveWriter();
+
+    bool isOpen() const;
+    //! compress arrays of at least minBytes with mode, but only store compressed data where it pays off
+    void setArrayCompression(message::CompressionMode mode, int speed=-1, size_t minBytes=MappedArchive::PageSize);
+    //! save obj with everything it references and record it for output on port
+    bool addObject(Object::const_ptr obj, int port=0);
+    //! write directory, further objects cannot be added
+    bool close();
+
+    void saveArray(const std::string &name, int type, const void *array) override;
+    void saveObject(const std::string &name, obj_const_ptr obj) override;
+
+private:
+    bool append(const void *data, size_t bytes, size_t alignment, uint64_t &offset);
+
+    int m_fd = -1;
+    std::string m_filename;
+    uint64_t m_offset = 0;
+    bool m_ok = true;
+    message::CompressionMode m_compression = message::CompressionNone;
+    int m_compressionSpeed = -1;
+    size_t m_compressionMinBytes = MappedArchive::PageSize;
+    std::vector<MappedArchive::Entry> m_entries;
+    std::set<std::string> m_savedObjects, m_savedArrays;
+    std::vector<MappedArchive::Root> m_roots;
+};
+
+//! restore objects from a MappedArchive file
+class V_COREEXPORT MappedArchiveReader: public Fetcher, public std::enable_shared_from_this<MappedArchiveReader> {
+public:
+    MappedArchiveReader(const std::string &filename);
+    ~MappedArchiveReader();
+
+    bool isOpen() const;
+    const std::vector<MappedArchive::Root> &roots() const;
+    //! restore object stored as name in archive together with everything it references, objects and arrays get new names
+    Object::ptr loadObject(const std::string &name);
+    //! drop references to restored arrays that are kept until they have been attached to their objects
+    void releaseArrays();
+
+    void requestArray(const std::string &name, int type, const ArrayCompletionHandler &completeCallback) override;
+    void requestObject(const std::string &name, const ObjectCompletionHandler &completeCallback) override;
+
+    bool renameObjects() const override;
+    std::string translateObjectName(const std::string &name) const override;
+    std::string translateArrayName(const std::string &name) const override;
+    void registerObjectNameTranslation(const std::string &arname, const std::string &name) override;
+    void registerArrayNameTranslation(const std::string &arname, const std::string &name) override;
+
+private:
+    const MappedArchive::Entry *find(const std::string &name, MappedArchive::Kind kind) const;
+    const char *payload(const MappedArchive::Entry &ent) const;
+
+    std::string m_filename;
+    boost::interprocess::mapped_region m_region;
+    bool m_ok = false;
+    std::map<std::string, MappedArchive::Entry> m_objects, m_arrays;
+    std::vector<MappedArchive::Root> m_roots;
+    std::map<std::string, std::string> m_transObject, m_transArray;
+    std::set<std::shared_ptr<ArrayLoader::ArrayOwner>> m_ownedArrays;
+};
+
+}
+#endif
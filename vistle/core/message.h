@@ -75,6 +75,7 @@ DEFINE_ENUM_WITH_STRING_CONVERSIONS(Type,
       (FILEQUERY)
       (FILEQUERYRESULT)
       (INSITU)
+      (PAYLOADSTRIPE)
       (NumMessageTypes) // keep last
 )
 V_ENUM_OUTPUT_OP(Type, ::vistle::message)
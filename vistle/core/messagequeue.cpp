@@ -9,7 +9,12 @@
 #include "message.h"
 #include "messagequeue.h"
 #include "shm.h"
+#include "shmring.h"
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#include <boost/interprocess/shared_memory_object.hpp>
 
 #ifdef __linux__
 // not necessary, as child processes die with their parent
@@ -34,8 +39,31 @@ std::string MessageQueue::createName(const char * prefix,
    return mqID.str();
 }
 
+MessageQueue::Backend MessageQueue::defaultBackend() {
+
+#ifdef __linux__
+   Backend backend = Ring;
+#else
+   Backend backend = BoostQueue;
+#endif
+   if (const char *mq = getenv("VISTLE_MESSAGEQUEUE")) {
+      if (strcmp(mq, "boost") == 0)
+         backend = BoostQueue;
+      else if (strcmp(mq, "ring") == 0)
+         backend = Ring;
+      else
+         std::cerr << "MessageQueue: ignoring unknown value " << mq << " for VISTLE_MESSAGEQUEUE" << std::endl;
+   }
+   return backend;
+}
+
 MessageQueue * MessageQueue::create(const std::string & n) {
 
+   return create(n, defaultBackend());
+}
+
+MessageQueue * MessageQueue::create(const std::string & n, Backend backend) {
+
    {
       std::ofstream f;
       f.open(Shm::shmIdFilename().c_str(), std::ios::app);
@@ -43,7 +71,7 @@ MessageQueue * MessageQueue::create(const std::string & n) {
    }
 
    message_queue::remove(n.c_str());
-   return new MessageQueue(n, create_only);
+   return new MessageQueue(n, create_only, backend);
 }
 
 MessageQueue * MessageQueue::open(const std::string & n) {
@@ -54,18 +82,36 @@ MessageQueue * MessageQueue::open(const std::string & n) {
    return ret;
 }
 
-MessageQueue::MessageQueue(const std::string & n, create_only_t)
+MessageQueue::MessageQueue(const std::string & n, create_only_t, Backend backend)
 : m_blocking(true)
 , m_name(n)
-, m_mq(create_only, m_name.c_str(), 10 /* num msg */, message::Message::MESSAGE_SIZE)
 {
+   if (backend == Ring) {
+      // a segment of its own, so that the queue outlives detaching from the object segment
+      shared_memory_object shm(create_only, m_name.c_str(), read_write);
+      shm.truncate(sizeof(ShmRing));
+      m_region.reset(new mapped_region(shm, read_write));
+      m_ring = new(m_region->get_address()) ShmRing;
+   } else {
+      m_mq.reset(new message_queue(create_only, m_name.c_str(), 10 /* num msg */, message::Message::MESSAGE_SIZE));
+   }
 }
 
 MessageQueue::MessageQueue(const std::string & n, open_only_t)
 : m_blocking(true)
 , m_name(n)
-, m_mq(open_only, m_name.c_str())
 {
+   {
+      // message_queue is backed by a shared memory object of the same name, so look for a ring first
+      shared_memory_object shm(open_only, m_name.c_str(), read_write);
+      std::unique_ptr<mapped_region> region(new mapped_region(shm, read_write));
+      if (region->get_size() >= sizeof(ShmRing) && static_cast<ShmRing *>(region->get_address())->valid()) {
+         m_region = std::move(region);
+         m_ring = static_cast<ShmRing *>(m_region->get_address());
+      }
+   }
+   if (!m_ring)
+      m_mq.reset(new message_queue(open_only, m_name.c_str()));
 }
 
 MessageQueue::~MessageQueue() {
@@ -82,26 +128,29 @@ const std::string & MessageQueue::getName() const {
    return m_name;
 }
 
+bool MessageQueue::sendBuffer(const Buffer &buf, bool block) {
+
+   if (m_ring) {
+      // only transmit the part of the buffer used by the actual message type
+      assert(buf.size() >= sizeof(Message) && buf.size() <= message::Message::MESSAGE_SIZE);
+      return m_ring->push(buf.data(), buf.size(), block);
+   }
+
+   if (block) {
+      m_mq->send(buf.data(), message::Message::MESSAGE_SIZE, 0);
+      return true;
+   }
+   return m_mq->try_send(buf.data(), message::Message::MESSAGE_SIZE, 0);
+}
+
 bool MessageQueue::progress() {
 
     std::unique_lock<std::mutex> guard(m_mutex);
     while (!m_queue.empty()) {
-        guard.unlock();
-        if (m_blocking) {
-            guard.lock();
-            if (!m_queue.empty()) {
-                m_mq.send(m_queue.front().data(), message::Message::MESSAGE_SIZE, 0);
-                m_queue.pop_front();
-            }
-        } else {
-            guard.lock();
-            if (!m_queue.empty()) {
-                if (!m_mq.try_send(m_queue.front().data(), message::Message::MESSAGE_SIZE, 0)) {
-                    return m_queue.empty();
-                }
-                m_queue.pop_front();
-            }
+        if (!sendBuffer(m_queue.front(), m_blocking)) {
+            return m_queue.empty();
         }
+        m_queue.pop_front();
     }
     return m_queue.empty();
 }
@@ -116,12 +165,27 @@ bool MessageQueue::send(const Message &msg) {
 
 void MessageQueue::receive(Message &msg) {
 
+   if (m_ring) {
+#ifdef NO_CHECK_FOR_DEAD_PARENT
+      const int timeout = -1;
+#else
+      const int timeout = 5000;
+#endif
+      while (m_ring->pop(&msg, message::Message::MESSAGE_SIZE, true, timeout) == 0) {
+#ifndef NO_CHECK_FOR_DEAD_PARENT
+         if (parentProcessDied())
+            throw except::parent_died();
+#endif
+      }
+      return;
+   }
+
    size_t recvSize = 0;
    unsigned priority = 0;
 #ifdef NO_CHECK_FOR_DEAD_PARENT
-   m_mq.receive(&msg, message::Message::MESSAGE_SIZE, recvSize, priority);
+   m_mq->receive(&msg, message::Message::MESSAGE_SIZE, recvSize, priority);
 #else
-   while (!m_mq.timed_receive(&msg, message::Message::MESSAGE_SIZE, recvSize, priority,
+   while (!m_mq->timed_receive(&msg, message::Message::MESSAGE_SIZE, recvSize, priority,
                               boost::get_system_time() + boost::posix_time::seconds(5))) {
       if (parentProcessDied())
          throw except::parent_died();
@@ -137,9 +201,12 @@ bool MessageQueue::tryReceive(Message &msg) {
       throw except::parent_died();
 #endif
 
+   if (m_ring)
+      return m_ring->pop(&msg, message::Message::MESSAGE_SIZE, false) > 0;
+
    size_t recvSize = 0;
    unsigned priority = 0;
-   bool result = m_mq.try_receive(&msg, message::Message::MESSAGE_SIZE, recvSize, priority);
+   bool result = m_mq->try_receive(&msg, message::Message::MESSAGE_SIZE, recvSize, priority);
    if (result) {
       assert(recvSize == message::Message::MESSAGE_SIZE);
    }
@@ -148,7 +215,9 @@ bool MessageQueue::tryReceive(Message &msg) {
 
 size_t MessageQueue::getNumMessages() {
 
-   return m_mq.get_num_msg();
+   if (m_ring)
+      return m_ring->numMessages();
+   return m_mq->get_num_msg();
 }
 
 } // namespace message
@@ -3,13 +3,18 @@
 
 #include <deque>
 #include <mutex>
+#include <memory>
 #define BOOST_INTERPROCESS_MSG_QUEUE_CIRCULAR_INDEX
 #include <boost/interprocess/ipc/message_queue.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 
 #include "message.h"
 #include "export.h"
 
 namespace vistle {
+
+class ShmRing;
+
 namespace message {
 
 class Message;
@@ -19,7 +24,16 @@ class V_COREEXPORT MessageQueue {
  public:
    typedef boost::interprocess::message_queue message_queue;
 
+   enum Backend {
+      BoostQueue, //!< boost::interprocess::message_queue, fixed size messages
+      Ring, //!< lock-free ring buffer, variable size messages
+   };
+   //! backend for new queues: Ring on Linux, can be overridden by setting VISTLE_MESSAGEQUEUE to boost or ring
+   static Backend defaultBackend();
+
    static MessageQueue * create(const std::string & m_name);
+   static MessageQueue * create(const std::string & m_name, Backend backend);
+   //! open queue created with any backend
    static MessageQueue * open(const std::string & m_name);
 
    static std::string createName(const char * prefix,
@@ -40,11 +54,14 @@ class V_COREEXPORT MessageQueue {
 
  private:
    bool m_blocking;
-   MessageQueue(const std::string & m_name, boost::interprocess::create_only_t);
+   MessageQueue(const std::string & m_name, boost::interprocess::create_only_t, Backend backend);
    MessageQueue(const std::string & m_name, boost::interprocess::open_only_t);
+   bool sendBuffer(const Buffer &buf, bool block);
 
    const std::string m_name;
-   message_queue m_mq;
+   std::unique_ptr<message_queue> m_mq;
+   std::unique_ptr<boost::interprocess::mapped_region> m_region;
+   ShmRing *m_ring = nullptr;
    std::deque<message::Buffer> m_queue;
    std::mutex m_mutex;
 };
@@ -443,6 +443,7 @@ Execute::Execute(Execute::What what, const int module, const int count)
    , m_what(what)
    , m_realtime(0.)
    , m_animationStepDuration(0.)
+   , m_haveAnimationTime(false)
 {
 }
 
@@ -453,6 +454,7 @@ Execute::Execute(const int module, double realtime, double stepsize)
 , m_what(ComputeExecute)
 , m_realtime(realtime)
 , m_animationStepDuration(stepsize)
+, m_haveAnimationTime(true)
 {
 }
 
@@ -500,10 +502,24 @@ double Execute::animationRealTime() const {
     return m_realtime;
 }
 
+void Execute::setAnimationRealTime(double time) {
+    m_realtime = time;
+    m_haveAnimationTime = true;
+}
+
 double Execute::animationStepDuration() const {
     return m_animationStepDuration;
 }
 
+void Execute::setAnimationStepDuration(double duration) {
+    m_animationStepDuration = duration;
+    m_haveAnimationTime = true;
+}
+
+bool Execute::hasAnimationTime() const {
+    return m_haveAnimationTime;
+}
+
 
 CancelExecute::CancelExecute(const int module)
     : m_module(module) {
@@ -1568,6 +1584,22 @@ int RequestObject::arrayType() const {
     return m_arrayType;
 }
 
+void RequestObject::setBandwidth(double bytesPerSecond) {
+    m_bandwidth = bytesPerSecond;
+}
+
+double RequestObject::bandwidth() const {
+    return m_bandwidth;
+}
+
+void RequestObject::setAllowAlias(bool allow) {
+    m_allowAlias = allow;
+}
+
+bool RequestObject::allowAlias() const {
+    return m_allowAlias;
+}
+
 
 SendObject::SendObject(const RequestObject &request, Object::const_ptr obj, size_t payloadSize)
 : m_array(false)
@@ -1633,6 +1665,55 @@ bool SendObject::isArray() const {
    return m_array;
 }
 
+void SendObject::setRawArray(uint64_t size, const uint64_t dim[3], bool exact) {
+   assert(m_array);
+   m_rawArray = true;
+   m_arraySize = size;
+   for (int c=0; c<3; ++c)
+      m_arrayDim[c] = dim[c];
+   m_arrayExact = exact;
+}
+
+bool SendObject::isRawArray() const {
+   return m_rawArray;
+}
+
+uint64_t SendObject::arraySize() const {
+   return m_arraySize;
+}
+
+uint64_t SendObject::arrayDimension(int c) const {
+   return m_arrayDim[c];
+}
+
+bool SendObject::arrayExact() const {
+   return m_arrayExact;
+}
+
+void SendObject::setCompressionTime(double seconds) {
+   m_compressionTime = seconds;
+}
+
+double SendObject::compressionTime() const {
+   return m_compressionTime;
+}
+
+void SendObject::setContentHash(uint64_t hash) {
+   m_contentHash = hash;
+}
+
+uint64_t SendObject::contentHash() const {
+   return m_contentHash;
+}
+
+void SendObject::setDuplicate(bool duplicate) {
+   m_duplicate = duplicate;
+}
+
+bool SendObject::isDuplicate() const {
+   return m_duplicate;
+}
+
 FileQuery::FileQuery(int moduleId, const std::string &path, Command command, size_t payloadsize)
 : m_command(command)
 , m_moduleId(moduleId)
@@ -1707,6 +1788,80 @@ size_t DataTransferState::numTransferring() const {
     return m_numTransferring;
 }
 
+void DataTransferState::setTransferStatistics(const std::string &name, int fieldCompression, CompressionMode compression,
+                                              uint64_t rawSize, uint64_t sentSize, double compressionTime, double bandwidth) {
+    m_haveStatistics = true;
+    m_objectName = name;
+    m_fieldCompression = fieldCompression;
+    m_compression = compression;
+    m_rawSize = rawSize;
+    m_sentSize = sentSize;
+    m_compressionTime = compressionTime;
+    m_bandwidth = bandwidth;
+}
+
+bool DataTransferState::hasTransferStatistics() const {
+    return m_haveStatistics;
+}
+
+const char *DataTransferState::objectName() const {
+    return m_objectName;
+}
+
+int DataTransferState::fieldCompression() const {
+    return m_fieldCompression;
+}
+
+CompressionMode DataTransferState::compression() const {
+    return static_cast<CompressionMode>(m_compression);
+}
+
+uint64_t DataTransferState::rawSize() const {
+    return m_rawSize;
+}
+
+uint64_t DataTransferState::sentSize() const {
+    return m_sentSize;
+}
+
+double DataTransferState::compressionTime() const {
+    return m_compressionTime;
+}
+
+double DataTransferState::bandwidth() const {
+    return m_bandwidth;
+}
+
+PayloadStripe::PayloadStripe(uint64_t transferId, int index, int numStripes, uint64_t offset, uint64_t totalSize, size_t payloadSize)
+    : m_transferId(transferId)
+    , m_offset(offset)
+    , m_totalSize(totalSize)
+    , m_index(index)
+    , m_numStripes(numStripes)
+{
+    m_payloadSize = payloadSize;
+}
+
+uint64_t PayloadStripe::transferId() const {
+    return m_transferId;
+}
+
+int PayloadStripe::index() const {
+    return m_index;
+}
+
+int PayloadStripe::numStripes() const {
+    return m_numStripes;
+}
+
+uint64_t PayloadStripe::offset() const {
+    return m_offset;
+}
+
+uint64_t PayloadStripe::totalSize() const {
+    return m_totalSize;
+}
+
 std::ostream &operator<<(std::ostream &s, const Message &m) {
 
    using namespace vistle::message;
@@ -1843,11 +1998,15 @@ std::ostream &operator<<(std::ostream &s, const Message &m) {
       case REQUESTOBJECT: {
          auto &mm = static_cast<const RequestObject &>(m);
          s << ", " << (mm.isArray() ? "array" : "object") << ": " << mm.objectId() << ", ref: " << mm.referrer();
+         if (!mm.allowAlias())
+            s << ", no alias";
          break;
       }
       case SENDOBJECT: {
          auto &mm = static_cast<const SendObject &>(m);
-         s << ", " << (mm.isArray() ? "array" : "object") << ": " << mm.objectId() << ", ref: " << mm.referrer() << ", payload size: " << mm.payloadSize();
+         s << ", " << (mm.isArray() ? (mm.isRawArray() ? "raw array" : "array") : "object") << ": " << mm.objectId() << ", ref: " << mm.referrer() << ", payload size: " << mm.payloadSize();
+         if (mm.contentHash())
+            s << ", hash: " << std::hex << mm.contentHash() << std::dec << (mm.isDuplicate() ? " (duplicate)" : "");
          break;
       }
       case FILEQUERY: {
@@ -1860,6 +2019,20 @@ std::ostream &operator<<(std::ostream &s, const Message &m) {
          s << "status: " << mm.status() << ", path: " << mm.path() << ", filebrowser: " << mm.filebrowserId();
          break;
       }
+      case DATATRANSFERSTATE: {
+         auto &mm = static_cast<const DataTransferState &>(m);
+         s << ", in transit: " << mm.numTransferring();
+         if (mm.hasTransferStatistics()) {
+            s << ", sent " << mm.objectName() << ": " << mm.rawSize() << " -> " << mm.sentSize() << " bytes, field compression: " << mm.fieldCompression()
+              << ", compression: " << mm.compression() << ", " << mm.compressionTime() << " s, bandwidth: " << mm.bandwidth()/1e6 << " MB/s";
+         }
+         break;
+      }
+      case PAYLOADSTRIPE: {
+         auto &mm = static_cast<const PayloadStripe &>(m);
+         s << ", transfer: " << mm.transferId() << ", stripe: " << mm.index() << "/" << mm.numStripes() << ", offset: " << mm.offset() << ", total: " << mm.totalSize();
+         break;
+      }
       default:
          break;
    }
@@ -294,7 +294,11 @@ class V_COREEXPORT Execute: public MessageBase<Execute, EXECUTE> {
    void setWhat(What r);
 
    double animationRealTime() const;
+   void setAnimationRealTime(double time);
    double animationStepDuration() const;
+   void setAnimationStepDuration(double duration);
+   //! whether animation time and step duration have been set by the sender
+   bool hasAnimationTime() const;
 
 private:
    bool m_allRanks; //!< whether execute should be broadcasted across all MPI ranks
@@ -303,6 +307,7 @@ private:
    What m_what; //!< reason why this message was generated
    double m_realtime; //!< realtime/timestep currently displayed
    double m_animationStepDuration; //!< duration of a single timestep
+   bool m_haveAnimationTime; //!< whether m_realtime and m_animationStepDuration are valid
 };
 static_assert(sizeof(Execute) <= Message::MESSAGE_SIZE, "message too large");
 V_ENUM_OUTPUT_OP(What, Execute)
@@ -899,12 +904,20 @@ class V_COREEXPORT RequestObject: public MessageBase<RequestObject, REQUESTOBJEC
    const char *referrer() const;
    bool isArray() const;
    int arrayType() const;
+   //! throughput in bytes/s observed by the requester for transfers from the destination hub, 0 if unknown
+   void setBandwidth(double bytesPerSecond);
+   double bandwidth() const;
+   //! whether the sender may refer to an array with identical contents sent earlier instead of sending the elements
+   void setAllowAlias(bool allow);
+   bool allowAlias() const;
 
  private:
    shm_name_t m_objectId;
    shm_name_t m_referrer;
    bool m_array;
    int m_arrayType;
+   bool m_allowAlias = true;
+   double m_bandwidth = 0.;
 };
 static_assert(sizeof(RequestObject) <= Message::MESSAGE_SIZE, "message too large");
 
@@ -920,9 +933,31 @@ class V_COREEXPORT SendObject: public MessageBase<SendObject, SENDOBJECT> {
    Object::Type objectType() const;
    Meta objectMeta() const;
    bool isArray() const;
+   //! payload consists of the elements of an array without archive framing
+   void setRawArray(uint64_t size, const uint64_t dim[3], bool exact);
+   bool isRawArray() const;
+   uint64_t arraySize() const;
+   uint64_t arrayDimension(int c) const;
+   bool arrayExact() const;
+   //! seconds the sender spent on serializing and compressing the payload
+   void setCompressionTime(double seconds);
+   double compressionTime() const;
+   //! hash of array elements and layout, 0 if not computed
+   void setContentHash(uint64_t hash);
+   uint64_t contentHash() const;
+   //! no payload: contents are identical to an array with the same hash sent before
+   void setDuplicate(bool duplicate);
+   bool isDuplicate() const;
 
  private:
    bool m_array;
+   bool m_rawArray = false;
+   bool m_arrayExact = false;
+   bool m_duplicate = false;
+   uint64_t m_contentHash = 0;
+   uint64_t m_arraySize = 0;
+   uint64_t m_arrayDim[3] = {0, 1, 1};
+   double m_compressionTime = 0.;
    shm_name_t m_objectId;
    shm_name_t m_referrer;
    int m_objectType;
@@ -935,7 +970,7 @@ class V_COREEXPORT SendObject: public MessageBase<SendObject, SENDOBJECT> {
    int32_t m_creator;
    double m_realtime;
 };
-static_assert(sizeof(RequestObject) <= Message::MESSAGE_SIZE, "message too large");
+static_assert(sizeof(SendObject) <= Message::MESSAGE_SIZE, "message too large");
 
 class V_COREEXPORT FileQuery: public MessageBase<FileQuery, FILEQUERY> {
     friend class FileQueryResult;
@@ -983,14 +1018,60 @@ private:
 };
 static_assert(sizeof(FileQueryResult) <= Message::MESSAGE_SIZE, "message too large");
 
+//! no. of objects in transit, optionally with statistics of a completed transfer
 class V_COREEXPORT DataTransferState: public MessageBase<DataTransferState, DATATRANSFERSTATE> {
 public:
     DataTransferState(size_t numTransferring);
     size_t numTransferring() const;
 
+    //! attach statistics of sending an array or object
+    void setTransferStatistics(const std::string &name, int fieldCompression, CompressionMode compression,
+                               uint64_t rawSize, uint64_t sentSize, double compressionTime, double bandwidth);
+    bool hasTransferStatistics() const;
+    const char *objectName() const;
+    //! FieldCompressionMode applied to array elements
+    int fieldCompression() const;
+    CompressionMode compression() const;
+    uint64_t rawSize() const;
+    uint64_t sentSize() const;
+    //! seconds spent serializing and compressing
+    double compressionTime() const;
+    //! estimated link bandwidth in bytes/s the choice of compression was based on
+    double bandwidth() const;
+
 private:
     long m_numTransferring;
+    bool m_haveStatistics = false;
+    shm_name_t m_objectName;
+    int32_t m_fieldCompression = 0;
+    int32_t m_compression = CompressionNone;
+    uint64_t m_rawSize = 0, m_sentSize = 0;
+    double m_compressionTime = 0., m_bandwidth = 0.;
+};
+static_assert(sizeof(DataTransferState) <= Message::MESSAGE_SIZE, "message too large");
+
+//! part of a large payload transferred in parallel over several data connections between hubs
+class V_COREEXPORT PayloadStripe: public MessageBase<PayloadStripe, PAYLOADSTRIPE> {
+public:
+    PayloadStripe(uint64_t transferId, int index, int numStripes, uint64_t offset, uint64_t totalSize, size_t payloadSize);
+    //! identifies transfer together with sender id
+    uint64_t transferId() const;
+    //! index of stripe, -1 if payload is the message the striped payload belongs to
+    int index() const;
+    int numStripes() const;
+    //! position of stripe within complete payload
+    uint64_t offset() const;
+    //! size of complete payload
+    uint64_t totalSize() const;
+
+private:
+    uint64_t m_transferId;
+    uint64_t m_offset;
+    uint64_t m_totalSize;
+    int32_t m_index;
+    int32_t m_numStripes;
 };
+static_assert(sizeof(PayloadStripe) <= Message::MESSAGE_SIZE, "message too large");
 
 
 template<class Payload>
@@ -25,7 +25,7 @@ class V_COREEXPORT Ngons: public Coords, virtual public CelltreeInterface<3> {
    Index getNumCorners();
    Index getNumCorners() const;
 
-   shm<Index>::array &cl() { return *d()->cl; }
+   shm<Index>::array &cl() { if (d()->cl.makeUnique()) refresh(); return *d()->cl; }
    const Index *cl() const { return m_cl; }
 
    bool hasCelltree() const override;
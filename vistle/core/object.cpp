@@ -3,7 +3,10 @@
 #include "object_impl.h"
 
 #include "shm.h"
+#include "attributekeys.h"
 #include <cassert>
+#include <cstring>
+#include <set>
 
 #include "archives.h"
 #include <iostream>
@@ -45,31 +48,6 @@ void access::construct(vistle::shm<char>::string * t)
    ::new(t) vistle::shm<char>::string(vistle::Shm::the().allocator());
 }
 
-template<>
-void access::destroy(const vistle::Object::Data::AttributeList *t)
-{
-   const_cast<vistle::Object::Data::AttributeList *>(t)->~vector();
-}
-
-template<>
-void access::construct(vistle::Object::Data::AttributeList *t)
-{
-   ::new(t) vistle::Object::Data::AttributeList(vistle::Shm::the().allocator());
-}
-
-template<>
-void access::destroy(const vistle::ObjectData::AttributeMapValueType *t)
-{
-   const_cast<vistle::Object::Data::AttributeMapValueType *>(t)->~pair();
-}
-
-template<>
-void access::construct(vistle::Object::Data::AttributeMapValueType *t)
-{
-   ::new(t) vistle::Object::Data::AttributeMapValueType(vistle::Object::Data::Key(vistle::Shm::the().allocator()),
-         vistle::Object::Data::AttributeList(vistle::Shm::the().allocator()));
-}
-
 } // namespace serialization
 } // namespace boost
 #endif
@@ -165,7 +143,7 @@ ObjectData::ObjectData(const Object::Type type, const std::string & n, const Met
    , type(type)
    , unresolvedReferences(0)
    , meta(m)
-   , attributes(std::less<Key>(), Shm::the().allocator())
+   , attributes(Shm::the().allocator())
    , attachments(std::less<Key>(), Shm::the().allocator())
 {
 }
@@ -175,7 +153,7 @@ ObjectData::ObjectData(const Object::Data &o, const std::string &name, Object::T
 , type(id==Object::UNKNOWN ? o.type : id)
 , unresolvedReferences(0)
 , meta(o.meta)
-, attributes(std::less<Key>(), Shm::the().allocator())
+, attributes(Shm::the().allocator())
 , attachments(std::less<Key>(), Shm::the().allocator())
 {
    copyAttributes(&o, true);
@@ -519,94 +497,145 @@ std::vector<std::string> Object::getAttributeList() const {
    return d()->getAttributeList();
 }
 
+namespace {
+
+struct AttributeRecord {
+   uint32_t key;
+   uint32_t length; //!< no. of bytes of value following this header
+};
+
+const size_t AttributeAlignment = sizeof(uint32_t);
+
+size_t attributeRecordSize(size_t length) {
+   return sizeof(AttributeRecord) + (length+AttributeAlignment-1)/AttributeAlignment*AttributeAlignment;
+}
+
+void appendAttribute(ObjectData::AttributeArena &arena, uint32_t key, const std::string &value) {
+
+   AttributeRecord rec;
+   rec.key = key;
+   rec.length = value.length();
+   const size_t pos = arena.size();
+   arena.resize(pos + attributeRecordSize(rec.length), '\0');
+   memcpy(&arena[pos], &rec, sizeof(rec));
+   if (rec.length > 0)
+      memcpy(&arena[pos+sizeof(rec)], value.data(), rec.length);
+}
+
+//! call f(key, value, length) for all attribute records in order
+template<class Func>
+void forEachAttribute(const ObjectData::AttributeArena &arena, Func f) {
+
+   size_t pos = 0;
+   while (pos < arena.size()) {
+      AttributeRecord rec;
+      memcpy(&rec, &arena[pos], sizeof(rec));
+      f(rec.key, &arena[pos]+sizeof(rec), rec.length);
+      pos += attributeRecordSize(rec.length);
+   }
+   assert(pos == arena.size());
+}
+
+}
+
 void Object::Data::addAttribute(const std::string &key, const std::string &value) {
 
-   const Key skey(key.c_str(), Shm::the().allocator());
-   std::pair<AttributeMap::iterator, bool> res = attributes.insert(AttributeMapValueType(skey, AttributeList(Shm::the().allocator())));
-   AttributeList &a = res.first->second;
-   a.emplace_back(value.c_str(), Shm::the().allocator());
+   appendAttribute(attributes, AttributeKeys::id(key), value);
 }
 
 void Object::Data::setAttributeList(const std::string &key, const std::vector<std::string> &values) {
 
-   const Key skey(key.c_str(), Shm::the().allocator());
-   std::pair<AttributeMap::iterator, bool> res = attributes.insert(AttributeMapValueType(skey, AttributeList(Shm::the().allocator())));
-   AttributeList &a = res.first->second;
-   a.clear();
-   for (size_t i=0; i<values.size(); ++i) {
-      a.emplace_back(values[i].c_str(), Shm::the().allocator());
+   const uint32_t id = AttributeKeys::id(key);
+
+   // compact in place, dropping all previous values of key
+   size_t pos = 0, dest = 0;
+   while (pos < attributes.size()) {
+      AttributeRecord rec;
+      memcpy(&rec, &attributes[pos], sizeof(rec));
+      const size_t size = attributeRecordSize(rec.length);
+      if (rec.key != id) {
+         if (dest != pos)
+            memmove(&attributes[dest], &attributes[pos], size);
+         dest += size;
+      }
+      pos += size;
    }
+   attributes.resize(dest);
+
+   for (const auto &v: values)
+      appendAttribute(attributes, id, v);
 }
 
 void Object::Data::copyAttributes(const ObjectData *src, bool replace) {
 
    if (replace) {
-
       attributes = src->attributes;
    } else {
-
-      const AttributeMap &a = src->attributes;
-
-      for (AttributeMap::const_iterator it = a.begin(); it != a.end(); ++it) {
-         const Key &key = it->first;
-         const AttributeList &values = it->second;
-         std::pair<AttributeMap::iterator, bool> res = attributes.insert(AttributeMapValueType(key, values));
-         if (!res.second) {
-            AttributeList &dest = res.first->second;
-            if (replace)
-               dest.clear();
-            for (AttributeList::const_iterator ait = values.begin(); ait != values.end(); ++ait) {
-               dest.emplace_back(*ait);
-            }
-         }
-      }
+      attributes.insert(attributes.end(), src->attributes.begin(), src->attributes.end());
    }
 }
 
 bool Object::Data::hasAttribute(const std::string &key) const {
 
-   const Key skey(key.c_str(), Shm::the().allocator());
-   AttributeMap::const_iterator it = attributes.find(skey);
-   return it != attributes.end();
+   const uint32_t id = AttributeKeys::id(key, false);
+   if (id == AttributeKeys::Invalid)
+      return false;
+   bool found = false;
+   forEachAttribute(attributes, [id, &found](uint32_t k, const char *, uint32_t) {
+      if (k == id)
+         found = true;
+   });
+   return found;
 }
 
 std::string Object::Data::getAttribute(const std::string &key) const {
 
-   const Key skey(key.c_str(), Shm::the().allocator());
-   AttributeMap::const_iterator it = attributes.find(skey);
-   if (it == attributes.end())
-      return std::string();
-   const AttributeList &a = it->second;
-   if (a.empty())
+   const uint32_t id = AttributeKeys::id(key, false);
+   if (id == AttributeKeys::Invalid)
       return std::string();
-   return std::string(a.back().c_str(), a.back().length());
+   std::string value;
+   forEachAttribute(attributes, [id, &value](uint32_t k, const char *v, uint32_t len) {
+      if (k == id)
+         value.assign(v, len);
+   });
+   return value;
 }
 
 std::vector<std::string> Object::Data::getAttributes(const std::string &key) const {
 
-   const Key skey(key.c_str(), Shm::the().allocator());
-   AttributeMap::const_iterator it = attributes.find(skey);
-   if (it == attributes.end())
-      return std::vector<std::string>();
-   const AttributeList &a = it->second;
-
    std::vector<std::string> attrs;
-   for (AttributeList::const_iterator i = a.begin(); i != a.end(); ++i) {
-      attrs.push_back(i->c_str());
-   }
+   const uint32_t id = AttributeKeys::id(key, false);
+   if (id == AttributeKeys::Invalid)
+      return attrs;
+   forEachAttribute(attributes, [id, &attrs](uint32_t k, const char *v, uint32_t len) {
+      if (k == id)
+         attrs.emplace_back(v, len);
+   });
    return attrs;
 }
 
 std::vector<std::string> Object::Data::getAttributeList() const {
 
-   std::vector<std::string> result;
-   for (AttributeMap::const_iterator it = attributes.begin();
-         it != attributes.end();
-         ++it) {
-      auto key = it->first;
-      result.push_back(key.c_str());
-   }
-   return result;
+   std::set<uint32_t> ids;
+   forEachAttribute(attributes, [&ids](uint32_t k, const char *, uint32_t) {
+      ids.insert(k);
+   });
+   std::set<std::string> keys;
+   for (auto id: ids)
+      keys.insert(AttributeKeys::name(id));
+   return std::vector<std::string>(keys.begin(), keys.end());
+}
+
+Object::Data::StdAttributeMap Object::Data::getAttributeMap() const {
+
+   std::map<uint32_t, std::vector<std::string>> byId;
+   forEachAttribute(attributes, [&byId](uint32_t k, const char *v, uint32_t len) {
+      byId[k].emplace_back(v, len);
+   });
+   StdAttributeMap attrs;
+   for (auto &kv: byId)
+      attrs[AttributeKeys::name(kv.first)] = std::move(kv.second);
+   return attrs;
 }
 
 bool Object::addAttachment(const std::string &key, Object::const_ptr obj) const {
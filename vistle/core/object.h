@@ -233,17 +233,10 @@ struct ObjectData: public ShmData {
 
     Meta meta;
 
-    typedef shm<char>::string Attribute;
     typedef shm<char>::string Key;
-    typedef shm<Attribute>::vector AttributeList;
-    typedef std::pair<const Key, AttributeList> AttributeMapValueType;
-    typedef shm<AttributeMapValueType>::allocator AttributeMapAllocator;
-#ifdef NO_SHMEM
-    typedef std::map<Key, AttributeList, std::less<Key>, AttributeMapAllocator> AttributeMap;
-#else
-    typedef interprocess::map<Key, AttributeList, std::less<Key>, AttributeMapAllocator> AttributeMap;
-#endif
-    AttributeMap attributes;
+    //! attribute records in order of addition: interned key id (see AttributeKeys), value length, value padded to 4 bytes
+    typedef shm<char>::vector AttributeArena;
+    AttributeArena attributes;
     typedef std::map<std::string, std::vector<std::string>> StdAttributeMap; // for serialization
     void addAttribute(const std::string &key, const std::string &value = "");
     V_COREEXPORT void setAttributeList(const std::string &key, const std::vector<std::string> &values);
@@ -251,6 +244,7 @@ struct ObjectData: public ShmData {
     bool hasAttribute(const std::string &key) const;
     std::string getAttribute(const std::string &key) const;
     V_COREEXPORT std::vector<std::string> getAttributes(const std::string &key) const;
+    V_COREEXPORT StdAttributeMap getAttributeMap() const;
     V_COREEXPORT std::vector<std::string> getAttributeList() const;
 
 #ifdef NO_SHMEM
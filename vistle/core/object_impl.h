@@ -16,18 +16,6 @@ V_COREEXPORT void access::destroy(const vistle::shm<char>::string *t);
 template<>
 V_COREEXPORT void access::construct(vistle::shm<char>::string *t);
 
-template<>
-V_COREEXPORT void access::destroy(const vistle::Object::Data::AttributeList *t);
-
-template<>
-V_COREEXPORT void access::construct(vistle::Object::Data::AttributeList *t);
-
-template<>
-V_COREEXPORT void access::destroy(const vistle::Object::Data::AttributeMapValueType *t);
-
-template<>
-V_COREEXPORT void access::construct(vistle::Object::Data::AttributeMapValueType *t);
-
 } // namespace serialization
 } // namespace boost
 #endif
@@ -44,11 +32,7 @@ void Object::serialize(Archive &ar)
 template<class Archive>
 void Object::Data::save(Archive &ar) const {
    ar & V_NAME(ar, "meta", meta);
-   StdAttributeMap attrMap;
-   auto attrs = getAttributeList();
-   for (auto a: attrs) {
-       attrMap[a] = getAttributes(a);
-   }
+   StdAttributeMap attrMap = getAttributeMap();
    ar & V_NAME(ar, "attributes", attrMap);
 }
 
@@ -0,0 +1,220 @@
+#include "profiler.h"
+
+#include <cstdlib>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+namespace vistle {
+
+namespace {
+
+thread_local int t_owner = 0;
+
+const char *categoryName(int category) {
+
+   switch (category) {
+   case Profiler::Execute: return "execute";
+   case Profiler::Task: return "task";
+   case Profiler::Message: return "message";
+   case Profiler::Shm: return "shm";
+   case Profiler::Transfer: return "transfer";
+   }
+   return "other";
+}
+
+void writeEscaped(std::ostream &os, const std::string &str) {
+
+   for (char c: str) {
+      if (c == '"' || c == '\\')
+         os << '\\' << c;
+      else if (static_cast<unsigned char>(c) < 0x20)
+         os << ' ';
+      else
+         os << c;
+   }
+}
+
+const char TraceHeader[] = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+const char TraceFooter[] = "\n]}\n";
+
+}
+
+struct Profiler::ThreadBuffer {
+   std::mutex mutex;
+   std::vector<Event> events;
+   size_t numRecorded = 0; //!< total no. of events recorded into ring buffer
+   int thread = 0;
+};
+
+std::atomic<int> Profiler::s_numEnabled(0);
+
+Profiler::Profiler() {
+}
+
+Profiler &Profiler::the() {
+
+   static Profiler profiler;
+   return profiler;
+}
+
+void Profiler::enable(bool on) {
+
+   if (on)
+      ++s_numEnabled;
+   else
+      --s_numEnabled;
+}
+
+void Profiler::setOwner(int owner) {
+
+   t_owner = owner;
+}
+
+int Profiler::owner() {
+
+   return t_owner;
+}
+
+int64_t Profiler::now() {
+
+   using namespace std::chrono;
+   return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+Profiler::ThreadBuffer &Profiler::threadBuffer() {
+
+   thread_local std::shared_ptr<ThreadBuffer> buf;
+   if (!buf) {
+      buf = std::make_shared<ThreadBuffer>();
+      buf->events.resize(BufferSize);
+      std::lock_guard<std::mutex> guard(m_mutex);
+      buf->thread = m_numThreads++;
+      m_buffers.push_back(buf);
+   }
+   return *buf;
+}
+
+void Profiler::record(const char *name, int category, int64_t start, int64_t duration, int64_t arg) {
+
+   auto &buf = threadBuffer();
+   std::lock_guard<std::mutex> guard(buf.mutex);
+   auto &ev = buf.events[buf.numRecorded % BufferSize];
+   ev.name = name;
+   ev.category = category;
+   ev.owner = t_owner;
+   ev.thread = buf.thread;
+   ev.start = start;
+   ev.duration = duration;
+   ev.arg = arg;
+   ++buf.numRecorded;
+}
+
+std::vector<Profiler::Event> Profiler::collect(int owner) {
+
+   std::vector<Event> result;
+
+   std::lock_guard<std::mutex> guard(m_mutex);
+   for (auto &buf: m_buffers) {
+      std::lock_guard<std::mutex> bufGuard(buf->mutex);
+      const size_t n = std::min(buf->numRecorded, BufferSize);
+      const size_t first = buf->numRecorded - n;
+      // keep events of other owners, in order
+      size_t numKept = 0;
+      std::vector<Event> kept;
+      for (size_t i=first; i<buf->numRecorded; ++i) {
+         const auto &ev = buf->events[i % BufferSize];
+         if (ev.owner == owner)
+            result.push_back(ev);
+         else
+            kept.push_back(ev);
+      }
+      for (const auto &ev: kept)
+         buf->events[numKept++] = ev;
+      buf->numRecorded = numKept;
+   }
+
+   // buffers of terminated threads are referenced only from here
+   m_buffers.erase(std::remove_if(m_buffers.begin(), m_buffers.end(), [](const std::shared_ptr<ThreadBuffer> &buf) {
+      return buf.use_count() == 1 && buf->numRecorded == 0;
+   }), m_buffers.end());
+
+   std::sort(result.begin(), result.end(), [](const Event &a, const Event &b) { return a.start < b.start; });
+   return result;
+}
+
+std::string Profiler::toJson(const std::vector<Event> &events, int pid, const std::string &processName) {
+
+   std::stringstream str;
+   str << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"args\":{\"name\":\"";
+   writeEscaped(str, processName);
+   str << "\"}}";
+   for (const auto &ev: events) {
+      str << ",\n{\"name\":\"";
+      writeEscaped(str, ev.name ? ev.name : "");
+      str << "\",\"cat\":\"" << categoryName(ev.category) << "\",\"ph\":\"X\""
+          << ",\"ts\":" << ev.start << ",\"dur\":" << ev.duration
+          << ",\"pid\":" << pid << ",\"tid\":" << ev.thread;
+      if (ev.category == Shm || ev.category == Transfer)
+         str << ",\"args\":{\"bytes\":" << ev.arg << "}";
+      else
+         str << ",\"args\":{\"arg\":" << ev.arg << "}";
+      str << "}";
+   }
+   return str.str();
+}
+
+bool Profiler::writeTrace(const std::string &filename, const std::vector<std::string> &fragments) {
+
+   std::ofstream f(filename);
+   if (!f) {
+      std::cerr << "Profiler: failed to open " << filename << " for writing" << std::endl;
+      return false;
+   }
+   f << TraceHeader;
+   bool first = true;
+   for (const auto &frag: fragments) {
+      if (frag.empty())
+         continue;
+      if (!first)
+         f << ",\n";
+      f << frag;
+      first = false;
+   }
+   f << TraceFooter;
+   return bool(f);
+}
+
+bool Profiler::mergeTraces(const std::vector<std::string> &files, const std::string &filename) {
+
+   std::vector<std::string> fragments;
+   for (const auto &file: files) {
+      std::ifstream f(file);
+      if (!f) {
+         std::cerr << "Profiler: failed to open " << file << std::endl;
+         return false;
+      }
+      std::stringstream str;
+      str << f.rdbuf();
+      std::string trace = str.str();
+      const std::string header(TraceHeader), footer(TraceFooter);
+      if (trace.compare(0, header.size(), header) != 0 || trace.size() < header.size()+footer.size()
+            || trace.compare(trace.size()-footer.size(), footer.size(), footer) != 0) {
+         std::cerr << "Profiler: " << file << " was not written by Vistle" << std::endl;
+         return false;
+      }
+      fragments.push_back(trace.substr(header.size(), trace.size()-header.size()-footer.size()));
+   }
+   return writeTrace(filename, fragments);
+}
+
+std::string Profiler::traceDirectory() {
+
+   if (const char *dir = getenv("VISTLE_TRACE_DIR"))
+      return dir;
+   return ".";
+}
+
+} // namespace vistle
@@ -0,0 +1,111 @@
+#ifndef VISTLE_PROFILER_H
+#define VISTLE_PROFILER_H
+
+#include "export.h"
+
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vistle {
+
+//! record spans of execution, messaging, shared memory allocation and data transfer for export in Chrome/Perfetto trace format
+/*!
+ * Events are kept in per-thread ring buffers, so that recording does not contend with other threads.
+ * Nothing is recorded unless recording has been enabled at least once more than it has been disabled.
+ * Events are tagged with the owner of the recording thread, so that modules running as threads within the same process
+ * only collect their own events.
+ */
+class V_COREEXPORT Profiler {
+
+ public:
+   enum Category {
+      Execute, //!< prepare, compute and reduce
+      Task, //!< PortTask run by a worker thread
+      Message, //!< message handling and sending
+      Shm, //!< shared memory allocation
+      Transfer, //!< data transfer between ranks or hubs
+   };
+
+   struct Event {
+      const char *name = nullptr; //!< has to remain valid for the lifetime of the process
+      int category = Execute;
+      int owner = 0; //!< module which recorded the event, 0 for the manager
+      int thread = 0;
+      int64_t start = 0; //!< microseconds since epoch
+      int64_t duration = 0; //!< microseconds
+      int64_t arg = 0; //!< e.g. size in bytes
+   };
+
+   static const size_t BufferSize = 1<<15; //!< no. of events kept per thread
+
+   static Profiler &the();
+
+   static bool enabled() { return s_numEnabled.load(std::memory_order_relaxed) > 0; }
+   //! nested enabling/disabling of recording
+   void enable(bool on);
+
+   //! set module id for events recorded by the calling thread
+   static void setOwner(int owner);
+   static int owner();
+
+   //! microseconds since epoch, comparable between processes on synchronized hosts
+   static int64_t now();
+
+   void record(const char *name, int category, int64_t start, int64_t duration, int64_t arg=0);
+   //! remove and return all events of owner recorded so far, ordered by start time
+   std::vector<Event> collect(int owner);
+
+   //! trace event objects for events, separated by commas, to be placed into a traceEvents array
+   static std::string toJson(const std::vector<Event> &events, int pid, const std::string &processName);
+   //! write trace file from fragments created with toJson
+   static bool writeTrace(const std::string &filename, const std::vector<std::string> &fragments);
+   //! combine trace files written with writeTrace into one
+   static bool mergeTraces(const std::vector<std::string> &files, const std::string &filename);
+   //! directory for trace files: VISTLE_TRACE_DIR or working directory
+   static std::string traceDirectory();
+
+ private:
+   struct ThreadBuffer;
+
+   Profiler();
+   ThreadBuffer &threadBuffer();
+
+   static std::atomic<int> s_numEnabled;
+
+   std::mutex m_mutex;
+   std::vector<std::shared_ptr<ThreadBuffer>> m_buffers;
+   int m_numThreads = 0;
+};
+
+//! record a span lasting from construction to destruction, nothing is recorded for a null name
+class V_COREEXPORT ProfileSpan {
+
+ public:
+   ProfileSpan(const char *name, int category, int64_t arg=0)
+   : m_name(name), m_category(category), m_arg(arg)
+   {
+      if (name && Profiler::enabled())
+         m_start = Profiler::now();
+   }
+   ~ProfileSpan() {
+      if (m_start >= 0)
+         Profiler::the().record(m_name, m_category, m_start, Profiler::now()-m_start, m_arg);
+   }
+   void setArg(int64_t arg) { m_arg = arg; }
+
+ private:
+   ProfileSpan(const ProfileSpan &) = delete;
+   ProfileSpan &operator=(const ProfileSpan &) = delete;
+
+   const char *m_name;
+   int m_category;
+   int64_t m_arg;
+   int64_t m_start = -1;
+};
+
+} // namespace vistle
+#endif
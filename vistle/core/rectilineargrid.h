@@ -39,7 +39,7 @@ public:
    void setNumGhostLayers(unsigned dim, GhostLayerPosition pos, unsigned value) override;
 
    // get/set functions for shared memory members
-   shm<Scalar>::array & coords(int c) { return *d()->coords[c]; }
+   shm<Scalar>::array & coords(int c) { if (d()->coords[c].makeUnique()) refresh(); return *d()->coords[c]; }
    const Scalar * coords(int c) const { return m_coords[c]; }
 
    // GridInterface
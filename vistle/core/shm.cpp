@@ -16,7 +16,10 @@
 #include <cassert>
 
 #include "archives.h"
+#include "attributekeys.h"
 #include "shm.h"
+#include "shmconfig.h"
+#include "shmslab.h"
 #include "shm_reference.h"
 #include "object.h"
 #include "shm_reference_impl.h"
@@ -113,6 +116,26 @@ Shm::Shm(const std::string &name, const int m, const int r, size_t size, bool cr
       m_shmDeletionMutex = m_shm->find_or_construct<boost::interprocess::interprocess_recursive_mutex>("shmdelete_mutex")();
       m_objectDictionaryMutex = m_shm->find_or_construct<boost::interprocess::interprocess_recursive_mutex>("shm_dictionary_mutex")();
 
+      // placement policy is chosen by the creator of the segment and shared with everyone attaching to it
+      if (create) {
+         ShmConfig *config = m_shm->find_or_construct<ShmConfig>("shm_config")(ShmConfig::current());
+         *config = ShmConfig::current();
+      } else if (const ShmConfig *config = m_shm->find<ShmConfig>("shm_config").first) {
+         ShmConfig::setCurrent(*config);
+      }
+      ShmConfig::current().applyToSegment(m_shm->get_address(), m_shm->get_size(), create);
+
+      ShmSlab::Pool *slabPool = nullptr;
+      if (create) {
+         if (ShmConfig::current().slabAllocator)
+            slabPool = m_shm->find_or_construct<ShmSlab::Pool>("shm_slab_pool")();
+      } else {
+         slabPool = m_shm->find<ShmSlab::Pool>("shm_slab_pool").first;
+      }
+      ShmSlab::attach(m_shm->get_address(), slabPool);
+
+      AttributeKeys::attach(m_shm->find_or_construct<AttributeKeys::Table>("attribute_keys")(allocator()));
+
 #ifdef SHMDEBUG
       s_shmdebugMutex = m_shm->find_or_construct<boost::interprocess::interprocess_recursive_mutex>("shmdebug_mutex")();
       s_shmdebug = m_shm->find_or_construct<vistle::shm<ShmDebugInfo>::vector>("shmdebug")(0, ShmDebugInfo(), allocator());
@@ -129,6 +152,8 @@ Shm::~Shm() {
       shared_memory_object::remove(m_name.c_str());
       std::cerr << "removed shm " << m_name << std::endl;
    }
+   ShmSlab::attach(nullptr, nullptr);
+   AttributeKeys::attach(nullptr);
    delete m_shm;
 #endif
 
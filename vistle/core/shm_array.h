@@ -6,12 +6,18 @@
 #include <cstring>
 #include <type_traits>
 
+#include <boost/interprocess/exceptions.hpp>
+
 #include <vistle/util/exception.h>
 #include <vistle/util/tools.h>
 #include "export.h"
 #include "index.h"
 #include "archives_config.h"
 #include "shmdata.h"
+#include "shmconfig.h"
+#include "shmslab.h"
+#include "shmspill.h"
+#include "profiler.h"
 
 namespace vistle {
 
@@ -162,9 +168,11 @@ class shm_array: public ShmData {
        m_dim[1] = sy;
        m_dim[2] = sz;
    }
+   size_t dimensionHint(int c) const { return m_dim[c]; }
    void setExact(bool exact) {
        m_exact = exact;
    }
+   bool exact() const { return m_exact; }
 
    size_t capacity() const { return m_capacity; }
    void reserve(const size_t new_capacity) {
@@ -172,7 +180,9 @@ class shm_array: public ShmData {
            reserve_or_shrink(new_capacity);
    }
    void reserve_or_shrink(const size_t capacity) {
-      pointer new_data = capacity>0 ? m_allocator.allocate(capacity) : nullptr;
+      pointer new_data = capacity>0 ? allocate_storage(capacity) : nullptr;
+      if (new_data)
+         shmPlaceArray(&*new_data, sizeof(T)*capacity);
       const size_t n = capacity<m_size ? capacity : m_size;
       if (m_data && new_data) {
          if (std::is_trivially_copyable<T>::value) {
@@ -189,14 +199,51 @@ class shm_array: public ShmData {
                m_data[i].~T();
             }
          }
-         m_allocator.deallocate(m_data, m_capacity);
+         deallocate_storage(m_data, m_capacity);
       }
       m_data = new_data;
       m_capacity = capacity;
    }
    void shrink_to_fit() { reserve_or_shrink(m_size); assert(m_capacity == m_size); }
 
+   //! replace contents, dimension hint and exactness with those of other
+   void copyFrom(const shm_array &other) {
+      resize(other.size());
+      if (std::is_trivially_copyable<T>::value) {
+         if (m_size > 0)
+            ::memcpy(&*m_data, &*other.m_data, sizeof(T)*m_size);
+      } else {
+         for (size_t i=0; i<m_size; ++i)
+            m_data[i] = other.m_data[i];
+      }
+      for (int c=0; c<3; ++c)
+         m_dim[c] = other.m_dim[c];
+      m_exact = other.m_exact;
+   }
+
  private:
+   // small buffers in shared memory bypass the segment manager
+   pointer allocate_storage(const size_t n) {
+      ProfileSpan span("allocate", Profiler::Shm, sizeof(T)*n);
+      if (is_shm_allocator<allocator>::value && ShmSlab::handles(sizeof(T)*n))
+         return pointer(static_cast<T *>(ShmSlab::allocate(sizeof(T)*n)));
+      try {
+         return m_allocator.allocate(n);
+      } catch (const boost::interprocess::bad_alloc &) {
+         // segment is full: spilling is left to the next memory pressure check
+         if (is_shm_allocator<allocator>::value)
+            ShmSpill::allocationFailed(sizeof(T)*n);
+         throw;
+      }
+   }
+   void deallocate_storage(pointer p, const size_t n) {
+      if (is_shm_allocator<allocator>::value && ShmSlab::handles(sizeof(T)*n)) {
+         ShmSlab::deallocate(&*p, sizeof(T)*n);
+         return;
+      }
+      m_allocator.deallocate(p, n);
+   }
+
    const uint32_t m_type;
    size_t m_size = 0;
    size_t m_dim[3] = {0, 1, 1};
@@ -126,6 +126,9 @@ class shm_array_ref {
    const shm_name_t &name() const;
    int refcount() const;
 
+   //! copy-on-write: replace shared array with a private copy before it is modified, returns true if copied
+   bool makeUnique();
+
    void ref() {
        if (m_p) {
            assert(!m_name.empty());
@@ -121,6 +121,18 @@ int shm_array_ref<T>::refcount() const {
     return -1;
 }
 
+template<class T>
+bool shm_array_ref<T>::makeUnique() {
+    if (!m_p || m_p->refcount() <= 1)
+        return false;
+
+    shm_array_ref copy;
+    copy.construct();
+    copy->copyFrom(*m_p);
+    *this = copy;
+    return true;
+}
+
 template<class T>
 const shm_name_t &shm_array_ref<T>::name() const {
     return m_name;
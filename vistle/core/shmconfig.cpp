@@ -0,0 +1,205 @@
+#include "shmconfig.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+
+namespace vistle {
+
+namespace {
+
+ShmConfig s_current;
+
+#ifdef __linux__
+size_t pageSize() {
+   static const size_t size = sysconf(_SC_PAGESIZE);
+   return size;
+}
+
+//! parse list of online NUMA nodes, e.g. "0-1,4"
+std::vector<unsigned long> onlineNodeMask(unsigned long &maxNode) {
+
+   const size_t bits = 8*sizeof(unsigned long);
+   std::vector<unsigned long> mask;
+   maxNode = 0;
+
+   std::ifstream online("/sys/devices/system/node/online");
+   std::string list;
+   if (online)
+      std::getline(online, list);
+   if (list.empty())
+      list = "0";
+
+   std::stringstream str(list);
+   std::string range;
+   while (std::getline(str, range, ',')) {
+      unsigned long first = 0, last = 0;
+      auto dash = range.find('-');
+      first = strtoul(range.c_str(), nullptr, 10);
+      last = dash==std::string::npos ? first : strtoul(range.c_str()+dash+1, nullptr, 10);
+      for (unsigned long n=first; n<=last; ++n) {
+         if (mask.size() <= n/bits)
+            mask.resize(n/bits+1);
+         mask[n/bits] |= 1UL << (n%bits);
+         maxNode = std::max(maxNode, n+1);
+      }
+   }
+   // kernel ignores the last bit of maxnode
+   ++maxNode;
+   if (mask.size()*bits < maxNode)
+      mask.resize(mask.size()+1);
+   return mask;
+}
+#endif
+
+}
+
+ShmConfig ShmConfig::fromEnvironment() {
+
+   ShmConfig config;
+
+   if (const char *hp = getenv("VISTLE_SHM_HUGEPAGES")) {
+      std::string val(hp);
+      if (boost::iequals(val, "thp") || boost::iequals(val, "transparent") || boost::iequals(val, "on") || val == "1")
+         config.hugePages = HugePagesTransparent;
+      else if (boost::iequals(val, "off") || val == "0" || val.empty())
+         config.hugePages = HugePagesOff;
+      else
+         std::cerr << "ShmConfig: ignoring unknown value " << val << " for VISTLE_SHM_HUGEPAGES" << std::endl;
+   }
+
+   if (const char *numa = getenv("VISTLE_SHM_NUMA")) {
+      std::string val(numa);
+      if (boost::iequals(val, "interleave"))
+         config.numaPolicy = NumaInterleave;
+      else if (boost::iequals(val, "firsttouch") || boost::iequals(val, "local"))
+         config.numaPolicy = NumaFirstTouch;
+      else if (boost::iequals(val, "default") || val.empty())
+         config.numaPolicy = NumaDefault;
+      else
+         std::cerr << "ShmConfig: ignoring unknown value " << val << " for VISTLE_SHM_NUMA" << std::endl;
+   }
+
+   if (const char *threshold = getenv("VISTLE_SHM_NUMA_THRESHOLD")) {
+      config.largeArrayBytes = strtoull(threshold, nullptr, 10);
+   }
+
+   if (const char *slab = getenv("VISTLE_SHM_SLAB")) {
+      config.slabAllocator = atoi(slab) != 0;
+   }
+
+   return config;
+}
+
+std::string ShmConfig::toString() const {
+
+   std::stringstream str;
+   str << "huge pages: ";
+   switch (hugePages) {
+   case HugePagesOff: str << "off"; break;
+   case HugePagesTransparent: str << "transparent"; break;
+   default: str << "unknown (" << hugePages << ")"; break;
+   }
+   str << ", NUMA: ";
+   switch (numaPolicy) {
+   case NumaDefault: str << "default"; break;
+   case NumaInterleave: str << "interleave"; break;
+   case NumaFirstTouch: str << "first touch"; break;
+   default: str << "unknown (" << numaPolicy << ")"; break;
+   }
+   if (numaPolicy != NumaDefault)
+      str << " for arrays >= " << largeArrayBytes << " bytes";
+   str << ", small array slabs: " << (slabAllocator ? "on" : "off");
+   return str.str();
+}
+
+void ShmConfig::applyToSegment(void *addr, size_t size, bool create) const {
+
+#if defined(__linux__) && !defined(NO_SHMEM)
+   if (hugePages == HugePagesTransparent) {
+#ifdef MADV_HUGEPAGE
+      // advice applies to the mapping of this process only
+      if (madvise(addr, size, MADV_HUGEPAGE) != 0) {
+         std::cerr << "ShmConfig: failed to enable transparent huge pages: " << strerror(errno) << std::endl;
+      }
+#else
+      std::cerr << "ShmConfig: transparent huge pages not supported" << std::endl;
+#endif
+   }
+
+   if (create && numaPolicy == NumaInterleave) {
+      // policy is stored with the shared memory object and thus applies to all processes
+      unsigned long maxNode = 0;
+      auto mask = onlineNodeMask(maxNode);
+      if (syscall(SYS_mbind, addr, size, MPOL_INTERLEAVE, mask.data(), maxNode, 0) != 0) {
+         std::cerr << "ShmConfig: failed to interleave segment across NUMA nodes: " << strerror(errno) << std::endl;
+      }
+   }
+#else
+   (void)addr;
+   (void)size;
+   (void)create;
+#endif
+}
+
+void ShmConfig::applyToArray(void *addr, size_t size) const {
+
+#if defined(__linux__) && !defined(NO_SHMEM) && defined(MADV_REMOVE)
+   if (numaPolicy == NumaDefault || size < largeArrayBytes)
+      return;
+
+   // memory recycled by the allocator keeps its pages on the node where they have been touched before:
+   // release all pages that belong exclusively to this allocation,
+   // so that the next access allocates them according to the policy of the segment
+   // (interleaved or local to the writing thread)
+   const size_t page = pageSize();
+   uintptr_t begin = (reinterpret_cast<uintptr_t>(addr)+page-1)/page*page;
+   uintptr_t end = (reinterpret_cast<uintptr_t>(addr)+size)/page*page;
+   if (end <= begin)
+      return;
+   if (madvise(reinterpret_cast<void *>(begin), end-begin, MADV_REMOVE) != 0) {
+      static bool warned = false;
+      if (!warned) {
+         std::cerr << "ShmConfig: failed to release pages for placement of large array: " << strerror(errno) << std::endl;
+         warned = true;
+      }
+   }
+#else
+   (void)addr;
+   (void)size;
+#endif
+}
+
+const ShmConfig &ShmConfig::current() {
+
+   return s_current;
+}
+
+void ShmConfig::setCurrent(const ShmConfig &config) {
+
+   s_current = config;
+}
+
+void shmPlaceArray(void *addr, size_t size) {
+
+   const auto &config = ShmConfig::current();
+   if (config.numaPolicy == ShmConfig::NumaDefault)
+      return;
+   config.applyToArray(addr, size);
+}
+
+} // namespace vistle
@@ -0,0 +1,54 @@
+#ifndef VISTLE_SHMCONFIG_H
+#define VISTLE_SHMCONFIG_H
+
+#include "export.h"
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace vistle {
+
+//! page size and NUMA placement policy for the shared memory segment
+/*!
+ * The configuration is chosen by the creator of the segment (see ShmConfig::setCurrent) and stored within the segment,
+ * so that all processes attaching to it apply the same policy.
+ */
+struct V_COREEXPORT ShmConfig {
+
+   enum HugePages {
+      HugePagesOff, //!< default page size
+      HugePagesTransparent, //!< advise kernel to back segment with transparent huge pages
+   };
+
+   enum NumaPolicy {
+      NumaDefault, //!< leave placement to the kernel
+      NumaInterleave, //!< interleave pages of segment across all NUMA nodes
+      NumaFirstTouch, //!< place pages of large arrays on the node of the rank/thread writing them first
+   };
+
+   int32_t hugePages = HugePagesOff;
+   int32_t numaPolicy = NumaDefault;
+   uint64_t largeArrayBytes = 4*1024*1024; //!< arrays at least this large are placed individually
+   int32_t slabAllocator = 1; //!< serve small arrays from ShmSlab
+
+   //! read configuration from VISTLE_SHM_HUGEPAGES (off|thp), VISTLE_SHM_NUMA (default|interleave|firsttouch),
+   //! VISTLE_SHM_NUMA_THRESHOLD (in bytes) and VISTLE_SHM_SLAB (0|1)
+   static ShmConfig fromEnvironment();
+   std::string toString() const;
+
+   //! apply configuration to the mapping of the segment in the calling process
+   void applyToSegment(void *addr, size_t size, bool create) const;
+   //! apply configuration to memory freshly allocated for an array of size bytes
+   void applyToArray(void *addr, size_t size) const;
+
+   //! configuration in effect for the segment attached by this process
+   static const ShmConfig &current();
+   static void setCurrent(const ShmConfig &config);
+};
+
+//! place memory allocated for large arrays according to the current ShmConfig
+V_COREEXPORT void shmPlaceArray(void *addr, size_t size);
+
+} // namespace vistle
+#endif
@@ -0,0 +1,201 @@
+#include "shmring.h"
+
+#include <cstring>
+#include <cassert>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#endif
+
+namespace vistle {
+
+namespace {
+
+const char Magic[16] = "vistle shmring1";
+const int MaxSpin = 1000;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "ShmRing requires lock-free 64 bit atomics");
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "ShmRing requires lock-free 32 bit atomics");
+static_assert((ShmRing::Capacity & (ShmRing::Capacity-1)) == 0, "ShmRing capacity has to be a power of 2");
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+   __builtin_ia32_pause();
+#endif
+}
+
+//! sleep until seq differs from expected, at most timeoutMs (-1: forever)
+void futexWait(std::atomic<uint32_t> &seq, uint32_t expected, int timeoutMs) {
+#ifdef __linux__
+   struct timespec ts, *pts = nullptr;
+   if (timeoutMs >= 0) {
+      ts.tv_sec = timeoutMs/1000;
+      ts.tv_nsec = (timeoutMs%1000)*1000000L;
+      pts = &ts;
+   }
+   // not FUTEX_PRIVATE_FLAG: waiter and waker live in different processes
+   syscall(SYS_futex, reinterpret_cast<uint32_t *>(&seq), FUTEX_WAIT, expected, pts, nullptr, 0);
+#else
+   (void)timeoutMs;
+   if (seq.load() == expected)
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+#endif
+}
+
+void futexWake(std::atomic<uint32_t> &seq) {
+#ifdef __linux__
+   syscall(SYS_futex, reinterpret_cast<uint32_t *>(&seq), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#else
+   (void)seq;
+#endif
+}
+
+//! block until ready() returns true or timeoutMs has elapsed, returns ready()
+template<class Ready>
+bool waitFor(std::atomic<uint32_t> &seq, std::atomic<uint32_t> &waiting, int timeoutMs, Ready ready) {
+
+   // spinning only helps if the other side can run concurrently
+   static const int spin = std::thread::hardware_concurrency() > 1 ? MaxSpin : 0;
+   for (int i=0; i<spin; ++i) {
+      if (ready())
+         return true;
+      cpuRelax();
+   }
+
+   const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+   for (;;) {
+      const uint32_t s = seq.load();
+      waiting.store(1);
+      // re-check after announcing, the other side checks for waiters after publishing its update
+      if (ready()) {
+         waiting.store(0, std::memory_order_relaxed);
+         return true;
+      }
+      int remain = -1;
+      if (timeoutMs >= 0) {
+         remain = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+         if (remain <= 0) {
+            waiting.store(0, std::memory_order_relaxed);
+            return ready();
+         }
+      }
+      futexWait(seq, s, remain);
+      waiting.store(0, std::memory_order_relaxed);
+      if (ready())
+         return true;
+   }
+}
+
+void notify(std::atomic<uint32_t> &seq, std::atomic<uint32_t> &waiting) {
+
+   if (waiting.load()) {
+      seq.fetch_add(1);
+      futexWake(seq);
+   }
+}
+
+}
+
+ShmRing::ShmRing()
+: m_head(0)
+, m_numPushed(0)
+, m_spaceSeq(0)
+, m_producerWaiting(0)
+, m_tail(0)
+, m_numPopped(0)
+, m_dataSeq(0)
+, m_consumerWaiting(0)
+{
+   memcpy(m_magic, Magic, sizeof(m_magic));
+}
+
+bool ShmRing::valid() const {
+
+   return memcmp(m_magic, Magic, sizeof(m_magic)) == 0;
+}
+
+size_t ShmRing::recordSize(size_t size) {
+
+   // 4 byte length prefix, records start at 8 byte boundaries
+   return (sizeof(uint32_t)+size+7)/8*8;
+}
+
+void ShmRing::copyIn(uint64_t pos, const void *src, size_t size) {
+
+   const size_t idx = pos & (Capacity-1);
+   const size_t first = std::min(size, Capacity-idx);
+   memcpy(m_data+idx, src, first);
+   if (first < size)
+      memcpy(m_data, static_cast<const char *>(src)+first, size-first);
+}
+
+void ShmRing::copyOut(uint64_t pos, void *dst, size_t size) const {
+
+   const size_t idx = pos & (Capacity-1);
+   const size_t first = std::min(size, Capacity-idx);
+   memcpy(dst, m_data+idx, first);
+   if (first < size)
+      memcpy(static_cast<char *>(dst)+first, m_data, size-first);
+}
+
+bool ShmRing::push(const void *msg, size_t size, bool block) {
+
+   assert(size > 0 && size <= MaxMessageSize);
+   const uint64_t need = recordSize(size);
+   const uint64_t head = m_head.load(std::memory_order_relaxed);
+   auto haveSpace = [this, head, need]() -> bool {
+      return Capacity - (head - m_tail.load()) >= need;
+   };
+   if (!haveSpace()) {
+      if (!block)
+         return false;
+      waitFor(m_spaceSeq, m_producerWaiting, -1, haveSpace);
+   }
+
+   const uint32_t len = size;
+   copyIn(head, &len, sizeof(len));
+   copyIn(head+sizeof(len), msg, size);
+   m_numPushed.fetch_add(1, std::memory_order_relaxed);
+   m_head.store(head+need);
+
+   notify(m_dataSeq, m_consumerWaiting);
+   return true;
+}
+
+size_t ShmRing::pop(void *msg, size_t maxSize, bool block, int timeoutMs) {
+
+   const uint64_t tail = m_tail.load(std::memory_order_relaxed);
+   auto haveData = [this, tail]() -> bool {
+      return m_head.load() != tail;
+   };
+   if (!haveData()) {
+      if (!block)
+         return 0;
+      if (!waitFor(m_dataSeq, m_consumerWaiting, timeoutMs, haveData))
+         return 0;
+   }
+
+   uint32_t len = 0;
+   copyOut(tail, &len, sizeof(len));
+   copyOut(tail+sizeof(len), msg, std::min(size_t(len), maxSize));
+   m_numPopped.fetch_add(1, std::memory_order_relaxed);
+   m_tail.store(tail+recordSize(len));
+
+   notify(m_spaceSeq, m_producerWaiting);
+   return len;
+}
+
+size_t ShmRing::numMessages() const {
+
+   const uint64_t popped = m_numPopped.load();
+   const uint64_t pushed = m_numPushed.load();
+   return pushed > popped ? pushed-popped : 0;
+}
+
+} // namespace vistle
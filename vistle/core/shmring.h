@@ -0,0 +1,63 @@
+#ifndef VISTLE_SHMRING_H
+#define VISTLE_SHMRING_H
+
+#include "export.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+
+namespace vistle {
+
+//! lock-free single-producer/single-consumer ring buffer of variable-size messages
+/*!
+ * The ring is meant to be placed into memory shared between two processes.
+ * Producer and consumer state reside on separate cache lines.
+ * A blocked side sleeps on a futex (on Linux, polling elsewhere), which is only signalled when a waiter has announced itself,
+ * so the uncontended path does not enter the kernel.
+ */
+class V_COREEXPORT ShmRing {
+
+ public:
+   static const size_t Capacity = 32*1024; //!< bytes, power of 2
+   static const size_t MaxMessageSize = Capacity/4;
+
+   ShmRing();
+   //! whether memory at this address has been initialized as a ring
+   bool valid() const;
+
+   //! append message of size (> 0) bytes, returns false if it does not fit and block is false
+   bool push(const void *msg, size_t size, bool block);
+   //! remove first message and copy at most maxSize bytes of it to msg, returns its size or 0 if none was available in time
+   size_t pop(void *msg, size_t maxSize, bool block, int timeoutMs=-1);
+   //! no. of messages currently queued
+   size_t numMessages() const;
+
+ private:
+   static const size_t CacheLine = 64;
+   static size_t recordSize(size_t size);
+   void copyIn(uint64_t pos, const void *src, size_t size);
+   void copyOut(uint64_t pos, void *dst, size_t size) const;
+
+   char m_magic[16];
+   char m_pad0[CacheLine-16];
+
+   // written by producer
+   std::atomic<uint64_t> m_head; //!< total no. of bytes written
+   std::atomic<uint64_t> m_numPushed;
+   std::atomic<uint32_t> m_spaceSeq; //!< futex for producer waiting for space
+   std::atomic<uint32_t> m_producerWaiting;
+   char m_pad1[CacheLine-24];
+
+   // written by consumer
+   std::atomic<uint64_t> m_tail; //!< total no. of bytes read
+   std::atomic<uint64_t> m_numPopped;
+   std::atomic<uint32_t> m_dataSeq; //!< futex for consumer waiting for data
+   std::atomic<uint32_t> m_consumerWaiting;
+   char m_pad2[CacheLine-24];
+
+   char m_data[Capacity];
+};
+
+} // namespace vistle
+#endif
@@ -0,0 +1,198 @@
+#include "shmslab.h"
+#include "shm.h"
+
+#include <new>
+#include <cassert>
+#include <mutex>
+#include <vector>
+
+#include <boost/interprocess/exceptions.hpp>
+
+namespace vistle {
+
+namespace {
+
+// free list heads: offset of block from segment base in units of Alignment (+1, 0 is end of list),
+// upper bits are incremented with every update to avoid ABA problems
+const size_t Alignment = 16;
+const int OffsetBits = 40;
+const uint64_t OffsetMask = (uint64_t(1) << OffsetBits) - 1;
+const uint64_t TagIncrement = uint64_t(1) << OffsetBits;
+
+const size_t ClassSizes[ShmSlab::NumClasses] = {
+   16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024
+};
+
+struct FreeBlock {
+   std::atomic<uint64_t> next;
+};
+
+const size_t MaxCached = 4*ShmSlab::BatchSize;
+
+//! free blocks of one size class available to this process only
+struct LocalCache {
+   std::mutex mutex;
+   std::vector<void *> blocks;
+};
+
+LocalCache &localCache(int cls) {
+   // never destroyed: caches are flushed when shared memory is detached, possibly during static destruction
+   static LocalCache *caches = new LocalCache[ShmSlab::NumClasses];
+   return caches[cls];
+}
+
+}
+
+ShmSlab::Pool *ShmSlab::s_pool = nullptr;
+char *ShmSlab::s_base = nullptr;
+
+ShmSlab::Pool::Pool() {
+
+   for (int c=0; c<NumClasses; ++c) {
+      head[c] = 0;
+      numSlabs[c] = 0;
+   }
+}
+
+void ShmSlab::attach(void *base, Pool *pool) {
+
+   static_assert(sizeof(ClassSizes)/sizeof(ClassSizes[0]) == NumClasses, "number of size classes inconsistent");
+   if (s_pool && s_pool != pool)
+      flush();
+   s_base = static_cast<char *>(base);
+   s_pool = pool;
+}
+
+int ShmSlab::sizeClass(size_t bytes) {
+
+   assert(bytes <= MaxBytes);
+   int cls = 0;
+   while (ClassSizes[cls] < bytes)
+      ++cls;
+   return cls;
+}
+
+size_t ShmSlab::classSize(int cls) {
+
+   return ClassSizes[cls];
+}
+
+void *ShmSlab::allocate(size_t bytes) {
+
+   assert(handles(bytes));
+   const int cls = sizeClass(bytes);
+   auto &cache = localCache(cls);
+
+   std::lock_guard<std::mutex> guard(cache.mutex);
+   if (cache.blocks.empty())
+      fetch(cls);
+   void *p = cache.blocks.back();
+   cache.blocks.pop_back();
+   return p;
+}
+
+void ShmSlab::deallocate(void *p, size_t bytes) {
+
+   assert(handles(bytes));
+   assert(p);
+   const int cls = sizeClass(bytes);
+   auto &cache = localCache(cls);
+
+   std::lock_guard<std::mutex> guard(cache.mutex);
+   cache.blocks.push_back(p);
+   if (cache.blocks.size() > MaxCached) {
+      // keep a batch for this process, make the others available to everyone
+      pushShared(cls, cache.blocks.data()+BatchSize, cache.blocks.size()-BatchSize);
+      cache.blocks.resize(BatchSize);
+   }
+}
+
+void *ShmSlab::popShared(int cls) {
+
+   auto &head = s_pool->head[cls];
+   uint64_t old = head.load(std::memory_order_acquire);
+   while (old & OffsetMask) {
+      auto block = reinterpret_cast<FreeBlock *>(s_base + ((old & OffsetMask)-1)*Alignment);
+      // block may be handed out concurrently, but memory stays valid: the tag detects this
+      const uint64_t next = block->next.load(std::memory_order_relaxed);
+      const uint64_t tagged = (next & OffsetMask) | ((old + TagIncrement) & ~OffsetMask);
+      if (head.compare_exchange_weak(old, tagged, std::memory_order_acquire, std::memory_order_acquire))
+         return block;
+   }
+   return nullptr;
+}
+
+void ShmSlab::pushShared(int cls, void *const *blocks, size_t count) {
+
+   if (count == 0)
+      return;
+
+   // link blocks and publish them with a single update
+   auto offset = [](void *p) -> uint64_t { return (static_cast<char *>(p) - s_base)/Alignment + 1; };
+   for (size_t i=0; i+1<count; ++i) {
+      auto block = new(blocks[i]) FreeBlock;
+      block->next.store(offset(blocks[i+1]), std::memory_order_relaxed);
+   }
+   auto last = new(blocks[count-1]) FreeBlock;
+   const uint64_t first = offset(blocks[0]);
+
+   auto &head = s_pool->head[cls];
+   uint64_t old = head.load(std::memory_order_relaxed);
+   do {
+      last->next.store(old & OffsetMask, std::memory_order_relaxed);
+   } while (!head.compare_exchange_weak(old, first | ((old + TagIncrement) & ~OffsetMask), std::memory_order_release, std::memory_order_relaxed));
+}
+
+void ShmSlab::fetch(int cls) {
+
+   auto &cache = localCache(cls);
+   assert(cache.blocks.empty());
+
+   while (cache.blocks.size() < BatchSize) {
+      void *p = popShared(cls);
+      if (!p)
+         break;
+      cache.blocks.push_back(p);
+   }
+   if (!cache.blocks.empty())
+      return;
+
+#ifdef NO_SHMEM
+   throw std::bad_alloc();
+#else
+   // only place where the lock of the segment manager is taken
+   const size_t size = ClassSizes[cls];
+   char *slab = nullptr;
+   try {
+      slab = static_cast<char *>(Shm::the().shm().allocate_aligned(SlabBytes, Alignment));
+   } catch (const boost::interprocess::bad_alloc &) {
+      // not enough contiguous space for a slab left: serve a single block from the segment manager,
+      // it is put on the free list of its size class when released
+      cache.blocks.push_back(Shm::the().shm().allocate_aligned(size, Alignment));
+      return;
+   }
+   ++s_pool->numSlabs[cls];
+
+   // keep a batch, make the other blocks available to everyone
+   const size_t count = SlabBytes/size;
+   assert(count >= 2);
+   std::vector<void *> blocks(count);
+   for (size_t i=0; i<count; ++i)
+      blocks[i] = slab + i*size;
+   const size_t keep = count < BatchSize ? count : size_t(BatchSize);
+   cache.blocks.assign(blocks.begin(), blocks.begin()+keep);
+   pushShared(cls, blocks.data()+keep, count-keep);
+#endif
+}
+
+void ShmSlab::flush() {
+
+   for (int cls=0; cls<NumClasses; ++cls) {
+      auto &cache = localCache(cls);
+      std::lock_guard<std::mutex> guard(cache.mutex);
+      pushShared(cls, cache.blocks.data(), cache.blocks.size());
+      cache.blocks.clear();
+   }
+}
+
+} // namespace vistle
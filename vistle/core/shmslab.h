@@ -0,0 +1,76 @@
+#ifndef VISTLE_SHMSLAB_H
+#define VISTLE_SHMSLAB_H
+
+#include "export.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <type_traits>
+
+#ifndef NO_SHMEM
+#include <boost/interprocess/allocators/allocator.hpp>
+#endif
+
+namespace vistle {
+
+//! size-class sub-allocator for small array buffers within the shared memory segment
+/*!
+ * Allocations of up to MaxBytes are served from slabs that each process obtains from the segment manager,
+ * so that the global lock of the segment manager is only taken when a slab is added.
+ * Each process keeps a small cache of free blocks per size class in front of lock-free lists within the segment,
+ * which it fills from and spills to in batches, so that ranks do not contend for every block.
+ * Blocks can be released by any process attached to the segment.
+ * If no slab can be added, single blocks are taken from the segment manager.
+ * Memory of slabs is never returned to the segment manager.
+ */
+class V_COREEXPORT ShmSlab {
+
+ public:
+   static const size_t MaxBytes = 1024; //!< larger allocations go to the segment manager
+   static const int NumClasses = 12;
+   static const size_t SlabBytes = 64*1024;
+   static const size_t BatchSize = 32; //!< blocks moved between process cache and shared list at once
+
+   //! state of all size classes, resides in shared memory
+   struct Pool {
+      Pool();
+      std::atomic<uint64_t> head[NumClasses]; //!< tagged offsets of first free blocks
+      std::atomic<uint64_t> numSlabs[NumClasses];
+   };
+
+   //! make pool within segment starting at base available to this process, nullptr: disable,
+   //! blocks cached for a previously attached pool are returned to it
+   static void attach(void *base, Pool *pool);
+   static bool enabled() { return s_pool != nullptr; }
+   //! whether an allocation of size bytes is served from slabs
+   static bool handles(size_t bytes) { return s_pool && bytes > 0 && bytes <= MaxBytes; }
+
+   //! allocate a block of at least bytes (<= MaxBytes), aligned to 16 bytes, throws std::bad_alloc
+   static void *allocate(size_t bytes);
+   //! release a block obtained from allocate with the same size
+   static void deallocate(void *p, size_t bytes);
+
+   static int sizeClass(size_t bytes);
+   static size_t classSize(int cls);
+
+ private:
+   static void *popShared(int cls);
+   static void pushShared(int cls, void *const *blocks, size_t count);
+   static void fetch(int cls);
+   static void flush();
+
+   static Pool *s_pool;
+   static char *s_base;
+};
+
+//! whether shm_array should try ShmSlab for allocations with allocator
+template<class Allocator>
+struct is_shm_allocator: std::false_type {};
+#ifndef NO_SHMEM
+template<class T, class SegmentManager>
+struct is_shm_allocator<boost::interprocess::allocator<T, SegmentManager>>: std::true_type {};
+#endif
+
+} // namespace vistle
+#endif
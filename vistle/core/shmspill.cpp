@@ -0,0 +1,391 @@
+#include "shmspill.h"
+#include "shm.h"
+#include "object.h"
+#include "archives.h"
+#include "archive_saver.h"
+#include "archive_loader.h"
+
+#include <vistle/util/filesystem.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstdint>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#ifdef __linux__
+#include <sys/statvfs.h>
+#include <unistd.h>
+#endif
+
+namespace vistle {
+
+std::atomic<size_t> ShmSpill::s_failedBytes(0);
+
+class ShmSpill::Entry {
+ public:
+   Object::const_ptr object; //!< null while spilled
+   std::string file;
+   std::list<Entry *>::iterator lru;
+   bool restoring = false;
+};
+
+namespace {
+
+template<typename T>
+bool writeValue(std::ofstream &out, const T &v) {
+   out.write(reinterpret_cast<const char *>(&v), sizeof(v));
+   return bool(out);
+}
+
+template<typename T>
+bool readValue(std::ifstream &in, T &v) {
+   in.read(reinterpret_cast<char *>(&v), sizeof(v));
+   return bool(in);
+}
+
+bool writeBuffer(std::ofstream &out, const std::string &name, char isArray, const char *data, uint64_t size) {
+   uint64_t len = name.length();
+   writeValue(out, len);
+   out.write(name.data(), len);
+   writeValue(out, isArray);
+   writeValue(out, size);
+   out.write(data, size);
+   return bool(out);
+}
+
+const uint32_t SpillMagic = 0x56535050; // VSPP
+
+}
+
+ShmSpill &ShmSpill::the() {
+
+   static ShmSpill spill;
+   return spill;
+}
+
+ShmSpill::ShmSpill()
+: m_compressionSettings(new CompressionSettings)
+{
+   if (const char *water = getenv("VISTLE_SHM_SPILL_HIGHWATER")) {
+      setHighWatermark(atof(water));
+   }
+   if (const char *dir = getenv("VISTLE_SHM_SPILL_DIR")) {
+      setDirectory(dir);
+   }
+   if (const char *comp = getenv("VISTLE_SHM_SPILL_COMPRESSION")) {
+      // zfp compression is lossy, so it has to be requested explicitly
+      CompressionSettings settings;
+      const char *zfp = getenv("VISTLE_SHM_SPILL_ZFP");
+      const std::string val(comp);
+      if (boost::iequals(val, "rate")) {
+         settings.m_compress = ZfpFixedRate;
+         if (zfp)
+            settings.m_zfpRate = atof(zfp);
+      } else if (boost::iequals(val, "precision")) {
+         settings.m_compress = ZfpPrecision;
+         if (zfp)
+            settings.m_zfpPrecision = atoi(zfp);
+      } else if (boost::iequals(val, "accuracy")) {
+         settings.m_compress = ZfpAccuracy;
+         if (zfp)
+            settings.m_zfpAccuracy = atof(zfp);
+      } else if (!boost::iequals(val, "off") && val != "0" && !val.empty()) {
+         std::cerr << "ShmSpill: ignoring invalid value " << val << " for VISTLE_SHM_SPILL_COMPRESSION" << std::endl;
+      }
+      setCompressionSettings(settings);
+   }
+}
+
+ShmSpill::~ShmSpill() {
+}
+
+bool ShmSpill::enabled() const {
+
+#ifdef NO_SHMEM
+   return false;
+#else
+   return !m_directory.empty();
+#endif
+}
+
+const std::string &ShmSpill::directory() const {
+
+   return m_directory;
+}
+
+void ShmSpill::setDirectory(const std::string &dir) {
+
+   std::lock_guard<std::recursive_mutex> guard(m_mutex);
+   m_directory.clear();
+   if (dir.empty())
+      return;
+
+   boost::system::error_code ec;
+   filesystem::create_directories(dir, ec);
+   if (!filesystem::is_directory(dir, ec)) {
+      std::cerr << "ShmSpill: cannot use " << dir << " for spill files, disabled" << std::endl;
+      return;
+   }
+   m_directory = dir;
+}
+
+double ShmSpill::highWatermark() const {
+
+   return m_highWatermark;
+}
+
+void ShmSpill::setHighWatermark(double fraction) {
+
+   if (fraction <= 0. || fraction > 1.) {
+      std::cerr << "ShmSpill: ignoring invalid high watermark " << fraction << std::endl;
+      return;
+   }
+   m_highWatermark = fraction;
+}
+
+void ShmSpill::setCompressionSettings(const CompressionSettings &settings) {
+
+   std::lock_guard<std::recursive_mutex> guard(m_mutex);
+   *m_compressionSettings = settings;
+}
+
+size_t ShmSpill::used() const {
+
+#ifdef NO_SHMEM
+   return 0;
+#else
+   if (!Shm::isAttached())
+      return 0;
+   const auto &shm = Shm::the().shm();
+   return shm.get_size() - shm.get_free_memory();
+#endif
+}
+
+size_t ShmSpill::limit() const {
+
+#ifdef NO_SHMEM
+   return 0;
+#else
+   if (!Shm::isAttached())
+      return 0;
+   size_t limit = Shm::the().shm().get_size();
+#ifdef __linux__
+   // POSIX shared memory is backed by a tmpfs, which usually is much smaller than the segment
+   struct statvfs fs;
+   if (statvfs("/dev/shm", &fs) == 0) {
+      size_t capacity = size_t(fs.f_blocks)*fs.f_frsize;
+      if (capacity > 0 && capacity < limit)
+         limit = capacity;
+   }
+#endif
+   return limit;
+#endif
+}
+
+bool ShmSpill::underPressure() const {
+
+   return used() > m_highWatermark*limit();
+}
+
+ShmSpill::Handle ShmSpill::retain(Object::const_ptr obj) {
+
+   std::lock_guard<std::recursive_mutex> guard(m_mutex);
+   auto entry = new Entry;
+   entry->object = obj;
+   entry->lru = m_lru.insert(m_lru.end(), entry);
+   Handle handle(entry, [](Entry *e){ ShmSpill::the().remove(e); });
+
+   relieveIfNeeded();
+
+   return handle;
+}
+
+Object::const_ptr ShmSpill::access(const Handle &handle) {
+
+   if (!handle)
+      return Object::const_ptr();
+
+   std::lock_guard<std::recursive_mutex> guard(m_mutex);
+   Entry *entry = handle.get();
+   m_lru.splice(m_lru.end(), m_lru, entry->lru);
+   if (!entry->object) {
+      relieveIfNeeded();
+      restore(entry);
+   }
+   return entry->object;
+}
+
+void ShmSpill::remove(Entry *entry) {
+
+   std::lock_guard<std::recursive_mutex> guard(m_mutex);
+   m_lru.erase(entry->lru);
+   if (!entry->file.empty()) {
+      boost::system::error_code ec;
+      filesystem::remove(entry->file, ec);
+   }
+   delete entry;
+}
+
+bool ShmSpill::relieve(size_t bytes) {
+
+   if (!enabled())
+      return false;
+
+   std::lock_guard<std::recursive_mutex> guard(m_mutex);
+   bool spilled = false;
+   const size_t lim = limit();
+   auto sufficient = [this, bytes, lim]() {
+      const size_t use = used();
+      return use <= m_highWatermark*lim && use+bytes <= lim;
+   };
+   for (auto it = m_lru.begin(); it != m_lru.end() && !sufficient(); ) {
+      // spill() may modify list
+      Entry *entry = *it;
+      ++it;
+      if (spill(entry))
+         spilled = true;
+   }
+   return spilled;
+}
+
+bool ShmSpill::relieveIfNeeded() {
+
+   if (!enabled())
+      return false;
+   size_t failed = s_failedBytes.exchange(0);
+   if (failed == 0 && !underPressure())
+      return false;
+   return relieve(failed);
+}
+
+void ShmSpill::allocationFailed(size_t bytes) {
+
+   size_t prev = s_failedBytes;
+   while (prev < bytes && !s_failedBytes.compare_exchange_weak(prev, bytes))
+      ;
+}
+
+bool ShmSpill::spill(Entry *entry) {
+
+   if (!entry->object || entry->restoring)
+      return false;
+   // only objects that are not referenced by anybody else are released from memory when spilled
+   if (entry->object.use_count() > 1 || entry->object->refcount() > 1)
+      return false;
+
+   std::stringstream str;
+   str << "spill-"
+#ifdef __linux__
+       << getpid() << "-"
+#endif
+       << m_numFiles++ << ".vsp";
+   const std::string file = (filesystem::path(m_directory) / str.str()).string();
+
+   try {
+      auto saver = std::make_shared<DeepArchiveSaver>();
+      saver->setCompressionSettings(*m_compressionSettings);
+      vecostreambuf<buffer> memstr;
+      vistle::oarchive memar(memstr);
+      memar.setCompressionSettings(*m_compressionSettings);
+      memar.setSaver(saver);
+      entry->object->saveObject(memar);
+
+      std::ofstream out(file, std::ios::binary|std::ios::trunc);
+      writeValue(out, SpillMagic);
+      const buffer &mem = memstr.get_vector();
+      writeBuffer(out, entry->object->getName(), 0, mem.data(), mem.size());
+      for (const auto &ent: saver->getDirectory()) {
+         writeBuffer(out, ent.name, ent.is_array ? 1 : 0, ent.data, ent.size);
+      }
+      if (!out) {
+         std::cerr << "ShmSpill: failed to write " << file << std::endl;
+         out.close();
+         boost::system::error_code ec;
+         filesystem::remove(file, ec);
+         return false;
+      }
+   } catch (std::exception &ex) {
+      std::cerr << "ShmSpill: failed to spill " << entry->object->getName() << ": " << ex.what() << std::endl;
+      boost::system::error_code ec;
+      filesystem::remove(file, ec);
+      return false;
+   }
+
+   entry->file = file;
+   entry->object.reset();
+   return true;
+}
+
+bool ShmSpill::restore(Entry *entry) {
+
+   if (entry->object)
+      return true;
+   if (entry->file.empty())
+      return false;
+
+   entry->restoring = true;
+
+   std::map<std::string, buffer> objects, arrays;
+   std::map<std::string, message::CompressionMode> compression;
+   std::map<std::string, size_t> size;
+   std::string root;
+   {
+      std::ifstream in(entry->file, std::ios::binary);
+      uint32_t magic = 0;
+      if (!readValue(in, magic) || magic != SpillMagic) {
+         std::cerr << "ShmSpill: invalid spill file " << entry->file << std::endl;
+         entry->restoring = false;
+         return false;
+      }
+      for (;;) {
+         uint64_t len = 0;
+         if (!readValue(in, len))
+            break;
+         std::string name(len, '\0');
+         in.read(&name[0], len);
+         char isArray = 0;
+         uint64_t sz = 0;
+         readValue(in, isArray);
+         readValue(in, sz);
+         buffer data(sz);
+         in.read(data.data(), sz);
+         if (!in) {
+            std::cerr << "ShmSpill: truncated spill file " << entry->file << std::endl;
+            entry->restoring = false;
+            return false;
+         }
+         if (root.empty())
+            root = name;
+         if (isArray)
+            arrays[name] = std::move(data);
+         else
+            objects[name] = std::move(data);
+      }
+   }
+
+   auto fetcher = std::make_shared<DeepArchiveFetcher>(objects, arrays, compression, size);
+   fetcher->setRenameObjects(true);
+   {
+      vecistreambuf<buffer> membuf(objects[root]);
+      vistle::iarchive memar(membuf);
+      memar.setFetcher(fetcher);
+      entry->object.reset(Object::loadObject(memar));
+   }
+   fetcher->releaseArrays();
+   entry->restoring = false;
+
+   if (!entry->object) {
+      std::cerr << "ShmSpill: failed to restore " << root << " from " << entry->file << std::endl;
+      return false;
+   }
+
+   boost::system::error_code ec;
+   filesystem::remove(entry->file, ec);
+   entry->file.clear();
+   return true;
+}
+
+} // namespace vistle
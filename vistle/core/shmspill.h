@@ -0,0 +1,82 @@
+#ifndef VISTLE_SHMSPILL_H
+#define VISTLE_SHMSPILL_H
+
+#include "export.h"
+
+#include <memory>
+#include <string>
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <cstddef>
+
+namespace vistle {
+
+class Object;
+struct CompressionSettings;
+
+//! monitors usage of the shared memory segment and spills objects retained for later use to disk
+/*!
+ * Objects kept for re-use (e.g. by ObjectCache) are registered with retain().
+ * When the segment fills beyond the high watermark or an allocation has failed, the least recently accessed of them
+ * that are not referenced elsewhere are serialized to a spill file and released from shared memory.
+ * This happens only at explicit checks (relieveIfNeeded(), retain() and access()), never from within an allocation.
+ * They are restored transparently by access().
+ * Spilling is enabled by setting VISTLE_SHM_SPILL_DIR to a local directory,
+ * VISTLE_SHM_SPILL_HIGHWATER sets the fraction of usable shared memory that triggers spilling.
+ * Fields within spill files are compressed with zfp according to VISTLE_SHM_SPILL_COMPRESSION (off|rate|precision|accuracy),
+ * with VISTLE_SHM_SPILL_ZFP providing the rate, precision or accuracy.
+ */
+class V_COREEXPORT ShmSpill {
+
+ public:
+   class Entry;
+   typedef std::shared_ptr<Entry> Handle;
+
+   static ShmSpill &the();
+
+   bool enabled() const;
+   const std::string &directory() const;
+   //! set directory for spill files, empty: disable spilling
+   void setDirectory(const std::string &dir);
+   double highWatermark() const;
+   void setHighWatermark(double fraction);
+   void setCompressionSettings(const CompressionSettings &settings);
+
+   //! bytes allocated within shared memory segment
+   size_t used() const;
+   //! bytes that can be allocated, limited by segment size and capacity of backing file system
+   size_t limit() const;
+   bool underPressure() const;
+
+   //! keep obj for later access, it may be spilled while only referenced through the returned handle
+   Handle retain(std::shared_ptr<const Object> obj);
+   //! retrieve object, restores it from disk if it had been spilled
+   std::shared_ptr<const Object> access(const Handle &handle);
+
+   //! spill least recently used objects until at least bytes are free and usage is below the high watermark,
+   //! returns whether anything was spilled
+   bool relieve(size_t bytes=0);
+   //! spill if segment is under pressure or an allocation failed since the last check
+   bool relieveIfNeeded();
+   //! record that an allocation of bytes within the segment failed, does not lock or spill
+   static void allocationFailed(size_t bytes);
+
+ private:
+   ShmSpill();
+   ~ShmSpill();
+   void remove(Entry *entry);
+   bool spill(Entry *entry);
+   bool restore(Entry *entry);
+
+   mutable std::recursive_mutex m_mutex;
+   std::string m_directory;
+   double m_highWatermark = 0.9;
+   std::unique_ptr<CompressionSettings> m_compressionSettings;
+   std::list<Entry *> m_lru; //!< most recently accessed at end
+   static std::atomic<size_t> s_failedBytes; //!< largest failed allocation since last check
+   size_t m_numFiles = 0;
+};
+
+} // namespace vistle
+#endif
@@ -561,6 +561,7 @@ bool StateTracker::handle(const message::Message &msg, const char *payload, size
       case FILEQUERY:
       case FILEQUERYRESULT:
       case DATATRANSFERSTATE:
+      case PAYLOADSTRIPE:
          break;
 
       default:
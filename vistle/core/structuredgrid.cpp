@@ -262,6 +262,21 @@ Index StructuredGrid::findCell(const Vec::Vector &point, Index hint, int flags)
    return InvalidIndex;
 }
 
+// FIND CELLS
+//-------------------------------------------------------------------------
+void StructuredGrid::findCells(const Vec::Vector *points, Index numPoints, Index *cells, const Index *hints, int flags) const {
+
+   const bool acceptGhost = flags&AcceptGhost;
+   const bool useCelltree = (flags&ForceCelltree) || (hasCelltree() && !(flags&NoCelltree));
+
+   if (!useCelltree) {
+      GridInterface::findCells(points, numPoints, cells, hints, flags);
+      return;
+   }
+
+   findCellsWithCelltree(this, points, numPoints, cells, hints, acceptGhost);
+}
+
 // INSIDE CHECK
 //-------------------------------------------------------------------------
 bool StructuredGrid::inside(Index elem, const Vec::Vector &point) const {
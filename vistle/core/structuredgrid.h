@@ -47,6 +47,7 @@ public:
    void setNormals(Normals::const_ptr normals);
    std::pair<Vector, Vector> cellBounds(Index elem) const override;
    Index findCell(const Vector &point, Index hint=InvalidIndex, int flags=NoFlags) const override;
+   void findCells(const Vector *points, Index numPoints, Index *cells, const Index *hints=nullptr, int flags=NoFlags) const override;
    bool inside(Index elem, const Vector &point) const override;
    Interpolator getInterpolator(Index elem, const Vector &point, DataBase::Mapping mapping=DataBase::Vertex, InterpolationMode mode=Linear) const override;
 
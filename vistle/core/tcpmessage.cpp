@@ -112,12 +112,37 @@ struct SendRequest {
     socket_t &sock;
     const message::Buffer msg;
     std::shared_ptr<buffer> payload;
+    std::shared_ptr<const void> payloadOwner;
+    const char *payloadData = nullptr;
+    size_t payloadLength = 0;
     std::shared_ptr<socket_t> payloadSocket;
     std::function<void(error_code)> handler;
     SendRequest(socket_t &sock, const message::Message &msg, std::shared_ptr<buffer> payload, std::function<void(error_code)> handler)
         : sock(sock)
         , msg(msg)
         , payload(payload)
+        , payloadData(payload ? payload->data() : nullptr)
+        , payloadLength(payload ? payload->size() : 0)
+        , handler(handler)
+    {
+    }
+
+    SendRequest(socket_t &sock, const message::Message &msg, std::shared_ptr<buffer> payload, size_t offset, size_t size, std::function<void(error_code)> handler)
+        : sock(sock)
+        , msg(msg)
+        , payload(payload)
+        , payloadData(payload->data()+offset)
+        , payloadLength(size)
+        , handler(handler)
+    {
+    }
+
+    SendRequest(socket_t &sock, const message::Message &msg, const char *payload, size_t size, std::shared_ptr<const void> owner, std::function<void(error_code)> handler)
+        : sock(sock)
+        , msg(msg)
+        , payloadOwner(owner)
+        , payloadData(payload)
+        , payloadLength(size)
         , handler(handler)
     {
     }
@@ -134,14 +159,14 @@ struct SendRequest {
 
         error_code ec;
         size_t n = msg.payloadSize();
-        if (payload) {
-            if (n >= payload->size()) {
-                n -= payload->size();
+        if (payloadData) {
+            if (n >= payloadLength) {
+                n -= payloadLength;
             } else {
                 n = 0;
             }
         }
-        if (send(sock, msg, ec, payload.get()) && payloadSocket) {
+        if (send(sock, msg, ec, payloadData, payloadLength) && payloadSocket) {
             buffer bufvec(buffersize);
             for (size_t i = 0; i < n;) {
                 auto buf = asio::buffer(bufvec.data(), std::min(bufvec.size(), n-i));
@@ -427,6 +452,39 @@ void async_send(socket_t &sock, const message::Message &msg,
    }
 }
 
+void async_send(socket_t &sock, const message::Message &msg,
+                std::shared_ptr<buffer> payload, size_t offset, size_t size,
+                const std::function<void(error_code ec)> handler)
+{
+   assert(payload && offset+size <= payload->size());
+   assert(check(msg, payload->data()+offset, size));
+   auto req = std::make_shared<SendRequest>(sock, msg, payload, offset, size, handler);
+
+   std::lock_guard<std::mutex> locker(sendQueueMutex);
+   bool submit = sendQueues[&sock].empty();
+   sendQueues[&sock].emplace_back(req);
+
+   if (submit) {
+       submitSendRequest(req);
+   }
+}
+
+void async_send(socket_t &sock, const message::Message &msg,
+                const char *payload, size_t size, std::shared_ptr<const void> owner,
+                const std::function<void(error_code ec)> handler)
+{
+   assert(check(msg, payload, size));
+   auto req = std::make_shared<SendRequest>(sock, msg, payload, size, owner, handler);
+
+   std::lock_guard<std::mutex> locker(sendQueueMutex);
+   bool submit = sendQueues[&sock].empty();
+   sendQueues[&sock].emplace_back(req);
+
+   if (submit) {
+       submitSendRequest(req);
+   }
+}
+
 void async_forward(socket_t &sock, const message::Message &msg,
                 std::shared_ptr<socket_t> payloadSock,
                 const std::function<void(error_code ec)> handler)
@@ -23,12 +23,21 @@ bool V_COREEXPORT send(socket_t &sock, const message::Message &msg, error_code &
 void V_COREEXPORT async_send(socket_t &sock, const Message &msg,
                              std::shared_ptr<buffer> payload,
                              const std::function<void(error_code ec)> handler);
+//! send size bytes of payload starting at offset as payload of msg
+void V_COREEXPORT async_send(socket_t &sock, const Message &msg,
+                             std::shared_ptr<buffer> payload, size_t offset, size_t size,
+                             const std::function<void(error_code ec)> handler);
+//! send size bytes at payload without copying them, owner is kept alive until they have been written
+void V_COREEXPORT async_send(socket_t &sock, const Message &msg,
+                             const char *payload, size_t size, std::shared_ptr<const void> owner,
+                             const std::function<void(error_code ec)> handler);
 void V_COREEXPORT async_forward(socket_t &sock, const Message &msg,
                              std::shared_ptr<socket_t> payloadSock,
                              const std::function<void(error_code ec)> handler);
 
 bool V_COREEXPORT recv(socket_t &sock, message::Buffer &msg, error_code &ec, bool block=false, buffer *payload=nullptr);
 bool V_COREEXPORT recv_message(socket_t &sock, message::Buffer &msg, error_code &ec, bool block=false);
+bool V_COREEXPORT recv_payload(socket_t &sock, message::Buffer &msg, error_code &ec, buffer *payload);
 void V_COREEXPORT async_recv(socket_t &sock, vistle::message::Buffer &msg, std::function<void(error_code, std::shared_ptr<buffer>)> handler);
 void V_COREEXPORT async_recv_header(socket_t &sock, vistle::message::Buffer &msg, std::function<void(error_code)> handler);
 
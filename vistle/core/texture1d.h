@@ -24,7 +24,7 @@ class V_COREEXPORT Texture1D: public Vec<Scalar> {
    Scalar getMax() const;
    Index getNumCoords() { return getSize(); }
    Index getNumCoords() const { return getSize(); }
-   shm<unsigned char>::array &pixels() { return *d()->pixels; }
+   shm<unsigned char>::array &pixels() { if (d()->pixels.makeUnique()) refresh(); return *d()->pixels; }
    const shm<unsigned char>::array &pixels() const { return *d()->pixels; }
    shm<Scalar>::array &coords() { return x(); }
    const Scalar *coords() const  { return x(); }
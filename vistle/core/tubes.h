@@ -24,7 +24,7 @@ class  V_COREEXPORT Tubes: public CoordsWithRadius {
          const Meta &meta=Meta());
 
    Index getNumTubes() const;
-   shm<Index>::array &components() { return *d()->components; }
+   shm<Index>::array &components() { if (d()->components.makeUnique()) refresh(); return *d()->components; }
    const shm<Index>::array &components() const { return *d()->components; }
 
    CapStyle startStyle() const;
@@ -384,6 +384,19 @@ Index UnstructuredGrid::findCell(const Vector &point, Index hint, int flags) con
    return InvalidIndex;
 }
 
+void UnstructuredGrid::findCells(const Vector *points, Index numPoints, Index *cells, const Index *hints, int flags) const {
+
+   const bool acceptGhost = flags&AcceptGhost;
+   const bool useCelltree = (flags&ForceCelltree) || (hasCelltree() && !(flags&NoCelltree));
+
+   if (!useCelltree) {
+      GridInterface::findCells(points, numPoints, cells, hints, flags);
+      return;
+   }
+
+   findCellsWithCelltree(this, points, numPoints, cells, hints, acceptGhost);
+}
+
 namespace {
 
 
@@ -53,13 +53,14 @@ class V_COREEXPORT UnstructuredGrid: public Indexed, virtual public GridInterfac
 
    void resetElements() override;
 
-   shm<Byte>::array &tl() { return *d()->tl; }
+   shm<Byte>::array &tl() { if (d()->tl.makeUnique()) refresh(); return *d()->tl; }
    const Byte *tl() const { return m_tl; }
 
    bool isConvex(Index elem) const;
    bool isGhostCell(Index elem) const override;
    std::pair<Vector, Vector> cellBounds(Index elem) const override;
    Index findCell(const Vector &point, Index hint=InvalidIndex, int flags=NoFlags) const override;
+   void findCells(const Vector *points, Index numPoints, Index *cells, const Index *hints=nullptr, int flags=NoFlags) const override;
    bool insideConvex(Index elem, const Vector &point) const;
    bool inside(Index elem, const Vector &point) const override;
    Index checkConvexity(); //< return number of non-convex cells
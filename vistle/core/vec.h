@@ -46,10 +46,10 @@ class Vec: public DataBase {
    void applyDimensionHint(Object::const_ptr grid) override;
    void setExact(bool exact) override;
 
-   array &x(int c=0) { return *d()->x[c]; }
-   array &y() { assert(Dim > 1); return Dim>1 ? *d()->x[1] : x(); }
-   array &z() { assert(Dim > 2); return Dim>2 ? *d()->x[2] : x(); }
-   array &w() { assert(Dim > 3); return Dim>3 ? *d()->x[3] : x(); }
+   array &x(int c=0) { if (d()->x[c].makeUnique()) refresh(); return *d()->x[c]; }
+   array &y() { assert(Dim > 1); return Dim>1 ? x(1) : x(); }
+   array &z() { assert(Dim > 2); return Dim>2 ? x(2) : x(); }
+   array &w() { assert(Dim > 3); return Dim>3 ? x(3) : x(); }
 
    const T *x(int c=0) const { return m_x[c]; }
    const T *y() const { assert(Dim > 1); return Dim>1 ? m_x[1] : x(); }
@@ -46,6 +46,7 @@ template <class T, int Dim>
 void Vec<T,Dim>::setSize(const Index size) {
    for (int c=0; c<Dim; ++c) {
       if (d()->x[c].valid()) {
+         d()->x[c].makeUnique();
          d()->x[c]->resize(size);
       } else {
          d()->x[c].construct(size);
@@ -83,6 +84,12 @@ double Vec<T,Dim>::value(Index idx, int component) const {
 
 template <class T, int Dim>
 void Vec<T,Dim>::applyDimensionHint(Object::const_ptr grid) {
+    bool copied = false;
+    for (int c=0; c<Dim; ++c)
+        copied |= d()->x[c].makeUnique();
+    if (copied)
+        refresh();
+
     if (auto str = StructuredGridBase::as(grid)) {
         auto m = guessMapping(shared_from_this());
         for (int c=0; c<Dim; ++c) {
@@ -100,6 +107,11 @@ void Vec<T,Dim>::applyDimensionHint(Object::const_ptr grid) {
 
 template <class T, int Dim>
 void Vec<T,Dim>::setExact(bool exact) {
+    bool copied = false;
+    for (int c=0; c<Dim; ++c)
+        copied |= d()->x[c].makeUnique();
+    if (copied)
+        refresh();
     d()->setExact(exact);
 }
 
@@ -16,6 +16,7 @@
 
 #include <sys/types.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <future>
@@ -31,6 +32,7 @@
 #include <vistle/core/messagerouter.h>
 #include <vistle/core/object.h>
 #include <vistle/core/parameter.h>
+#include <vistle/core/profiler.h>
 #include <vistle/core/shm.h>
 #include <vistle/util/directory.h>
 #include <vistle/util/enum.h>
@@ -242,10 +244,16 @@ ClusterManager::ClusterManager(boost::mpi::communicator comm, const std::vector<
 , m_barrierActive(false)
 {
     m_portManager->setTracker(&m_stateTracker);
+
+    if (const char *batch = getenv("VISTLE_MANAGER_BATCH")) {
+        m_maxBatch = std::max(1, atoi(batch));
+    }
 }
 
 ClusterManager::~ClusterManager() {
 
+    if (m_tracing)
+        Profiler::the().enable(false);
     m_portManager->setTracker(nullptr);
 }
 
@@ -272,6 +280,40 @@ void ClusterManager::init() {
 
     m_archiveCompressionSpeed = addIntParameter("archive_compression_speed", "speed parameter of compression algorithm", -1);
     setParameterRange(m_archiveCompressionSpeed, Integer(-1), Integer(100));
+
+    m_adaptiveCompression = addIntParameter("adaptive_compression", "choose compression of each array sent to remote hubs based on samples and link bandwidth", false, Parameter::Boolean);
+
+    addIntParameter("prioritize_visible", "start executions with the timestep shown last and cancel executions superseded by new requests, including modules downstream", false, Parameter::Boolean);
+
+    m_trace = addIntParameter("trace", "record data transfers in Chrome trace format, written whenever a module finishes execution", false, Parameter::Boolean);
+}
+
+bool ClusterManager::changeParameter(const Parameter *p) {
+
+    if (p == m_trace) {
+        bool trace = m_trace->getValue();
+        if (trace != m_tracing) {
+            m_tracing = trace;
+            Profiler::the().enable(m_tracing);
+        }
+    }
+    return ParameterManager::changeParameter(p);
+}
+
+void ClusterManager::writeTrace(int moduleId, int executionCount) {
+
+    auto events = Profiler::the().collect(0);
+    if (events.empty())
+        return;
+
+    std::stringstream process;
+    process << "manager " << Communicator::the().hubId() << " rank " << m_rank;
+    std::stringstream filename;
+    filename << Profiler::traceDirectory() << "/vistle-trace-manager" << -Communicator::the().hubId() << "_" << m_rank
+             << "-" << moduleId << "-" << executionCount << ".json";
+    // manager processes get negative pids, so that they do not clash with modules
+    const int pid = Communicator::the().hubId()*65536 - m_rank;
+    Profiler::writeTrace(filename.str(), std::vector<std::string>{Profiler::toJson(events, pid, process.str())});
 }
 
 const StateTracker &ClusterManager::state() const {
@@ -321,6 +363,16 @@ int ClusterManager::archiveCompressionSpeed() const {
     return m_archiveCompressionSpeed->getValue();
 }
 
+bool ClusterManager::adaptiveCompression() const {
+    std::lock_guard<std::mutex> locker(m_parameterMutex);
+    return m_adaptiveCompression->getValue();
+}
+
+bool ClusterManager::isStreaming(int id) const {
+    auto param = std::dynamic_pointer_cast<IntParameter>(getParameter(id, "_streaming"));
+    return param && param->getValue();
+}
+
 int ClusterManager::getRank() const {
 
    return m_rank;
@@ -368,6 +420,7 @@ bool ClusterManager::checkBarrier(const message::uuid_t &uuid) const {
 void ClusterManager::barrierReached(const message::uuid_t &uuid) {
 
    assert(m_barrierActive);
+   Communicator::the().flushBatches();
    m_comm.barrier();
    reachedSet.clear();
    CERR << "Barrier [" << uuid << "] reached" << std::endl;
@@ -393,6 +446,7 @@ bool ClusterManager::dispatch(bool &received) {
        // handle messages from modules closer to sink first
        // - should allow for objects to travel through the pipeline more quickly
        m_modulePriorityChange = m_stateTracker.graphChangeCount();
+       m_modulePriority.clear();
        for (auto m: m_stateTracker.runningMap) {
            const auto &mod = m.second;
            pq.emplace(mod);
@@ -405,20 +459,36 @@ bool ClusterManager::dispatch(bool &received) {
    }
 
    // handle messages from modules
+   // - drain up to m_maxBatch messages from each queue, messages to other ranks are sent once all queues have been visited
+   // - barriers and executions are ordering points: pending messages are sent before they are handled
+   //   and no further messages are taken from the same queue
+   auto &comm = Communicator::the();
+   comm.setBatching(m_maxBatch > 1);
    for (const auto &mod: m_modulePriority) {
       const int modId = mod.id;
 
+      if (mod.hub != comm.hubId())
+         continue;
+
       // keep messages from modules that have already reached a barrier on hold
       if (reachedSet.find(modId) != reachedSet.end())
          continue;
 
-      if (mod.hub == Communicator::the().hubId()) {
+      auto running = runningMap.find(modId);
+      if (running != runningMap.end())
+         running->second.update();
+
+      for (int n=0; n<m_maxBatch && !done; ++n) {
+         // module might have reached a barrier with its previous message
+         if (reachedSet.find(modId) != reachedSet.end())
+            break;
+
          bool recv = false;
          message::Buffer buf;
          std::shared_ptr<message::MessageQueue> mq;
+         // module might have been removed while handling its previous message
          auto it = runningMap.find(modId);
          if (it != runningMap.end()) {
-            it->second.update();
             mq = it->second.recvQueue;
          }
          if (mq) {
@@ -429,19 +499,27 @@ bool ClusterManager::dispatch(bool &received) {
                exit(-1);
             }
          }
-
-         if (recv) {
-            received = true;
-            MessagePayload pl;
-            if (buf.payloadSize() > 0) {
-                pl = Shm::the().getArrayFromName<char>(buf.payloadName());
-            }
-            if (!Communicator::the().handleMessage(buf, pl))
-                done = true;
-            pl.unref();
+         if (!recv)
+            break;
+
+         received = true;
+         const bool orderingPoint = buf.type() == message::BARRIER || buf.type() == message::BARRIERREACHED || buf.type() == message::EXECUTE;
+         if (orderingPoint)
+            comm.setBatching(false);
+         MessagePayload pl;
+         if (buf.payloadSize() > 0) {
+             pl = Shm::the().getArrayFromName<char>(buf.payloadName());
+         }
+         if (!comm.handleMessage(buf, pl))
+             done = true;
+         pl.unref();
+         if (orderingPoint) {
+            comm.setBatching(m_maxBatch > 1);
+            break;
          }
       }
    }
+   comm.setBatching(false);
 
    if (m_quitFlag) {
       if (numRunning() == 0)
@@ -1192,7 +1270,8 @@ bool ClusterManager::handlePriv(const message::Execute &exec) {
                         mod.objectCount.resize(getSize());
                     ++mod.objectCount[exec.rank()];
                     numObjects = std::accumulate(mod.objectCount.begin(), mod.objectCount.end(), 0);
-                    if (numObjects>0 && numObjects>=getSize()*.2) {
+                    // streaming modules should not wait for input on other ranks
+                    if (numObjects>0 && (numObjects>=getSize()*.2 || isStreaming(exec.getModule()))) {
                         doExec = true;
                         for (auto &c: mod.objectCount) {
                             if (c > 0) {
@@ -1488,6 +1567,8 @@ bool ClusterManager::handlePriv(const message::AddObjectCompleted &complete) {
 bool ClusterManager::handlePriv(const message::ExecutionProgress &prog) {
 
    const bool localSender = idToHub(prog.senderId()) == Communicator::the().hubId();
+   if (m_tracing && localSender && prog.rank() == m_rank && prog.stage() == message::ExecutionProgress::Finish)
+       writeTrace(prog.senderId(), prog.getExecutionCount());
    RunningMap::iterator i = runningMap.find(prog.senderId());
    ClusterManager::Module* mod = nullptr;
    if (i == runningMap.end()) {
@@ -2006,11 +2087,19 @@ bool ClusterManager::handlePriv(const message::DataTransferState &state) {
     m_numTransfering[r] = state.numTransferring();
     m_totalNumTransferring += m_numTransfering[r];
 
+    if (state.hasTransferStatistics()) {
+        m_transferRawBytes += state.rawSize();
+        m_transferSentBytes += state.sentSize();
+    }
+
     std::stringstream str;
     if (m_totalNumTransferring == 0) {
         Communicator::the().clearStatus();
     } else {
-        str << m_totalNumTransferring << " objects to transfer" << std::endl;
+        str << m_totalNumTransferring << " objects to transfer";
+        if (m_transferRawBytes > 0)
+            str << ", " << m_transferSentBytes/1e6 << " of " << m_transferRawBytes/1e6 << " MB sent";
+        str << std::endl;
         auto now = Clock::time();
         if (now - m_lastStatusUpdateTime > 1.) {
             m_lastStatusUpdateTime = now;
@@ -80,6 +80,10 @@ class ClusterManager: public ParameterManager
 
    message::CompressionMode archiveCompressionMode() const;
    int archiveCompressionSpeed() const;
+   //! whether compression of arrays sent to remote hubs is chosen per array
+   bool adaptiveCompression() const;
+   //! whether module passes on output per block and is executed as soon as input is available
+   bool isStreaming(int id) const;
 
    bool isLocal(int id) const;
    int idToHub(int id) const;
@@ -101,6 +105,8 @@ class ClusterManager: public ParameterManager
    };
    std::vector<StateTracker::Module> m_modulePriority;
    int m_modulePriorityChange = -1;
+   //! max. no. of messages handled per module and dispatch, messages to other ranks are coalesced if > 1
+   int m_maxBatch = 32;
 
    bool m_quitFlag;
 
@@ -195,9 +201,16 @@ class ClusterManager: public ParameterManager
 
    IntParameter *m_archiveCompression = nullptr;
    IntParameter *m_archiveCompressionSpeed = nullptr;
+   IntParameter *m_adaptiveCompression = nullptr;
+   IntParameter *m_trace = nullptr;
+   bool m_tracing = false;
+   bool changeParameter(const Parameter *p) override;
+   //! write events recorded by manager since last call to a trace file
+   void writeTrace(int moduleId, int executionCount);
 
    std::vector<int> m_numTransfering;
    long m_totalNumTransferring = 0;
+   uint64_t m_transferRawBytes = 0, m_transferSentBytes = 0; //!< totals of transfers with statistics
    double m_lastStatusUpdateTime = 0.;
 
 };
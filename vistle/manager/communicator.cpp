@@ -9,6 +9,7 @@
 #include <sys/types.h>
 
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
 
@@ -53,6 +54,7 @@ Communicator::Communicator(int r, const std::vector<std::string> &hosts, boost::
 , m_rank(r)
 , m_size(hosts.size())
 , m_recvSize(0)
+, m_recvBatch(BatchSize)
 , m_hubSocket(m_ioService)
 {
    crypto::initialize();
@@ -66,7 +68,7 @@ Communicator::Communicator(int r, const std::vector<std::string> &hosts, boost::
    if (m_size > 1) {
       MPI_Irecv(&m_recvSize, 1, MPI_INT, MPI_ANY_SOURCE, TagForBroadcast, comm, &m_reqAny);
 
-      MPI_Irecv(m_recvBufToRank.data(), m_recvBufToRank.bufferSize(), MPI_BYTE, MPI_ANY_SOURCE, TagToRank, comm, &m_reqToRank);
+      MPI_Irecv(m_recvBatch.data(), m_recvBatch.size(), MPI_BYTE, MPI_ANY_SOURCE, TagToRank, comm, &m_reqToRank);
    }
 }
 
@@ -247,26 +249,41 @@ bool Communicator::dispatch(bool *work) {
       if (flag && status.MPI_TAG == TagToRank) {
 
          received = true;
-         message::Message *message = &m_recvBufToRank;
-         MessagePayload payload;
-         if (message->payloadSize() > 0) {
-             payload.construct(message->payloadSize());
-             MPI_Status status2;
-             MPI_Recv(payload->data(), payload->size(), MPI_BYTE, status.MPI_SOURCE, TagToRank, m_comm, &status2);
-             message->setPayloadName(payload.name());
-         }
-         if (m_rank == 0 && message->isForBroadcast()) {
-            if (!broadcastAndHandleMessage(*message, payload)) {
-               CERR << "Quit reason: broadcast & handle" << std::endl;
-               done = true;
+         int count = 0;
+         MPI_Get_count(&status, MPI_BYTE, &count);
+         // a batch of one or more messages, only the last one may carry a payload
+         size_t offset = 0;
+         while (offset + sizeof(message::Message) <= size_t(count)) {
+            message::Buffer message;
+            memcpy(message.data(), m_recvBatch.data()+offset, sizeof(message::Message));
+            const size_t size = message.size();
+            if (size < sizeof(message::Message) || size > message.bufferSize() || offset+size > size_t(count)) {
+               CERR << "invalid message size " << size << " at offset " << offset << " in batch of " << count << " bytes from rank " << status.MPI_SOURCE << std::endl;
+               break;
             }
-         }  else {
-            if (!handleMessage(*message, payload)) {
-               CERR << "Quit reason: handle" << std::endl;
-               done = true;
+            memcpy(message.data(), m_recvBatch.data()+offset, size);
+            offset += size;
+
+            MessagePayload payload;
+            if (message.payloadSize() > 0) {
+                payload.construct(message.payloadSize());
+                MPI_Status status2;
+                MPI_Recv(payload->data(), payload->size(), MPI_BYTE, status.MPI_SOURCE, TagToRank, m_comm, &status2);
+                message.setPayloadName(payload.name());
+            }
+            if (m_rank == 0 && message.isForBroadcast()) {
+               if (!broadcastAndHandleMessage(message, payload)) {
+                  CERR << "Quit reason: broadcast & handle" << std::endl;
+                  done = true;
+               }
+            }  else {
+               if (!handleMessage(message, payload)) {
+                  CERR << "Quit reason: handle" << std::endl;
+                  done = true;
+               }
             }
          }
-         MPI_Irecv(m_recvBufToRank.data(), m_recvBufToRank.bufferSize(), MPI_BYTE, MPI_ANY_SOURCE, TagToRank, m_comm, &m_reqToRank);
+         MPI_Irecv(m_recvBatch.data(), m_recvBatch.size(), MPI_BYTE, MPI_ANY_SOURCE, TagToRank, m_comm, &m_reqToRank);
       }
 
       // test for message size from another MPI node
@@ -344,14 +361,7 @@ bool Communicator::dispatch(bool *work) {
          if (buf.destRank() == 0) {
              handleMessage(buf, pl);
          } else if (buf.destRank() >= 0) {
-             auto p = m_ongoingSends.emplace(new SendRequest(buf));
-             auto it = p.first;
-             auto &sr = **it;
-             MPI_Isend(sr.buf.data(), sr.buf.size(), MPI_BYTE, buf.destRank(), TagToRank, m_comm, &sr.req);
-             if (buf.payloadSize() > 0) {
-                 sr.payload = pl;
-                 MPI_Isend(sr.payload->data(), sr.payload->size(), MPI_BYTE, buf.destRank(), TagToRank, m_comm, &sr.payload_req);
-             }
+             sendToRank(buf.destRank(), buf, pl);
          } else if(!broadcastAndHandleMessage(buf, pl)) {
             CERR << "Quit reason: broadcast & handle 2: " << buf << buf << std::endl;
             done = true;
@@ -405,18 +415,77 @@ bool Communicator::sendMessage(const int moduleId, const message::Message &messa
    if (m_rank == destRank || destRank == -1) {
       return clusterManager().sendMessage(moduleId, message);
    } else {
-      auto p = m_ongoingSends.emplace(new SendRequest(message));
-      auto it = p.first;
-      auto &sr = **it;
-      MPI_Isend(sr.buf.data(), sr.buf.size(), MPI_BYTE, destRank, TagToRank, m_comm, &sr.req);
-      if (sr.buf.payloadSize() > 0) {
-          sr.payload = payload;
-          MPI_Isend(sr.payload->data(), sr.payload->size(), MPI_BYTE, 0, TagToRank, m_comm, &sr.payload_req);
-      }
+      return sendToRank(destRank, message, payload);
+   }
+   return true;
+}
+
+bool Communicator::sendToRank(int rank, const message::Message &message, const MessagePayload &payload) {
+
+   std::lock_guard<Communicator> guard(*this);
+
+   if (m_batching && message.payloadSize() == 0) {
+      if (m_batches[rank].size() + message.size() > BatchSize)
+         flushBatch(rank);
+      auto &batch = m_batches[rank];
+      const char *data = static_cast<const char *>(static_cast<const void *>(&message));
+      batch.insert(batch.end(), data, data+message.size());
+      return true;
+   }
+
+   // keep messages in order
+   flushBatch(rank);
+
+   auto p = m_ongoingSends.emplace(new SendRequest(message));
+   auto it = p.first;
+   auto &sr = **it;
+   MPI_Isend(sr.buf.data(), sr.buf.size(), MPI_BYTE, rank, TagToRank, m_comm, &sr.req);
+   if (sr.buf.payloadSize() > 0) {
+      sr.payload = payload;
+      MPI_Isend(sr.payload->data(), sr.payload->size(), MPI_BYTE, rank, TagToRank, m_comm, &sr.payload_req);
    }
    return true;
 }
 
+bool Communicator::flushBatch(int rank) {
+
+   std::lock_guard<Communicator> guard(*this);
+
+   auto it = m_batches.find(rank);
+   if (it == m_batches.end())
+      return true;
+   std::vector<char> batch(std::move(it->second));
+   m_batches.erase(it);
+   if (batch.empty())
+      return true;
+
+   auto p = m_ongoingSends.emplace(new SendRequest(std::move(batch)));
+   auto &sr = **p.first;
+   MPI_Isend(sr.batch.data(), sr.batch.size(), MPI_BYTE, rank, TagToRank, m_comm, &sr.req);
+   return true;
+}
+
+bool Communicator::flushBatches() {
+
+   std::lock_guard<Communicator> guard(*this);
+
+   bool ok = true;
+   while (!m_batches.empty()) {
+      if (!flushBatch(m_batches.begin()->first))
+         ok = false;
+   }
+   return ok;
+}
+
+void Communicator::setBatching(bool enable) {
+
+   std::lock_guard<Communicator> guard(*this);
+
+   m_batching = enable && m_size > 1;
+   if (!m_batching)
+      flushBatches();
+}
+
 bool Communicator::forwardToMaster(const message::Message &message, const MessagePayload &payload) {
 
     if (message.payloadSize() > 0) {
@@ -428,14 +497,7 @@ bool Communicator::forwardToMaster(const message::Message &message, const Messag
 
    assert(m_rank != 0);
    if (m_rank != 0) {
-      auto p = m_ongoingSends.emplace(new SendRequest(message));
-      auto it = p.first;
-      auto &sr = **it;
-      MPI_Isend(&sr.buf, sr.buf.size(), MPI_BYTE, 0, TagToRank, m_comm, &sr.req);
-      if (sr.buf.payloadSize() > 0) {
-          sr.payload = payload;
-          MPI_Isend(sr.payload->data(), sr.payload->size(), MPI_BYTE, 0, TagToRank, m_comm, &sr.payload_req);
-      }
+      return sendToRank(0, message, payload);
    }
 
    return true;
@@ -465,6 +527,8 @@ bool Communicator::broadcastAndHandleMessage(const message::Message &message, co
     MessagePayload pl = payload;
     if (m_size > 0) {
         std::lock_guard<Communicator> guard(*this);
+        // messages held back for other ranks must not wait for the collective operations
+        flushBatches();
         std::vector<MPI_Request> s(m_size);
         for (int index = 0; index < m_size; ++index) {
             unsigned int size = buf.size();
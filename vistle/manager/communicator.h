@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <set>
+#include <map>
 
 #include <boost/asio.hpp>
 #include <boost/mpi.hpp>
@@ -42,6 +43,10 @@ class Communicator {
    bool forwardToMaster(const message::Message &message, const vistle::MessagePayload &payload=MessagePayload());
    bool broadcastAndHandleMessage(const message::Message &message, const MessagePayload &payload=MessagePayload());
    bool sendMessage(int receiver, const message::Message &message, int rank=-1, const MessagePayload &payload=MessagePayload());
+   //! collect messages without payload to other ranks and send them as a single MPI message per destination rank
+   void setBatching(bool enable);
+   //! send messages collected while batching
+   bool flushBatches();
 
    int hubId() const;
    int getRank() const;
@@ -59,6 +64,8 @@ class Communicator {
    void unlock();
  private:
    bool sendHub(const message::Message &message, const MessagePayload &payload=MessagePayload());
+   bool sendToRank(int rank, const message::Message &message, const MessagePayload &payload=MessagePayload());
+   bool flushBatch(int rank);
    bool connectData();
    bool scanModules(const std::string &dir);
 
@@ -74,17 +81,25 @@ class Communicator {
    const int m_size;
    std::string m_moduleDir;
 
+   //! max. size of MPI messages sent with TagToRank, concatenation of messages
+   static const size_t BatchSize = 32*message::Message::MESSAGE_SIZE;
+
    unsigned m_recvSize;
-   message::Buffer m_recvBufToRank, m_recvBufToAny;
+   std::vector<char> m_recvBatch;
+   message::Buffer m_recvBufToAny;
    MPI_Request m_reqAny, m_reqToRank;
    struct SendRequest {
        SendRequest(const message::Message &msg): buf(msg) {}
        SendRequest(const message::Buffer &buf): buf(buf) {}
+       SendRequest(std::vector<char> &&batch): batch(std::move(batch)) {}
        message::Buffer buf;
+       std::vector<char> batch;
        MessagePayload payload;
        MPI_Request req, payload_req;
    };
    std::set<std::shared_ptr<SendRequest>> m_ongoingSends;
+   bool m_batching = false;
+   std::map<int, std::vector<char>> m_batches; //!< messages collected per destination rank
 
    static Communicator *s_singleton;
 
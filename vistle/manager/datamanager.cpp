@@ -1,5 +1,6 @@
 #include <boost/mpl/for_each.hpp>
 #include <boost/asio/connect.hpp>
+#include <boost/asio/read.hpp>
 #include <boost/mpi/communicator.hpp>
 
 #include "datamanager.h"
@@ -7,6 +8,8 @@
 #include "communicator.h"
 #include <vistle/util/vecstreambuf.h>
 #include <vistle/util/sleep.h>
+#include <vistle/util/stopwatch.h>
+#include <vistle/util/contenthash.h>
 #include <vistle/core/archives.h>
 #include <vistle/core/archive_loader.h>
 #include <vistle/core/archive_saver.h>
@@ -14,9 +17,12 @@
 #include <vistle/core/object.h>
 #include <vistle/core/tcpmessage.h>
 #include <vistle/core/messages.h>
+#include <vistle/core/profiler.h>
 #include <vistle/core/shmvector.h>
 #include <iostream>
 #include <functional>
+#include <cstring>
+#include <type_traits>
 
 #define CERR std::cerr << "data [" << m_rank << "/" << m_size << "] "
 
@@ -32,6 +38,12 @@ namespace vistle {
 
 namespace {
 
+const double DefaultBandwidth = 1.25e9; //!< bytes/s assumed for links without measurements
+const size_t MinAdaptiveBytes = 64*1024; //!< smaller arrays are sent uncompressed by adaptive compression
+const size_t SampleChunkBytes = 16*1024;
+const int NumSampleChunks = 4;
+const size_t MaxContentCache = 1<<16; //!< no. of content hashes remembered per hub
+
 bool isLocal(int id) {
 
    auto &comm = Communicator::the();
@@ -39,6 +51,173 @@ bool isLocal(int id) {
    return (state.getHub(id) == comm.hubId());
 }
 
+//! look up array for sending its elements straight from shared memory
+struct RawArraySource {
+   RawArraySource(const std::string &name, int type): m_name(name), m_type(type) {}
+
+   template<typename T>
+   void operator()(T) {
+      if (shm<T>::array::typeId() != m_type)
+         return;
+      auto arr = Shm::the().getArrayFromName<T>(m_name);
+      if (!arr)
+         return;
+      m_data = reinterpret_cast<const char *>(arr->data());
+      m_size = arr->size();
+      m_bytes = m_size*sizeof(T);
+      for (int c=0; c<3; ++c)
+         m_dim[c] = arr->dimensionHint(c);
+      m_exact = arr->exact();
+      m_elementSize = sizeof(T);
+      m_floatingPoint = std::is_floating_point<T>::value;
+      m_owner = std::make_shared<ArrayLoader::Unreffer<T>>(arr);
+      m_ok = true;
+   }
+
+   const std::string m_name;
+   const int m_type;
+   bool m_ok = false;
+   const char *m_data = nullptr;
+   uint64_t m_size = 0, m_bytes = 0;
+   uint64_t m_dim[3] = {0, 1, 1};
+   bool m_exact = false;
+   size_t m_elementSize = 1;
+   bool m_floatingPoint = false;
+   std::shared_ptr<ArrayLoader::ArrayOwner> m_owner;
+};
+
+//! fingerprint of array contents and layout, never 0
+uint64_t arrayHash(const RawArraySource &src) {
+
+   ContentHasher hasher(src.m_type);
+   hasher.add(src.m_size);
+   for (int c=0; c<3; ++c)
+      hasher.add(src.m_dim[c]);
+   hasher.add(src.m_exact);
+   hasher.add(src.m_data, src.m_bytes);
+   const uint64_t hash = hasher.hash();
+   return hash ? hash : 1;
+}
+
+//! compression applied to an array sent to a remote hub
+struct CompressionChoice {
+   FieldCompressionMode field = Uncompressed;
+   message::CompressionMode mode = message::CompressionNone;
+   double estimate = 0.; //!< seconds for compressing and transmitting
+};
+
+//! gather evenly spaced chunks of an array for estimating its compressibility
+buffer sampleArray(const RawArraySource &src) {
+
+   buffer sample;
+   if (src.m_bytes <= NumSampleChunks*SampleChunkBytes) {
+      sample.insert(sample.end(), src.m_data, src.m_data+src.m_bytes);
+      return sample;
+   }
+
+   const size_t chunk = SampleChunkBytes/src.m_elementSize*src.m_elementSize;
+   const size_t stride = (src.m_bytes-chunk)/(NumSampleChunks-1)/src.m_elementSize*src.m_elementSize;
+   for (int i=0; i<NumSampleChunks; ++i) {
+      const char *begin = src.m_data+i*stride;
+      sample.insert(sample.end(), begin, begin+chunk);
+   }
+   return sample;
+}
+
+//! choose the compression that minimizes the estimated time for sending src over a link with bandwidth
+CompressionChoice chooseCompression(const RawArraySource &src, double bandwidth) {
+
+   CompressionChoice best;
+   best.estimate = src.m_bytes/bandwidth;
+   if (src.m_bytes < MinAdaptiveBytes)
+      return best;
+
+   auto &mgr = Communicator::the().clusterManager();
+   const buffer sample = sampleArray(src);
+   auto consider = [&best, &src, &sample, bandwidth](FieldCompressionMode field, message::CompressionMode mode, size_t compressedSize, double seconds) {
+      const double ratio = double(compressedSize)/sample.size();
+      const double estimate = src.m_bytes*(seconds/sample.size() + ratio/bandwidth);
+      if (estimate < best.estimate) {
+         best.field = field;
+         best.mode = mode;
+         best.estimate = estimate;
+      }
+   };
+
+   const int speed = mgr.archiveCompressionSpeed();
+   for (auto mode: {message::CompressionLz4, message::CompressionZstd}) {
+      auto m = mode;
+      const double start = Clock::time();
+      buffer compressed = message::compressPayload(m, sample, speed);
+      const double elapsed = Clock::time()-start;
+      // mode is reset if unavailable or without gain
+      if (m == mode)
+         consider(Uncompressed, m, compressed.size(), elapsed);
+   }
+
+#if defined(USE_YAS) && defined(HAVE_ZFP)
+   // lossy compression is only considered if it has been enabled
+   const auto field = mgr.fieldCompressionMode();
+   if (field != Uncompressed && src.m_floatingPoint && !src.m_exact) {
+      detail::ZfpParameters param;
+      param.mode = field;
+      param.rate = mgr.zfpRate();
+      param.precision = mgr.zfpPrecision();
+      param.accuracy = mgr.zfpAccuracy();
+      const Index dim[3] = { Index(sample.size()/src.m_elementSize), 1, 1 };
+      buffer compressed;
+      const double start = Clock::time();
+      bool ok = false;
+      if (src.m_elementSize == sizeof(float))
+         ok = detail::compressZfp<zfp_type_float>(compressed, sample.data(), dim, param);
+      else if (src.m_elementSize == sizeof(double))
+         ok = detail::compressZfp<zfp_type_double>(compressed, sample.data(), dim, param);
+      const double elapsed = Clock::time()-start;
+      if (ok)
+         consider(field, message::CompressionNone, compressed.size(), elapsed);
+   }
+#endif
+
+   return best;
+}
+
+//! construct array announced by a SendObject message, so that its elements can be stored in place
+struct RawArraySink {
+   RawArraySink(const message::SendObject &snd): m_snd(snd) {}
+
+   template<typename T>
+   void operator()(T) {
+      if (shm<T>::array::typeId() != int(m_snd.objectType()))
+         return;
+      if (m_snd.arraySize()*sizeof(T) != m_snd.payloadSize()) {
+         std::cerr << "RawArraySink: size mismatch for array " << m_snd.objectId() << std::endl;
+         return;
+      }
+      m_ok = true;
+      auto arr = Shm::the().getArrayFromName<T>(m_snd.objectId());
+      if (arr) {
+         std::cerr << "RawArraySink: already have data array with name " << m_snd.objectId() << std::endl;
+         m_owner = std::make_shared<ArrayLoader::Unreffer<T>>(arr);
+         return;
+      }
+      arr = ShmVector<T>((shm_name_t)m_snd.objectId());
+      if (!arr.valid())
+         arr.construct();
+      arr->resize(m_snd.arraySize());
+      const uint64_t dim[3] = { m_snd.arrayDimension(0), m_snd.arrayDimension(1), m_snd.arrayDimension(2) };
+      if (dim[0]*dim[1]*dim[2] == m_snd.arraySize())
+         arr->setDimensionHint(dim[0], dim[1], dim[2]);
+      arr->setExact(m_snd.arrayExact());
+      m_data = reinterpret_cast<char *>(arr->data());
+      m_owner = std::make_shared<ArrayLoader::Unreffer<T>>(arr);
+   }
+
+   const message::SendObject &m_snd;
+   bool m_ok = false;
+   char *m_data = nullptr; //!< nullptr if array already existed
+   std::shared_ptr<ArrayLoader::ArrayOwner> m_owner;
+};
+
 }
 
 DataManager::DataManager(mpi::communicator &comm)
@@ -128,8 +307,15 @@ bool DataManager::dispatch() {
             assert(status->tag() == Communicator::TagData);
             m_comm.recv(status->source(), Communicator::TagData, buf.data(), m_msgSize);
             if (buf.payloadSize() > 0) {
-                payload.resize(buf.payloadSize());
-                m_comm.recv(status->source(), Communicator::TagData, payload.data(), buf.payloadSize());
+                char *raw = nullptr;
+                if (buf.type() == message::SENDOBJECT && buf.as<message::SendObject>().isRawArray())
+                    raw = prepareRawArray(buf.as<message::SendObject>());
+                if (raw) {
+                    m_comm.recv(status->source(), Communicator::TagData, raw, buf.payloadSize());
+                } else {
+                    payload.resize(buf.payloadSize());
+                    m_comm.recv(status->source(), Communicator::TagData, payload.data(), buf.payloadSize());
+                }
             }
             guard.unlock();
             work = true;
@@ -149,30 +335,138 @@ void DataManager::trace(message::Type type) {
 
 bool DataManager::send(const message::Message &message, std::shared_ptr<buffer> payload) {
 
+   return send(message, payload ? payload->data() : nullptr, payload ? payload->size() : 0, payload);
+}
+
+bool DataManager::send(const message::Message &message, const char *payload, size_t size, std::shared_ptr<const void> owner) {
+
    if (isLocal(message.destId())) {
        std::unique_lock<Communicator> guard(Communicator::the());
        const int sz = message.size();
        m_comm.send(message.destRank(), Communicator::TagData, sz);
        m_comm.send(message.destRank(), Communicator::TagData, (const char *)&message, sz);
-       if (payload && payload->size() > 0) {
-           m_comm.send(message.destRank(), Communicator::TagData, payload->data(), payload->size());
+       if (payload && size > 0) {
+           m_comm.send(message.destRank(), Communicator::TagData, payload, size);
        }
        return true;
    } else {
 #ifdef ASYNC_SEND
        //CERR << "async send: " << message << std::endl;
-       message::async_send(m_dataSocket, message, payload, [this](boost::system::error_code ec){
+       message::async_send(m_dataSocket, message, payload, size, owner, [this](boost::system::error_code ec){
            if (ec) {
                CERR << "ERROR: async send to " << m_dataSocket.remote_endpoint() << " failed: " << ec.message() << std::endl;
            }
        });
        return true;
 #else
-       return message::send(m_dataSocket, message, payload.get());
+       message::error_code ec;
+       return message::send(m_dataSocket, message, ec, payload, size);
 #endif
    }
 }
 
+bool DataManager::sendRawArrays() const {
+
+   // compression requires an intermediate buffer anyway
+   auto &mgr = Communicator::the().clusterManager();
+   return mgr.archiveCompressionMode() == message::CompressionNone && mgr.fieldCompressionMode() == Uncompressed;
+}
+
+char *DataManager::prepareRawArray(const message::SendObject &snd) {
+
+   RawArraySink sink(snd);
+   boost::mpl::for_each<VectorTypes>(boost::reference_wrapper<RawArraySink>(sink));
+   if (!sink.m_ok || !sink.m_data)
+       return nullptr;
+
+   std::lock_guard<std::mutex> lock(m_requestMutex);
+   m_rawArrays[snd.objectId()] = sink.m_owner;
+   return sink.m_data;
+}
+
+void DataManager::reportTransfer(const message::SendObject &snd, FieldCompressionMode field, uint64_t rawSize, double bandwidth) {
+
+    message::DataTransferState state(m_numInTransit);
+    state.setTransferStatistics(snd.objectId(), field, snd.payloadCompression(), rawSize, snd.payloadSize(), snd.compressionTime(), bandwidth);
+    reportStatus(state);
+}
+
+bool DataManager::contentSent(int hub, uint64_t hash) {
+
+    std::lock_guard<std::mutex> lock(m_contentMutex);
+    auto it = m_sentContent.find(hub);
+    return it != m_sentContent.end() && it->second.find(hash) != it->second.end();
+}
+
+void DataManager::markContentSent(int hub, uint64_t hash) {
+
+    std::lock_guard<std::mutex> lock(m_contentMutex);
+    auto &sent = m_sentContent[hub];
+    if (sent.size() >= MaxContentCache)
+        sent.clear();
+    sent.insert(hash);
+}
+
+bool DataManager::aliasArray(const message::SendObject &snd) {
+
+    std::string name;
+    {
+        std::lock_guard<std::mutex> lock(m_contentMutex);
+        auto it = m_contentCache.find(snd.contentHash());
+        if (it != m_contentCache.end())
+            name = it->second;
+    }
+
+    if (!name.empty()) {
+        RawArraySource local(name, snd.objectType());
+        boost::mpl::for_each<VectorTypes>(boost::reference_wrapper<RawArraySource>(local));
+        if (local.m_ok) {
+#ifdef DEBUG
+            CERR << "aliasing array " << snd.objectId() << " to " << name << std::endl;
+#endif
+            completeArrayRequest(snd, name);
+            return true;
+        }
+        std::lock_guard<std::mutex> lock(m_contentMutex);
+        m_contentCache.erase(snd.contentHash());
+    }
+
+    // local copy has been deleted in the meantime
+    message::RequestObject req(snd.senderId(), snd.rank(), snd.objectId(), snd.objectType(), snd.referrer());
+    req.setAllowAlias(false);
+    return send(req);
+}
+
+void DataManager::completeArrayRequest(const message::SendObject &snd, const std::string &name) {
+
+    if (snd.contentHash() && !snd.isDuplicate()) {
+        std::lock_guard<std::mutex> lock(m_contentMutex);
+        if (m_contentCache.size() >= MaxContentCache)
+            m_contentCache.clear();
+        m_contentCache[snd.contentHash()] = snd.objectId();
+    }
+
+    const std::string local = name.empty() ? std::string(snd.objectId()) : name;
+    std::unique_lock<std::mutex> lock(m_requestMutex);
+    //CERR << "restored array " << snd.objectId() << ", dangling in memory" << std::endl;
+    auto it = m_requestedArrays.find(snd.objectId());
+    if (it == m_requestedArrays.end()) {
+        CERR << "restored array " << snd.objectId() << " for " << snd.referrer() << ", but did not find request" << std::endl;
+    }
+    assert(it != m_requestedArrays.end());
+    if (it != m_requestedArrays.end()) {
+        auto handlers = std::move(it->second);
+#ifdef DEBUG
+        CERR << "restored array " << snd.objectId() << ", " << handlers.size() << " completion handler" << std::endl;
+#endif
+        m_requestedArrays.erase(it);
+        lock.unlock();
+        for (const auto &completionHandler: handlers)
+            completionHandler(local);
+        lock.lock();
+    }
+}
+
 bool DataManager::requestArray(const std::string &referrer, const std::string &arrayId, int type, int hub, int rank, const ArrayCompletionHandler &handler) {
 
     //CERR << "requesting array: " << arrayId << " for " << referrer << std::endl;
@@ -193,10 +487,37 @@ bool DataManager::requestArray(const std::string &referrer, const std::string &a
     }
 
     message::RequestObject req(hub, rank, arrayId, type, referrer);
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        m_arrayRequestTime[arrayId] = Clock::time();
+        auto it = m_hubBandwidth.find(hub);
+        if (it != m_hubBandwidth.end())
+            req.setBandwidth(it->second);
+    }
     send(req);
     return true;
 }
 
+void DataManager::recordThroughput(const message::SendObject &snd) {
+
+    const double now = Clock::time();
+    const int hub = Communicator::the().clusterManager().state().getHub(snd.senderId());
+
+    std::lock_guard<std::mutex> lock(m_requestMutex);
+    auto it = m_arrayRequestTime.find(snd.objectId());
+    if (it == m_arrayRequestTime.end())
+        return;
+    const double elapsed = now-it->second-snd.compressionTime();
+    m_arrayRequestTime.erase(it);
+
+    // latency dominates for small payloads
+    if (snd.payloadSize() < MinAdaptiveBytes || elapsed <= 0.)
+        return;
+    const double sample = snd.payloadSize()/elapsed;
+    auto &bw = m_hubBandwidth[hub];
+    bw = bw > 0. ? 0.75*bw+0.25*sample : sample;
+}
+
 bool DataManager::requestObject(const message::AddObject &add, const std::string &objId, const ObjectCompletionHandler &handler) {
 
    Object::const_ptr obj = Shm::the().getObjectFromName(objId);
@@ -297,12 +618,18 @@ bool DataManager::completeTransfer(const message::AddObjectCompleted &complete)
 
 void DataManager::updateStatus() {
 
+    m_numInTransit = m_inTransitObjects.size();
+    reportStatus(message::DataTransferState(m_numInTransit));
+}
+
+void DataManager::reportStatus(const message::DataTransferState &state) {
+
     std::unique_lock<Communicator> guard(Communicator::the());
 
     if (m_rank == 0)
-        Communicator::the().handleMessage(message::DataTransferState(m_inTransitObjects.size()));
+        Communicator::the().handleMessage(state);
     else
-        Communicator::the().forwardToMaster(message::DataTransferState(m_inTransitObjects.size()));
+        Communicator::the().forwardToMaster(state);
 }
 
 bool DataManager::notifyTransferComplete(const message::AddObject &addObj) {
@@ -392,15 +719,67 @@ bool DataManager::handlePriv(const message::RequestObject &req) {
 #endif
 
     auto fut = std::async(std::launch::async, [this, req](){
+        ProfileSpan span(req.isArray() ? "serve array" : "serve object", Profiler::Transfer);
+        auto &mgr = Communicator::the().clusterManager();
+        const bool remote = !isLocal(req.senderId());
+        const bool adaptive = remote && req.isArray() && mgr.adaptiveCompression();
+        const double bandwidth = req.bandwidth() > 0. ? req.bandwidth() : DefaultBandwidth;
+        CompressionChoice choice;
+        choice.field = mgr.fieldCompressionMode();
+        choice.mode = mgr.archiveCompressionMode();
+        uint64_t rawSize = 0, hash = 0;
+
+        if (req.isArray() && (remote || sendRawArrays())) {
+            RawArraySource src(req.objectId(), req.arrayType());
+            boost::mpl::for_each<VectorTypes>(boost::reference_wrapper<RawArraySource>(src));
+            if (src.m_ok) {
+                rawSize = src.m_bytes;
+                span.setArg(rawSize);
+                if (remote) {
+                    const int hub = Communicator::the().clusterManager().state().getHub(req.senderId());
+                    const uint64_t contents = arrayHash(src);
+                    if (req.allowAlias() && contentSent(hub, contents)) {
+                        // requester can use its copy of an identical array
+                        message::SendObject snd(req, 0);
+                        snd.setContentHash(contents);
+                        snd.setDuplicate(true);
+                        snd.setDestId(req.senderId());
+                        snd.setDestRank(req.rank());
+                        reportTransfer(snd, Uncompressed, rawSize, bandwidth);
+                        return send(snd);
+                    }
+                    if (adaptive)
+                        choice = chooseCompression(src, bandwidth);
+                    // lossy copies must not stand in for the original
+                    if (choice.field == Uncompressed || src.m_exact) {
+                        hash = contents;
+                        markContentSent(hub, hash);
+                    }
+                }
+            }
+            if (src.m_ok && choice.field == Uncompressed && choice.mode == message::CompressionNone) {
+                // hand array memory directly to the network layer
+                message::SendObject snd(req, src.m_bytes);
+                snd.setRawArray(src.m_size, src.m_dim, src.m_exact);
+                snd.setContentHash(hash);
+                snd.setDestId(req.senderId());
+                snd.setDestRank(req.rank());
+                if (remote)
+                    reportTransfer(snd, Uncompressed, rawSize, bandwidth);
+                return send(snd, src.m_data, src.m_bytes, src.m_owner);
+            }
+        }
+
+        const double start = Clock::time();
         std::shared_ptr<message::SendObject> snd;
         vecostreambuf<buffer> buf;
         buffer &mem = buf.get_vector();
         vistle::oarchive memar(buf);
 #ifdef USE_YAS
-        memar.setCompressionMode(Communicator::the().clusterManager().fieldCompressionMode());
-        memar.setZfpRate(Communicator::the().clusterManager().zfpRate());
-        memar.setZfpPrecision(Communicator::the().clusterManager().zfpPrecision());
-        memar.setZfpAccuracy(Communicator::the().clusterManager().zfpAccuracy());
+        memar.setCompressionMode(choice.field);
+        memar.setZfpRate(mgr.zfpRate());
+        memar.setZfpPrecision(mgr.zfpPrecision());
+        memar.setZfpAccuracy(mgr.zfpAccuracy());
 #endif
         if (req.isArray()) {
             ArraySaver saver(req.objectId(), req.arrayType(), memar);
@@ -409,6 +788,7 @@ bool DataManager::handlePriv(const message::RequestObject &req) {
                 return false;
             }
             snd.reset(new message::SendObject(req, mem.size()));
+            snd->setContentHash(hash);
         } else {
             Object::const_ptr obj = Shm::the().getObjectFromName(req.objectId());
             if (!obj) {
@@ -420,10 +800,14 @@ bool DataManager::handlePriv(const message::RequestObject &req) {
         }
 
         auto compressed = std::make_shared<buffer>();
-        *compressed = message::compressPayload(Communicator::the().clusterManager().archiveCompressionMode(), *snd, mem, Communicator::the().clusterManager().archiveCompressionSpeed());
+        *compressed = message::compressPayload(choice.mode, *snd, mem, mgr.archiveCompressionSpeed());
+        snd->setCompressionTime(Clock::time()-start);
 
         snd->setDestId(req.senderId());
         snd->setDestRank(req.rank());
+        span.setArg(snd->payloadRawSize());
+        if (remote)
+            reportTransfer(*snd, choice.field, rawSize ? rawSize : snd->payloadRawSize(), bandwidth);
         send(*snd, compressed);
         //CERR << "sent " << snd->payloadSize() << "(" << snd->payloadRawSize() << ") bytes for " << req << " with " << *snd << std::endl;
 
@@ -446,9 +830,44 @@ bool DataManager::handlePriv(const message::SendObject &snd, buffer *payload) {
     }
 #endif
 
+    ProfileSpan span(snd.isArray() ? "receive array" : "receive object", Profiler::Transfer, snd.payloadSize());
+
+    if (snd.isArray())
+        recordThroughput(snd);
+
+    if (snd.isDuplicate())
+        return aliasArray(snd);
+
+    if (snd.isRawArray()) {
+        std::shared_ptr<const void> owner;
+        {
+            std::lock_guard<std::mutex> lock(m_requestMutex);
+            auto it = m_rawArrays.find(snd.objectId());
+            if (it != m_rawArrays.end()) {
+                owner = it->second;
+                m_rawArrays.erase(it);
+            }
+        }
+        if (!owner) {
+            // could not be received in place
+            RawArraySink sink(snd);
+            boost::mpl::for_each<VectorTypes>(boost::reference_wrapper<RawArraySink>(sink));
+            if (!sink.m_ok) {
+                CERR << "failed to restore raw array " << snd.objectId() << std::endl;
+                return false;
+            }
+            if (sink.m_data && payload && payload->size() == snd.payloadSize())
+                memcpy(sink.m_data, payload->data(), payload->size());
+            owner = sink.m_owner;
+        }
+        completeArrayRequest(snd);
+        return true;
+    }
+
     auto payload2 = std::make_shared<buffer>(std::move(*payload));
     auto fut = std::async(std::launch::async, [this, snd, payload2](){
 
+        ProfileSpan span("restore", Profiler::Transfer, snd.payloadRawSize());
         buffer uncompressed = decompressPayload(snd, *payload2.get());
         vecistreambuf<buffer> membuf(uncompressed);
 
@@ -461,25 +880,7 @@ bool DataManager::handlePriv(const message::SendObject &snd, buffer *payload) {
                 return false;
             }
 
-            std::unique_lock<std::mutex> lock(m_requestMutex);
-            //CERR << "restored array " << snd.objectId() << ", dangling in memory" << std::endl;
-            auto it = m_requestedArrays.find(snd.objectId());
-            if (it == m_requestedArrays.end()) {
-                CERR << "restored array " << snd.objectId() << " for " << snd.referrer() << ", but did not find request" << std::endl;
-            }
-            assert(it != m_requestedArrays.end());
-            if (it != m_requestedArrays.end()) {
-                auto handlers = std::move(it->second);
-#ifdef DEBUG
-                CERR << "restored array " << snd.objectId() << ", " << handlers.size() << " completion handler" << std::endl;
-#endif
-                m_requestedArrays.erase(it);
-                lock.unlock();
-                for (const auto &completionHandler: handlers)
-                    completionHandler(snd.objectId());
-                lock.lock();
-            }
-
+            completeArrayRequest(snd);
             return true;
         }
 
@@ -573,11 +974,27 @@ void DataManager::recvLoop()
             message::Buffer buf;
             buffer payload;
             message::error_code ec;
-            if (message::recv(m_dataSocket, buf, ec, false, &payload)) {
-                gotMsg = true;
-                std::lock_guard<std::mutex> guard(m_recvMutex);
-                m_recvQueue.emplace_back(std::move(buf), std::move(payload));
-                //CERR << "Data received" << std::endl;
+            if (message::recv_message(m_dataSocket, buf, ec, false)) {
+                // receive elements of raw arrays directly into shared memory
+                char *raw = nullptr;
+                if (buf.type() == message::SENDOBJECT && buf.as<message::SendObject>().isRawArray() && buf.payloadSize() > 0)
+                    raw = prepareRawArray(buf.as<message::SendObject>());
+                bool ok = true;
+                if (raw) {
+                    asio::read(m_dataSocket, asio::buffer(raw, buf.payloadSize()), ec);
+                    if (ec) {
+                        CERR << "receiving raw array failed: " << ec.message() << std::endl;
+                        ok = false;
+                    }
+                } else {
+                    ok = message::recv_payload(m_dataSocket, buf, ec, &payload);
+                }
+                if (ok) {
+                    gotMsg = true;
+                    std::lock_guard<std::mutex> guard(m_recvMutex);
+                    m_recvQueue.emplace_back(std::move(buf), std::move(payload));
+                    //CERR << "Data received" << std::endl;
+                }
             } else if (ec) {
                 CERR << "Data communication error: " << ec.message() << std::endl;
             }
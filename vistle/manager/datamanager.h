@@ -1,6 +1,7 @@
 #ifndef DATAMANAGER_H
 #define DATAMANAGER_H
 
+#include <atomic>
 #include <deque>
 #include <functional>
 #include <future>
@@ -10,6 +11,7 @@
 #include <vistle/core/message.h>
 #include <vistle/core/messages.h>
 #include <vistle/core/object.h>
+#include <vistle/core/archives_config.h>
 #include <vistle/util/buffer.h>
 
 #if BOOST_VERSION >= 106600
@@ -47,6 +49,8 @@ public:
     void trace(message::Type type);
 
     bool send(const message::Message &message, std::shared_ptr<buffer> payload=nullptr);
+    //! send size bytes at payload without copying them, owner is kept alive until they have been sent
+    bool send(const message::Message &message, const char *payload, size_t size, std::shared_ptr<const void> owner);
 
     struct Msg {
        Msg(message::Buffer &&buf, buffer &&payload);
@@ -59,6 +63,23 @@ private:
     bool handlePriv(const message::SendObject &snd, buffer *payload);
     bool handlePriv(const message::AddObjectCompleted &complete);
     void updateStatus();
+    //! forward state to rank 0 of cluster manager
+    void reportStatus(const message::DataTransferState &state);
+    //! report statistics of sending an array or object with snd to a remote hub
+    void reportTransfer(const message::SendObject &snd, FieldCompressionMode field, uint64_t rawSize, double bandwidth);
+    //! update throughput estimate for hub that sent array with snd
+    void recordThroughput(const message::SendObject &snd);
+    //! whether arrays can be sent without serialization
+    bool sendRawArrays() const;
+    //! construct array announced by snd, returns memory its elements can be received into or nullptr
+    char *prepareRawArray(const message::SendObject &snd);
+    //! notify all requesters of array received with snd, which is available locally as name (default: its own name)
+    void completeArrayRequest(const message::SendObject &snd, const std::string &name=std::string());
+    //! whether an array with content hash has been sent to hub
+    bool contentSent(int hub, uint64_t hash);
+    void markContentSent(int hub, uint64_t hash);
+    //! satisfy request for array announced as duplicate by snd with an identical local array
+    bool aliasArray(const message::SendObject &snd);
 
     std::mutex m_recvMutex;
     std::deque<Msg> m_recvQueue;
@@ -77,10 +98,18 @@ private:
     boost::asio::ip::tcp::socket m_dataSocket;
 
     std::set<message::AddObject> m_inTransitObjects; //!< objects for which AddObject messages have been sent to remote hubs -- cannot be deleted yet
+    std::atomic<size_t> m_numInTransit{0};
 
     std::map<std::string, std::set<message::AddObject>> m_outstandingAdds; //!< AddObject messages for which requests to retrieve objects from remote have been sent
 
     std::map<std::string, std::vector<ArrayCompletionHandler>> m_requestedArrays; //!< requests for (sub-)objects which have not been serviced yet
+    std::map<std::string, std::shared_ptr<const void>> m_rawArrays; //!< arrays received in place, kept until their requests have been completed
+    std::map<std::string, double> m_arrayRequestTime; //!< when arrays have been requested
+    std::map<int, double> m_hubBandwidth; //!< smoothed throughput in bytes/s of array transfers from hubs
+
+    std::mutex m_contentMutex;
+    std::map<int, std::set<uint64_t>> m_sentContent; //!< content hashes of arrays sent to remote hubs
+    std::map<uint64_t, std::string> m_contentCache; //!< names of arrays received from remote hubs by content hash
 
     struct OutstandingObject {
        vistle::Object::const_ptr obj;
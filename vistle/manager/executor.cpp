@@ -21,6 +21,7 @@
 #include <vistle/core/messagequeue.h>
 #include <vistle/core/object.h>
 #include <vistle/core/shm.h>
+#include <vistle/core/shmconfig.h>
 
 #include "communicator.h"
 #include "executor.h"
@@ -68,6 +69,15 @@ Executor::Executor(int argc, char *argv[], boost::mpi::communicator comm)
          first = false;
 #endif
 
+   // placement of shared memory segment is configured from the environment of rank 0
+   ShmConfig shmConfig = ShmConfig::fromEnvironment();
+   mpi::broadcast(comm, shmConfig.hugePages, 0);
+   mpi::broadcast(comm, shmConfig.numaPolicy, 0);
+   mpi::broadcast(comm, shmConfig.largeArrayBytes, 0);
+   ShmConfig::setCurrent(shmConfig);
+   if (m_rank == 0)
+      std::cerr << "shared memory placement: " << shmConfig.toString() << std::endl;
+
    if (first) {
       vistle::Shm::remove(m_name, 0, m_rank);
       vistle::Shm::create(m_name, 0, m_rank);
@@ -741,10 +741,12 @@ bool Color::prepare() {
    if (m_reverse)
        std::swap(m_min, m_max);
    m_inputQueue.clear();
+   m_streamRangeValid = false;
+   m_numStreamed = 0;
 
    computeMap();
 
-   bool preview = getIntParameter("preview");
+   bool preview = getIntParameter("preview") || streaming();
    if (m_autoRange || (m_nest && m_autoInsetCenter)) {
        if (preview)
            startIteration();
@@ -768,7 +770,8 @@ bool Color::compute() {
    }
 
    getMinMax(data, m_dataMin, m_dataMax);
-   bool preview = getIntParameter("preview");
+   // while streaming, queued blocks are mapped in reduceIncremental
+   bool preview = getIntParameter("preview") && !streaming();
    if (m_autoRange) {
        m_inputQueue.push_back(data);
        if (preview)
@@ -784,10 +787,40 @@ bool Color::compute() {
    return true;
 }
 
+bool Color::reduceIncremental(int timestep) {
+
+    if (!m_autoRange && !(m_nest && m_autoInsetCenter))
+        return true;
+
+    if (m_autoRange && m_dataMin <= m_dataMax
+            && (!m_streamRangeValid || m_dataMin < m_min || m_dataMax > m_max)) {
+        // range of blocks received so far has grown: re-map all of them
+        m_min = m_dataMin;
+        m_max = m_dataMax;
+        if (m_min == m_max)
+            m_max = m_min + 1.;
+        m_reverse = false;
+        computeMap();
+        if (m_numStreamed > 0)
+            startIteration();
+        m_numStreamed = 0;
+        m_streamRangeValid = true;
+    }
+
+    for (; m_numStreamed < m_inputQueue.size(); ++m_numStreamed) {
+        if (cancelRequested())
+            break;
+        process(m_inputQueue[m_numStreamed]);
+    }
+
+    return true;
+}
+
 bool Color::reduce(int timestep) {
 
     assert(timestep == -1);
-    bool preview = getIntParameter("preview");
+    bool preview = getIntParameter("preview") || streaming();
+    Scalar streamMin = m_min, streamMax = m_max;
 
     m_dataMin = boost::mpi::all_reduce(comm(), m_dataMin, boost::mpi::minimum<Scalar>());
     m_dataMax = boost::mpi::all_reduce(comm(), m_dataMax, boost::mpi::maximum<Scalar>());
@@ -853,7 +886,14 @@ bool Color::reduce(int timestep) {
         }
     }
 
-    if (m_autoRange || (m_nest && m_autoInsetCenter)) {
+    // if local range matched global range, output sent while streaming is final
+    bool streamedFinal = streaming() && m_streamRangeValid && !(m_nest && m_autoInsetCenter)
+            && m_numStreamed == m_inputQueue.size()
+            && !m_reverse && m_min == streamMin && m_max == streamMax;
+    if (streamedFinal)
+        m_inputQueue.clear();
+
+    if (!streamedFinal && (m_autoRange || (m_nest && m_autoInsetCenter))) {
         computeMap();
         if (preview)
             startIteration();
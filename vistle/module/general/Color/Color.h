@@ -40,6 +40,7 @@ class Color: public vistle::Module {
    bool prepare() override;
    bool compute() override;
    bool reduce(int timestep) override;
+   bool reduceIncremental(int timestep) override;
    void connectionAdded(const vistle::Port *from, const vistle::Port *to) override;
 
    void process(const vistle::DataBase::const_ptr data);
@@ -65,6 +66,8 @@ class Color: public vistle::Module {
    vistle::Scalar m_dataMin, m_dataMax;
    vistle::Scalar m_min, m_max;
    bool m_reverse = false;
+   bool m_streamRangeValid = false; //!< m_min/m_max have been set from blocks received while streaming
+   size_t m_numStreamed = 0; //!< number of queued blocks already mapped with current range while streaming
 
    std::string m_species;
    bool m_colorMapSent = false;
@@ -67,6 +67,7 @@ IsoSurface::IsoSurface(const std::string &name, int moduleID, mpi::communicator
    V_ENUM_SET_CHOICES(m_processortype, ThrustBackend);
 
    m_computeNormals = addIntParameter("compute_normals", "compute normals (structured grids only)", 1, Parameter::Boolean);
+   m_shareVertices = addIntParameter("share_vertices", "generate each vertex only once per block and output indexed triangles (volume grids, host processortype only)", 0, Parameter::Boolean);
 
    m_paraMin = m_paraMax = 0.f;
 }
@@ -190,6 +191,7 @@ Object::ptr IsoSurface::work(vistle::Object::const_ptr grid,
 
    Leveller l(isocontrol, grid, isoValue, processorType);
    l.setComputeNormals(m_computeNormals->getValue());
+   l.setShareVertices(m_shareVertices->getValue());
 
 #ifndef CUTTINGSURFACE
    l.setIsoData(dataS);
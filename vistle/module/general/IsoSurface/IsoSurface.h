@@ -59,6 +59,7 @@ class IsoSurface: public vistle::Module {
    vistle::IntParameter *m_pointOrValue;
    vistle::IntParameter *m_processortype;
    vistle::IntParameter *m_computeNormals;
+   vistle::IntParameter *m_shareVertices;
    vistle::Port *m_mapDataIn, *m_dataOut;
 
    mutable vistle::Scalar m_min, m_max;
@@ -18,8 +18,12 @@
 #include <thrust/sequence.h>
 #include <thrust/copy.h>
 #include <thrust/count.h>
+#include <thrust/sort.h>
+#include <thrust/gather.h>
+#include <thrust/scatter.h>
 #include <thrust/iterator/zip_iterator.h>
 #include <thrust/iterator/constant_iterator.h>
+#include <thrust/iterator/transform_iterator.h>
 #include <thrust/tuple.h>
 #include "tables.h"
 
@@ -57,12 +61,15 @@ struct HostData {
    std::vector<Scalar*> m_outVertPtr, m_outCellPtr;
    std::vector<Index *> m_outVertPtrI, m_outCellPtrI;
    std::vector<Byte *> m_outVertPtrB, m_outCellPtrB;
+   std::vector<Index> m_outEdge[2]; //!< input vertices of edge on which output vertex lies, ordered by index
+   Index *m_outEdgePtr[2] = {nullptr, nullptr};
    bool m_isUnstructured = false;
    bool m_isPoly = false;
    bool m_isTri = false;
    bool m_isQuad = false;
    bool m_haveCoords = false;
    bool m_computeNormals = false;
+   bool m_shareVertices = false;
 
    typedef const Byte *TypeIterator;
    typedef const Index *IndexIterator;
@@ -193,6 +200,10 @@ struct HostData {
        m_computeNormals = val;
    }
 
+   void setShareVertices(bool val) {
+       m_shareVertices = val;
+   }
+
    void addmappeddata(const Scalar *mapdata){
 
       m_inVertPtr.push_back(mapdata);
@@ -269,12 +280,15 @@ struct DeviceData {
    std::vector<thrust::device_ptr<Scalar> > m_outVertPtr, m_outCellPtr;
    std::vector<thrust::device_ptr<Index> > m_outVertPtrI, m_outCellPtrI;
    std::vector<thrust::device_ptr<Byte> > m_outVertPtrB, m_outCellPtrB;
+   thrust::device_vector<Index> m_outEdge[2];
+   thrust::device_ptr<Index> m_outEdgePtr[2];
    bool m_isUnstructured = false;
    bool m_isPoly = false;
    bool m_isTri = false;
    bool m_isQuad = false;
    bool m_haveCoords = false;
    bool m_computeNormals = false;
+   bool m_shareVertices = false;
    //typedef const Index *IndexIterator;
    typedef thrust::device_vector<Index>::iterator IndexIterator;
 
@@ -352,10 +366,33 @@ struct ComputeOutput {
       for (int i = 0; i < m_data.m_numInCellDataB; i++){
          m_data.m_outCellPtrB[i] = m_data.m_outCellDataB[i]->data();
       }
+      if (m_data.m_shareVertices) {
+         for (int i = 0; i < 2; i++){
+            m_data.m_outEdgePtr[i] = m_data.m_outEdge[i].data();
+         }
+      }
    }
 
    Data &m_data;
 
+   // record edge between input vertices v1 and v2 as origin of output vertex
+   __host__ __device__
+   void setEdge(Index outvertexindex, Index v1, Index v2) {
+      if (m_data.m_shareVertices) {
+         m_data.m_outEdgePtr[0][outvertexindex] = v1 < v2 ? v1 : v2;
+         m_data.m_outEdgePtr[1][outvertexindex] = v1 < v2 ? v2 : v1;
+      }
+   }
+
+   // output vertex not on an edge, shared only with other vertices of the same cell center
+   __host__ __device__
+   void setCenter(Index outvertexindex, Index center) {
+      if (m_data.m_shareVertices) {
+         m_data.m_outEdgePtr[0][outvertexindex] = center;
+         m_data.m_outEdgePtr[1][outvertexindex] = InvalidIndex;
+      }
+   }
+
    __host__ __device__
    void operator()(Index ValidCellIndex) {
 
@@ -385,6 +422,7 @@ struct ComputeOutput {
     const unsigned int v2 = edgeTable[1][edge]; \
     const Scalar t = tinterp(m_data.m_isovalue, field[v1], field[v2]); \
     Index outvertexindex = m_data.m_LocationList[ValidCellIndex]+idx; \
+    setEdge(outvertexindex, cl[v1], cl[v2]); \
     for(int j = nc; j < m_data.m_numInVertData; j++) { \
         m_data.m_outVertPtr[j][outvertexindex] = \
             lerp(m_data.m_inVertPtr[j][cl[v1]], m_data.m_inVertPtr[j][cl[v2]], t); \
@@ -514,6 +552,7 @@ struct ComputeOutput {
                                   out -= 1;
                           }
                           Scalar t = tinterp(m_data.m_isovalue, d1, d2);
+                          setEdge(out, c1, c2);
                           for(int i = 0; i < m_data.m_numInVertData; i++) {
                               Scalar v = lerp(cd1[i], cd2[i], t);
                               middleData[i] += v;
@@ -552,6 +591,7 @@ struct ComputeOutput {
               }
               for (Index i = 2; i < numVert; i += 3) {
                   const Index idx = m_data.m_LocationList[ValidCellIndex]+i;
+                  setCenter(idx, m_data.m_LocationList[ValidCellIndex]);
                   for(int i = 0; i < m_data.m_numInVertData; i++){
                       m_data.m_outVertPtr[i][idx] = middleData[i];
                   }
@@ -632,6 +672,7 @@ struct ComputeOutput {
                                       out -= 1;
                               }
                               Scalar t = tinterp(m_data.m_isovalue, d1, d2);
+                              setEdge(out, c1, c2);
                               for(int i = 0; i < m_data.m_numInVertData; i++) {
                                   Scalar v = lerp(cd1[i], cd2[i], t);
                                   middleData[i] += v;
@@ -670,6 +711,7 @@ struct ComputeOutput {
               }
               for (Index i = 2; i < numVert; i += 3) {
                   const Index idx = m_data.m_LocationList[ValidCellIndex]+i;
+                  setCenter(idx, m_data.m_LocationList[ValidCellIndex]);
                   for(int i = 0; i < m_data.m_numInVertData; i++){
                       m_data.m_outVertPtr[i][idx] = middleData[i];
                   }
@@ -690,6 +732,7 @@ struct ComputeOutput {
     const unsigned int v2 = edgeTable[1][edge]; \
     const Scalar t = tinterp(m_data.m_isovalue, field[v1], field[v2]); \
     Index outvertexindex = m_data.m_LocationList[ValidCellIndex]+idx; \
+    setEdge(outvertexindex, base+v1, base+v2); \
     for(int j = nc; j < m_data.m_numInVertData; j++) { \
         m_data.m_outVertPtr[j][outvertexindex] = \
             lerp(m_data.m_inVertPtr[j][base+v1], m_data.m_inVertPtr[j][base+v2], t); \
@@ -1127,6 +1170,8 @@ Leveller::Leveller(const IsoController &isocontrol, Object::const_ptr grid, cons
       , gmin(std::numeric_limits<Scalar>::max())
       , gmax(-std::numeric_limits<Scalar>::max())
       , m_objectTransform(grid->getTransform())
+      , m_computeNormals(false)
+      , m_shareVertices(false)
 {
     if (m_strbase || m_unstr) {
         m_triangles = Triangles::ptr(new Triangles(Object::Initialized));
@@ -1200,12 +1245,101 @@ Index Leveller::calculateSurface(Data &data) {
     for (int i=0; i<data.m_numInCellDataB; ++i) {
         data.m_outCellDataB[i]->resize(totalNumVertices/3);
     }
+    if (data.m_shareVertices) {
+        for (int i=0; i<2; ++i) {
+            data.m_outEdge[i].resize(totalNumVertices);
+        }
+    }
     thrust::counting_iterator<Index> start(0), finish(numSelectedCells);
     thrust::for_each(pol(), start, finish, ComputeOutput<Data>(data));
 
     return totalNumVertices;
 }
 
+struct EdgeLess {
+
+   EdgeLess(const Index *v1, const Index *v2) : m_v{v1, v2} {}
+
+   const Index *m_v[2];
+
+   // order output vertices by edge, vertices on the same edge by index
+   __host__ __device__ bool operator()(Index a, Index b) const {
+      if (m_v[0][a] != m_v[0][b])
+         return m_v[0][a] < m_v[0][b];
+      if (m_v[1][a] != m_v[1][b])
+         return m_v[1][a] < m_v[1][b];
+      return a < b;
+   }
+};
+
+struct EdgeStart {
+
+   EdgeStart(const Index *order, const Index *v1, const Index *v2, Index first=1) : m_order(order), m_v{v1, v2}, m_first(first) {}
+
+   const Index *m_order;
+   const Index *m_v[2];
+   Index m_first;
+
+   // whether the i-th output vertex in edge order is the first one on its edge
+   __host__ __device__ Index operator()(Index i) const {
+      if (i == 0)
+         return m_first;
+      const Index a = m_order[i-1], b = m_order[i];
+      return m_v[0][a] != m_v[0][b] || m_v[1][a] != m_v[1][b];
+   }
+};
+
+template<class Data, class pol>
+Index Leveller::shareVertices(Data &data, Index numVertices) {
+
+    const Index *v1 = data.m_outEdge[0].data(), *v2 = data.m_outEdge[1].data();
+    thrust::counting_iterator<Index> first(0), last = first + numVertices;
+
+    // sort output vertices by the edge they were interpolated on
+    std::vector<Index> order(numVertices);
+    thrust::sequence(pol(), order.begin(), order.end());
+    thrust::sort(pol(), order.begin(), order.end(), EdgeLess(v1, v2));
+
+    // number consecutive edges, yielding the index of the shared vertex for each output vertex
+    EdgeStart boundary(order.data(), v1, v2, 0);
+    std::vector<Index> vertex(numVertices);
+    thrust::inclusive_scan(pol(), thrust::make_transform_iterator(first, boundary), thrust::make_transform_iterator(last, boundary), vertex.begin());
+    const Index numShared = numVertices>0 ? vertex.back()+1 : 0;
+
+    auto &cl = m_triangles->cl();
+    cl.resize(numVertices);
+    thrust::scatter(pol(), vertex.begin(), vertex.end(), order.begin(), cl.data());
+    std::vector<Index>().swap(vertex);
+
+    // the first output vertex on each edge provides the data for the shared vertex
+    std::vector<Index> source(numShared);
+    thrust::copy_if(pol(), order.begin(), order.end(), first, source.begin(), EdgeStart(order.data(), v1, v2));
+    std::vector<Index>().swap(order);
+    for (int i=0; i<2; ++i) {
+        std::vector<Index>().swap(data.m_outEdge[i]);
+    }
+
+    for (auto &out: data.m_outVertData) {
+        if (out->size() != numVertices)
+            continue;
+        auto shared = ShmVector<Scalar>::create(numShared);
+        thrust::gather(pol(), source.begin(), source.end(), out->data(), shared->data());
+        out = shared;
+    }
+    for (auto &out: data.m_outVertDataI) {
+        auto shared = ShmVector<Index>::create(numShared);
+        thrust::gather(pol(), source.begin(), source.end(), out->data(), shared->data());
+        out = shared;
+    }
+    for (auto &out: data.m_outVertDataB) {
+        auto shared = ShmVector<Byte>::create(numShared);
+        thrust::gather(pol(), source.begin(), source.end(), out->data(), shared->data());
+        out = shared;
+    }
+
+    return numShared;
+}
+
 bool Leveller::process() {
 #ifndef CUTTINGSURFACE
    Vec<Scalar>::const_ptr dataobj = Vec<Scalar>::as(m_data);
@@ -1280,6 +1414,7 @@ bool Leveller::process() {
              HD.setGhostLayers(ghost);
          }
          HD.setComputeNormals(m_computeNormals);
+         HD.setShareVertices(m_shareVertices && m_triangles);
 
          for (size_t i=0; i<m_vertexdata.size(); ++i) {
             if(Vec<Scalar,1>::const_ptr Scal = Vec<Scalar,1>::as(m_vertexdata[i])){
@@ -1315,6 +1450,8 @@ bool Leveller::process() {
          }
 
          Index totalNumVertices = calculateSurface<HostData, thrust::detail::host_t>(HD);
+         if (HD.m_shareVertices)
+             shareVertices<HostData, thrust::detail::host_t>(HD, totalNumVertices);
 
          {
              size_t idx=0;
@@ -1442,6 +1579,8 @@ bool Leveller::process() {
 
       case Device: {
          std::cerr << "untested Device code path" << std::endl;
+         if (m_shareVertices)
+             std::cerr << "sharing of vertices not supported on Device code path" << std::endl;
          assert("don't use the Device code path" == 0);
 
          DeviceData DD(m_isoValue,
@@ -1521,6 +1660,10 @@ void Leveller::setComputeNormals(bool value) {
     m_computeNormals = value;
 }
 
+void Leveller::setShareVertices(bool value) {
+    m_shareVertices = value;
+}
+
 void Leveller::addMappedData(DataBase::const_ptr mapobj ){
     if (mapobj->mapping() == DataBase::Element)
         m_celldata.push_back(mapobj);
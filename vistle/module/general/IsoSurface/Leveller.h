@@ -55,13 +55,18 @@ class Leveller  {
    vistle::Scalar gmin, gmax;
    vistle::Matrix4 m_objectTransform;
    bool m_computeNormals;
+   bool m_shareVertices;
 
    template<class Data, class pol>
    vistle::Index calculateSurface(Data &data);
+   template<class Data, class pol>
+   vistle::Index shareVertices(Data &data, vistle::Index numVertices);
 
 public:
    Leveller(const IsoController &isocontrol, vistle::Object::const_ptr grid, const vistle::Scalar isovalue, vistle::Index processortype);
    void setComputeNormals(bool value);
+   //! generate each vertex only once per block and output indexed triangles
+   void setShareVertices(bool value);
    void addMappedData(vistle::DataBase::const_ptr mapobj );
 
    bool process();
@@ -1,131 +1,78 @@
-#include <fstream>
-#include <iomanip>
-#include <sstream>
-#include <string>
-
-#include <vistle/core/archives.h>
+#include <vistle/core/mappedarchive.h>
 #include <vistle/core/object.h>
 
 #include "ReadVistle.h"
 
 using namespace vistle;
-namespace ba = boost::archive;
 
 MODULE_MAIN(ReadVistle)
 
-ReadVistle::ReadVistle(const std::string &shmname, const std::string &name, int moduleID)
-   : Module("ReadVistle", shmname, name, moduleID) {
+ReadVistle::ReadVistle(const std::string &name, int moduleID, mpi::communicator comm)
+: Module("read memory-mappable Vistle files", name, moduleID, comm)
+{
+   for (int i=0; i<NumPorts; ++i) {
+      m_outPort[i] = createOutputPort("data_out"+std::to_string(i), "output data "+std::to_string(i));
+   }
 
-   createOutputPort("grid_out");
-   addStringParameter("filename", "Vistle file", "", Parameter::ExistingPathname);
+   p_file = addStringParameter("filename", "base name of Vistle file, .<rank>.vslm is appended", "", Parameter::Filename);
+   setParameterFilters(p_file, "Vistle Files (*.vslm)/All Files (*)");
+   p_start = addIntParameter("start", "start step", 0);
+   setParameterMinimum(p_start, Integer(0));
+   p_stop = addIntParameter("stop", "stop step", 1000);
+   setParameterMinimum(p_stop, Integer(0));
+   p_step = addIntParameter("step", "step width", 1);
+   setParameterMinimum(p_step, Integer(1));
 }
 
 ReadVistle::~ReadVistle() {
 
 }
 
+bool ReadVistle::load(const std::string &filename) {
 
-bool ReadVistle::load(const std::string & name) {
-
-   std::ifstream ifs(name.c_str());
-
-   // read header
-   std::string header;
-   std::getline(ifs, header);
-   std::string vistle, format;
-   int version;
-   std::stringstream str(header);
-   str >> vistle >> format >> version;
-   std::cerr << "vistle: " << vistle << ", format: " << format << ", version: " << version << std::endl;
-   if (vistle != "vistle") {
-
-      std::cerr << "ReadVistle: " << name << " is not a vistle file" << std::endl;
+   auto reader = std::make_shared<MappedArchiveReader>(filename);
+   if (!reader->isOpen()) {
+      sendError("could not read %s", filename.c_str());
       return false;
    }
 
-   do {
-      {
-         std::ios::pos_type pos = ifs.tellg();
-         std::string firstline;
-         std::getline(ifs, firstline);
-         std::cerr << "Reading: pos=" << pos << std::endl;
-         if (format != "binary")
-            std::cerr << "First line: " << firstline << std::endl;
-         ifs.seekg(pos);
-      }
-      ba::detail::basic_iarchive *ia = NULL;
-      try {
-         if (format == "binary") {
-            ia  = new ba::binary_iarchive(ifs);
-         } else if (format == "text") {
-            ia = new ba::text_iarchive(ifs);
-         } else if (format == "xml") {
-            ia = new ba::xml_iarchive(ifs);
-         } else {
-            std::cerr << "ReadVistle: " << format << " is not supported" << std::endl;
-            return false;
-         }
-      } catch(ba::archive_exception e) {
-
-         if (ifs.eof()) {
-            return true;
-         }
-
-         std::cerr << "ReadVistle: failed to initialize archive from stream, exception: " << e.what() << std::endl;
+   const int start = p_start->getValue();
+   const int stop = p_stop->getValue();
+   const int step = p_step->getValue();
+
+   int numObjects = 0;
+   for (const auto &root: reader->roots()) {
+      if (root.port < 0 || root.port >= NumPorts)
+         continue;
+      if (!m_outPort[root.port]->isConnected())
+         continue;
+      const int t = root.timestep;
+      if (t>=0 && (t<start || t>stop || (t-start)%step != 0))
+         continue;
+
+      Object::ptr obj = reader->loadObject(root.object);
+      reader->releaseArrays();
+      if (!obj) {
+         sendError("failed to restore %s from %s", root.object.c_str(), filename.c_str());
          return false;
       }
+      updateMeta(obj);
+      passThroughObject(m_outPort[root.port], obj);
+      ++numObjects;
+   }
 
-      try {
-         Object::ptr obj;
-         if (ba::binary_iarchive *bia = dynamic_cast<ba::binary_iarchive *>(ia)) {
-            obj = Object::load(*bia);
-            delete bia;
-         } else if (ba::text_iarchive *tia = dynamic_cast<ba::text_iarchive *>(ia)) {
-            obj = Object::load(*tia);
-            delete tia;
-         } else if (ba::xml_iarchive *xia = dynamic_cast<ba::xml_iarchive *>(ia)) {
-            obj = Object::load(*xia);
-            delete xia;
-         } else {
-            assert("add support for another archive format" == NULL);
-            return false;
-         }
-         ia = NULL;
-         if (obj) {
-            addObject("grid_out", obj);
-         } else {
-            std::cerr << "Loading failed: no object" << std::endl;
-         }
-      } catch(ba::archive_exception e) {
-
-         if (ifs.eof()) {
-            return true;
-         }
-
-         std::cerr << "ReadVistle: archive exception: " << e.what() << std::endl;
-         if (format != "binary") {
-            std::string line;
-            std::getline(ifs, line);
-            std::cerr << "    next: '" << line << "'" << std::endl;
-            std::getline(ifs, line);
-            std::cerr << "    next: '" << line << "'" << std::endl;
-            std::getline(ifs, line);
-            std::cerr << "    next: '" << line << "'" << std::endl;
-         }
-         return false;
-      }
+   sendInfo("restored %d objects", numObjects);
+   return true;
+}
 
-      std::string line;
-      while (line != "vistle separator") {
-         std::getline(ifs, line);
-      } 
-   } while(!ifs.eof());
+bool ReadVistle::prepare() {
+
+   load(p_file->getValue() + "." + std::to_string(rank()) + ".vslm");
 
    return true;
 }
 
-bool ReadVistle::prepare() {
-   load(getStringParameter("filename"));
+bool ReadVistle::compute() {
 
    return true;
 }
@@ -7,12 +7,21 @@
 class ReadVistle: public vistle::Module {
 
  public:
-   ReadVistle(const std::string &shmname, const std::string &name, int moduleID);
+   static const int NumPorts = 5;
+
+   ReadVistle(const std::string &name, int moduleID, mpi::communicator comm);
    ~ReadVistle();
 
  private:
-   bool load(const std::string & name);
+   bool load(const std::string &filename);
    bool prepare() override;
+   bool compute() override;
+
+   vistle::StringParameter *p_file = nullptr;
+   vistle::IntParameter *p_start = nullptr;
+   vistle::IntParameter *p_stop = nullptr;
+   vistle::IntParameter *p_step = nullptr;
+   vistle::Port *m_outPort[NumPorts];
 };
 
 #endif
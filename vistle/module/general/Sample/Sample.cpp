@@ -65,9 +65,16 @@ int Sample::SampleToGrid(const vistle::GeometryInterface *target, vistle::DataBa
      Vec<Scalar>::ptr dataOut(new Vec<Scalar>(numVert));
      Scalar *ptrOnData = dataOut->x().data();
 
+     std::vector<Vector> points(numVert);
      for (Index i=0; i < numVert; ++i) {
-         Vector v = target->getVertex(i);
-         Index cellIdxIn = inGrid->findCell(v,InvalidIndex,m_useCelltree?GridInterface::NoFlags:GridInterface::NoCelltree);
+         points[i] = target->getVertex(i);
+     }
+     std::vector<Index> cells(numVert);
+     inGrid->findCells(points.data(), numVert, cells.data(), nullptr, m_useCelltree?GridInterface::NoFlags:GridInterface::NoCelltree);
+
+     for (Index i=0; i < numVert; ++i) {
+         const Vector &v = points[i];
+         Index cellIdxIn = cells[i];
          if (cellIdxIn != InvalidIndex) {
              GridInterface::Interpolator interp = inGrid->getInterpolator(cellIdxIn, v, DataBase::Vertex, mode);
              Scalar p = interp(data);
@@ -2,6 +2,7 @@
 #include "Integrator.h"
 #include <vistle/core/vec.h>
 #include <mutex>
+#include <limits>
 
 
 using namespace vistle;
@@ -77,3 +78,22 @@ const Matrix3 &BlockData::velocityTransform() const {
     return m_velocityTransform;
 }
 
+std::pair<Vector3, Vector3> BlockData::bounds() const {
+
+    auto bounds = m_gridInterface->getBounds();
+    Vector3 bmin = bounds.first, bmax = bounds.second;
+    if (m_transform.isIdentity() || bmin[0] > bmax[0])
+        return std::make_pair(bmin, bmax);
+
+    Vector3 tmin, tmax;
+    tmin.fill(std::numeric_limits<Scalar>::max());
+    tmax.fill(-std::numeric_limits<Scalar>::max());
+    for (int i=0; i<8; ++i) {
+        Vector3 corner((i&1) ? bmax[0] : bmin[0], (i&2) ? bmax[1] : bmin[1], (i&4) ? bmax[2] : bmin[2]);
+        corner = transformPoint(m_transform, corner);
+        tmin = tmin.cwiseMin(corner);
+        tmax = tmax.cwiseMax(corner);
+    }
+    return std::make_pair(tmin, tmax);
+}
+
@@ -41,6 +41,8 @@ public:
     const vistle::Matrix4 &transform() const;
     const vistle::Matrix4 &invTransform() const;
     const vistle::Matrix3 &velocityTransform() const;
+    //! axis-aligned bounding box of grid in world coordinates
+    std::pair<vistle::Vector3, vistle::Vector3> bounds() const;
 
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
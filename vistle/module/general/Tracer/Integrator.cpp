@@ -3,6 +3,7 @@
 #include "BlockData.h"
 #include "Tracer.h"
 #include <vistle/core/vec.h>
+#include <vistle/util/math.h>
 
 
 using namespace vistle;
@@ -26,7 +27,7 @@ void Integrator::hInit() {
 
     const auto &global = m_ptcl->m_global;
     const auto mode = global.int_mode;
-    if (mode != RK32) {
+    if (mode != RK32 && mode != RK45) {
         m_h = global.h_init;
         return;
     }
@@ -48,6 +49,19 @@ void Integrator::hInit() {
     }
 
     m_h = unit * h_min;
+
+    if (mode == RK45) {
+        // start with a step reaching the boundary of the current cell
+        const Scalar sign = m_forward ? 1. : -1.;
+        Vector3 vel = m_velTransform*sign*Interpolator(m_ptcl->m_block, el, m_ptcl->m_x);
+        Scalar v = vel.norm();
+        if (v > 0) {
+            Scalar exit = grid->exitDistance(el, m_ptcl->m_x, vel/v);
+            if (exit > 0) {
+                m_h = clamp(exit/v, Scalar(unit*h_min), Scalar(unit*global.h_max));
+            }
+        }
+    }
     m_hact = m_h;
 }
 
@@ -75,6 +89,8 @@ bool Integrator::Step() {
         return StepRK32();
     case ConstantVelocity:
         return StepConstantVelocity();
+    case RK45:
+        return StepRK45();
     }
     return false;
 }
@@ -98,7 +114,7 @@ bool Integrator::StepEuler() {
     return true;
 }
 
-bool Integrator::hNew(Vector3 cur, Vector3 higher, Vector3 lower, Vector vel, Scalar unit){
+bool Integrator::hNew(Vector3 cur, Vector3 higher, Vector3 lower, Vector vel, Scalar unit, int order){
 
    const auto &global = m_ptcl->m_global;
    const auto h_max = global.h_max;
@@ -123,9 +139,11 @@ bool Integrator::hNew(Vector3 cur, Vector3 higher, Vector3 lower, Vector vel, Sc
        return true;
    }
 
-   Scalar h_abs = 0.9*m_h*std::pow(Scalar(tol_abs/errestabs),Scalar(1.0/3.0));
-   Scalar h_rel = 0.9*m_h*std::pow(Scalar(tol_rel/errestrel),Scalar(1.0/3.0));
-   Scalar h = std::min(std::max(h_abs,h_rel), 2*m_h);
+   // higher order methods are allowed to grow their step width faster
+   const Scalar maxGrowth = order>3 ? 5 : 2;
+   Scalar h_abs = 0.9*m_h*std::pow(Scalar(tol_abs/errestabs),Scalar(1.0/order));
+   Scalar h_rel = 0.9*m_h*std::pow(Scalar(tol_rel/errestrel),Scalar(1.0/order));
+   Scalar h = std::min(std::max(h_abs,h_rel), maxGrowth*m_h);
    //Scalar h = 0.9*m_h*std::pow(Scalar(m_errtol/errest),Scalar(1.0/3.0))*unit;
    if(errestabs<=tol_abs || errestrel<=tol_rel) {
       if(h<h_min*unit) {
@@ -212,6 +230,66 @@ bool Integrator::StepRK32() {
    }
 }
 
+// 5th-order Runge-Kutta with embedded 4th-order error estimate (Dormand-Prince)
+bool Integrator::StepRK45() {
+
+   static const Scalar c[7] = { 0, 1./5, 3./10, 4./5, 8./9, 1, 1 };
+   static const Scalar a[7][6] = {
+      {},
+      { 1./5 },
+      { 3./40, 9./40 },
+      { 44./45, -56./15, 32./9 },
+      { 19372./6561, -25360./2187, 64448./6561, -212./729 },
+      { 9017./3168, -355./33, 46732./5247, 49./176, -5103./18656 },
+      { 35./384, 0, 500./1113, 125./192, -2187./6784, 11./84 }, // 5th-order solution
+   };
+   static const Scalar b4[7] = { 5179./57600, 0, 7571./16695, 393./640, -92097./339200, 187./2100, 1./40 };
+
+   Scalar sign = m_forward ? 1. : -1.;
+   Vector3 k[7];
+   k[0] = sign*m_ptcl->m_v;
+   auto grid = m_ptcl->m_block->getGrid();
+   const Vector3 x0 = m_ptcl->m_x;
+   Scalar cellSize = grid->cellDiameter(m_ptcl->m_el);
+
+   for (;;) {
+      // the cell of the previous stage is tried first, so most stages do not require a search
+      Index el = m_ptcl->m_el;
+      Vector3 x = x0;
+      for (int s=1; s<7; ++s) {
+         x = x0;
+         for (int j=0; j<s; ++j)
+            x += m_h*a[s][j]*k[j];
+         Index els = grid->findCell(x, el, m_cellSearchFlags);
+         if (els == InvalidIndex) {
+            m_ptcl->m_x = x;
+            m_hact = c[s]*m_h;
+            return false;
+         }
+         if (els != el) {
+            cellSize = std::min(grid->cellDiameter(els), cellSize);
+            el = els;
+         }
+         k[s] = m_velTransform*sign*Interpolator(m_ptcl->m_block, els, x);
+      }
+
+      Vector3 x4th = x0;
+      for (int j=0; j<7; ++j)
+         x4th += m_h*b4[j]*k[j];
+      m_hact = m_h;
+
+      bool accept = hNew(x0, x, x4th, k[0], cellSize, 5);
+      if (accept) {
+         // last stage is evaluated at the new position (first same as last): keep its cell and velocity
+         m_ptcl->m_x = x;
+         m_ptcl->m_el = el;
+         m_ptcl->m_v = sign*k[6];
+         m_ptcl->m_located = true;
+         return true;
+      }
+   }
+}
+
 bool Integrator::StepConstantVelocity() {
 
     Index el=m_ptcl->m_el;
@@ -7,6 +7,7 @@ DEFINE_ENUM_WITH_STRING_CONVERSIONS(IntegrationMethod,
    (Euler)
    (RK32)
    (ConstantVelocity)
+   (RK45)
 )
 
 class Particle;
@@ -14,6 +15,7 @@ class BlockData;
 
 class Integrator{
 friend class Particle;
+friend class Packet;
 private:
     vistle::Scalar m_h, m_hact;
     Particle* m_ptcl;
@@ -30,9 +32,10 @@ public:
     bool StepEuler();
     bool StepRK32();
     bool StepConstantVelocity();
+    bool StepRK45();
     vistle::Vector3 Interpolator(BlockData* bl, vistle::Index el, const vistle::Vector3 &point);
     void hInit();
-    bool hNew(vistle::Vector3 cur, vistle::Vector3 higher, vistle::Vector3 lower, vistle::Vector vel, vistle::Scalar unit);
+    bool hNew(vistle::Vector3 cur, vistle::Vector3 higher, vistle::Vector3 lower, vistle::Vector vel, vistle::Scalar unit, int order=3);
     void enableCelltree(bool value);
     vistle::Scalar h() const;
 
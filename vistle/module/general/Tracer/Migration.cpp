@@ -0,0 +1,208 @@
+#include "Migration.h"
+#include "Tracer.h"
+#include "BlockData.h"
+
+#include <algorithm>
+#include <limits>
+#include <cassert>
+
+#include <boost/mpi/collectives/all_gather.hpp>
+#include <boost/mpi/collectives/all_to_all.hpp>
+#include <boost/serialization/vector.hpp>
+
+using namespace vistle;
+namespace mpi = boost::mpi;
+
+namespace {
+
+enum Tag {
+    TagMigrate = 1,
+    TagFinished,
+    TagDone,
+};
+
+}
+
+Migration::Migration(mpi::communicator comm, GlobalData &global, ParticleList &particles)
+: m_comm(comm)
+, m_global(global)
+, m_particles(particles)
+, m_outgoing(comm.size())
+{
+}
+
+Migration::~Migration() {
+
+    mpi::wait_all(m_requests.begin(), m_requests.end());
+}
+
+void Migration::buildIndex() {
+
+    const auto &blocks = m_global.blocks;
+
+    std::vector<std::vector<Scalar>> local(blocks.size());
+    for (size_t t=0; t<blocks.size(); ++t) {
+        for (auto &block: blocks[t]) {
+            auto b = block->bounds();
+            // account for tolerances of cell search
+            const Scalar eps = (b.second-b.first).norm()*Scalar(1e-4);
+            for (int c=0; c<3; ++c)
+                local[t].push_back(b.first[c]-eps);
+            for (int c=0; c<3; ++c)
+                local[t].push_back(b.second[c]+eps);
+        }
+    }
+
+    std::vector<std::vector<std::vector<Scalar>>> all;
+    mpi::all_gather(m_comm, local, all);
+
+    m_bounds.clear();
+    m_bounds.resize(blocks.size());
+    for (size_t t=0; t<blocks.size(); ++t) {
+        m_bounds[t].resize(m_comm.size());
+        for (int r=0; r<m_comm.size(); ++r) {
+            const auto &coords = all[r][t];
+            for (size_t i=0; i+5<coords.size(); i+=6) {
+                Box box;
+                box.min = Vector3(coords[i], coords[i+1], coords[i+2]);
+                box.max = Vector3(coords[i+3], coords[i+4], coords[i+5]);
+                m_bounds[t][r].push_back(box);
+            }
+        }
+    }
+}
+
+std::vector<int> Migration::candidates(const Particle &particle, int exclude) const {
+
+    std::vector<int> result;
+    const Index t = particle.timestep();
+    if (t >= m_bounds.size())
+        return result;
+
+    const auto &pos = particle.position();
+    const auto &bounds = m_bounds[t];
+    for (int r=bounds.size()-1; r>=0; --r) {
+        if (r == exclude)
+            continue;
+        for (const auto &box: bounds[r]) {
+            if ((pos.array() >= box.min.array()).all() && (pos.array() <= box.max.array()).all()) {
+                result.push_back(r);
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+void Migration::send(Particle &particle, std::vector<int> candidates, bool initial) {
+
+    assert(!candidates.empty());
+    const int dest = candidates.front();
+    candidates.erase(candidates.begin());
+
+    auto &batch = m_outgoing[dest];
+    batch.ids.push_back(particle.id());
+    batch.initial.push_back(initial);
+    batch.candidates.emplace_back(std::move(candidates));
+    batch.states.push_back(particle.state());
+}
+
+void Migration::flush() {
+
+    for (int r=0; r<m_comm.size(); ++r) {
+        auto &batch = m_outgoing[r];
+        if (batch.ids.empty())
+            continue;
+        // serialized immediately, so batch can be reused
+        m_requests.emplace_back(m_comm.isend(r, TagMigrate, batch));
+        batch = Batch();
+    }
+    purgeRequests();
+}
+
+std::vector<Migration::Arrival> Migration::receive() {
+
+    std::vector<Arrival> arrivals;
+    while (auto status = m_comm.iprobe(mpi::any_source, TagMigrate)) {
+        Batch batch;
+        m_comm.recv(status->source(), TagMigrate, batch);
+        for (size_t i=0; i<batch.ids.size(); ++i) {
+            auto &p = m_particles[batch.ids[i]];
+            assert(p->id() == batch.ids[i]);
+            p->setState(batch.states[i]);
+
+            Arrival a;
+            a.particle = p.get();
+            a.candidates = std::move(batch.candidates[i]);
+            a.initial = batch.initial[i];
+            arrivals.emplace_back(std::move(a));
+        }
+    }
+    return arrivals;
+}
+
+void Migration::finished(Index num) {
+
+    m_numFinished += num;
+}
+
+bool Migration::done() {
+
+    if (m_done)
+        return true;
+
+    if (m_comm.rank() == 0) {
+        m_totalFinished += m_numFinished;
+        m_numFinished = 0;
+        while (auto status = m_comm.iprobe(mpi::any_source, TagFinished)) {
+            Index num = 0;
+            m_comm.recv(status->source(), TagFinished, num);
+            m_totalFinished += num;
+        }
+        assert(m_totalFinished <= m_particles.size());
+        if (m_totalFinished == m_particles.size()) {
+            for (int r=1; r<m_comm.size(); ++r)
+                m_requests.emplace_back(m_comm.isend(r, TagDone));
+            m_done = true;
+        }
+    } else {
+        if (m_numFinished > 0) {
+            m_reports.push_back(m_numFinished);
+            m_requests.emplace_back(m_comm.isend(0, TagFinished, m_reports.back()));
+            m_numFinished = 0;
+        }
+        if (m_comm.iprobe(0, TagDone)) {
+            m_comm.recv(0, TagDone);
+            m_done = true;
+        }
+    }
+
+    if (m_done) {
+        mpi::wait_all(m_requests.begin(), m_requests.end());
+        m_requests.clear();
+        m_reports.clear();
+    }
+    return m_done;
+}
+
+void Migration::collectResults(std::vector<std::vector<Particle::Result>> &results) {
+
+    assert(results.size() == size_t(m_comm.size()));
+
+    std::vector<std::vector<Particle::Result>> received;
+    mpi::all_to_all(m_comm, results, received);
+    results.clear();
+
+    for (auto &list: received) {
+        for (auto &result: list) {
+            m_particles[result.id]->mergeResult(result);
+        }
+    }
+}
+
+void Migration::purgeRequests() {
+
+    m_requests.erase(std::remove_if(m_requests.begin(), m_requests.end(), [](mpi::request &req) {
+        return bool(req.test());
+    }), m_requests.end());
+}
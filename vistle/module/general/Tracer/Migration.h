@@ -0,0 +1,93 @@
+#ifndef TRACER_MIGRATION_H
+#define TRACER_MIGRATION_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+
+#include <boost/mpi/communicator.hpp>
+#include <boost/mpi/request.hpp>
+
+#include <vistle/core/index.h>
+#include <vistle/core/vector.h>
+
+#include "Particle.h"
+
+class GlobalData;
+
+//! moves particles between ranks with point-to-point messages
+/*!
+ * A global index of block bounds determines the ranks which might be able to continue tracing a particle.
+ * These are tried one after the other in order of decreasing rank, so that no collective operations are required.
+ * Particles sent to the same rank are batched into one message per call to flush().
+ * Termination is detected by counting finished particles on rank 0, which notifies all other ranks.
+ */
+class Migration {
+
+public:
+    typedef std::vector<std::shared_ptr<Particle>> ParticleList;
+
+    struct Arrival {
+        Particle *particle = nullptr;
+        std::vector<int> candidates; //!< ranks to try if particle cannot be traced on this rank
+        bool initial = false; //!< particle has not been traced yet
+    };
+
+    Migration(boost::mpi::communicator comm, GlobalData &global, ParticleList &particles);
+    ~Migration();
+
+    //! exchange bounds of local blocks of all timesteps with all other ranks (collective)
+    void buildIndex();
+    //! ranks other than exclude whose blocks might contain the particle, in order of decreasing rank
+    std::vector<int> candidates(const Particle &particle, int exclude) const;
+
+    //! queue particle for sending to the first of candidates
+    void send(Particle &particle, std::vector<int> candidates, bool initial=false);
+    //! start sending all queued particles, one message per destination rank
+    void flush();
+    //! particles received since last call, their state has already been updated
+    std::vector<Arrival> receive();
+
+    //! account for particles which have stopped on this rank
+    void finished(vistle::Index num=1);
+    //! whether all particles have stopped on all ranks
+    bool done();
+
+    //! send results[r] to rank r and merge results received into local particles (collective)
+    void collectResults(std::vector<std::vector<Particle::Result>> &results);
+
+private:
+    struct Batch {
+        std::vector<vistle::Index> ids;
+        std::vector<char> initial;
+        std::vector<std::vector<int>> candidates;
+        std::vector<Particle::State> states;
+
+        template<class Archive>
+        void serialize(Archive &ar, const unsigned int version) {
+            ar & ids;
+            ar & initial;
+            ar & candidates;
+            ar & states;
+        }
+    };
+
+    struct Box {
+        vistle::Vector3 min, max;
+    };
+
+    void purgeRequests();
+
+    boost::mpi::communicator m_comm;
+    GlobalData &m_global;
+    ParticleList &m_particles;
+
+    std::vector<std::vector<std::vector<Box>>> m_bounds; //!< [timestep][rank]: bounds of blocks
+    std::vector<Batch> m_outgoing; //!< [rank]: particles to be sent
+    std::vector<boost::mpi::request> m_requests;
+    std::deque<vistle::Index> m_reports; //!< counts sent to rank 0, have to remain valid until sent
+    vistle::Index m_numFinished = 0; //!< no. of particles stopped on this rank and not reported yet
+    vistle::Index m_totalFinished = 0; //!< no. of particles stopped on all ranks, only valid on rank 0
+    bool m_done = false;
+};
+#endif
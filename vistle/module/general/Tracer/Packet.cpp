@@ -0,0 +1,287 @@
+#include "Packet.h"
+#include "Particle.h"
+#include "Integrator.h"
+#include "BlockData.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace vistle;
+
+namespace {
+
+template<class T>
+void compactArray(std::vector<T> &a, const std::vector<char> &keep) {
+
+    size_t k = 0;
+    for (size_t i=0; i<a.size(); ++i) {
+        if (keep[i])
+            a[k++] = a[i];
+    }
+    a.resize(k);
+}
+
+}
+
+void Packet::Lanes::resize(size_t n) {
+
+    particle.resize(n);
+    block.resize(n);
+    for (int c=0; c<3; ++c) {
+        x[c].resize(n);
+        k0[c].resize(n);
+        k1[c].resize(n);
+        k2[c].resize(n);
+        y[c].resize(n);
+        x2nd[c].resize(n);
+        x3rd[c].resize(n);
+    }
+    h.resize(n);
+    sign.resize(n);
+    cellSize.resize(n);
+    el.resize(n);
+    el1.resize(n);
+}
+
+void Packet::Lanes::compact(const std::vector<char> &keep) {
+
+    compactArray(particle, keep);
+    compactArray(block, keep);
+    for (int c=0; c<3; ++c) {
+        compactArray(x[c], keep);
+        compactArray(k0[c], keep);
+        compactArray(k1[c], keep);
+        compactArray(k2[c], keep);
+        compactArray(y[c], keep);
+        compactArray(x2nd[c], keep);
+        compactArray(x3rd[c], keep);
+    }
+    compactArray(h, keep);
+    compactArray(sign, keep);
+    compactArray(cellSize, keep);
+    compactArray(el, keep);
+    compactArray(el1, keep);
+}
+
+Packet::Packet(const std::vector<Particle *> &particles)
+: m_particles(particles)
+{
+}
+
+void Packet::trace() {
+
+    for (auto p: m_particles) {
+        assert(p->m_tracing);
+        p->m_progress = false;
+    }
+
+    std::vector<Particle *> active(m_particles);
+    for (;;) {
+        active.erase(std::remove_if(active.begin(), active.end(), [](Particle *p){ return !p->isMoving(); }), active.end());
+        locate(active);
+        if (active.empty())
+            break;
+
+        for (auto p: active) {
+            p->prepareStep();
+            p->m_progress = true;
+        }
+        if (active.front()->m_global.int_mode == RK32) {
+            stepRK32(active);
+        } else {
+            for (auto p: active)
+                p->m_integrator.Step();
+        }
+        for (auto p: active)
+            ++p->m_stp;
+    }
+
+    for (auto p: m_particles)
+        p->UpdateBlock(nullptr);
+}
+
+void Packet::locate(std::vector<Particle *> &active) {
+
+    std::stable_sort(active.begin(), active.end(), [](const Particle *a, const Particle *b){ return a->m_block < b->m_block; });
+
+    const size_t n = active.size();
+    std::vector<char> found(n, false);
+    std::vector<Vector3> points;
+    std::vector<Index> hints, cells;
+    std::vector<size_t> search;
+    for (size_t begin=0, end=0; begin<n; begin=end) {
+        BlockData *block = active[begin]->m_block;
+        for (end=begin+1; end<n && active[end]->m_block==block; ++end)
+            ;
+        if (!block || active[begin]->m_global.int_mode == ConstantVelocity)
+            continue;
+
+        // cells of particles located by their integrator do not have to be searched for
+        search.clear();
+        for (size_t j=begin; j<end; ++j) {
+            if (active[j]->m_located)
+                found[j] = true;
+            else
+                search.push_back(j);
+        }
+        if (search.empty())
+            continue;
+
+        const size_t num = search.size();
+        points.resize(num);
+        hints.resize(num);
+        cells.resize(num);
+        for (size_t j=0; j<num; ++j) {
+            points[j] = active[search[j]]->m_x;
+            hints[j] = active[search[j]]->m_el;
+        }
+        const int flags = active[begin]->m_useCelltree ? GridInterface::NoFlags : GridInterface::NoCelltree;
+        block->getGrid()->findCells(points.data(), num, cells.data(), hints.data(), flags);
+        for (size_t j=0; j<num; ++j) {
+            if (cells[j] != InvalidIndex) {
+                active[search[j]]->m_el = cells[j];
+                found[search[j]] = true;
+            }
+        }
+    }
+
+    // particles which left their block are searched for in all blocks
+    for (size_t j=0; j<n; ++j) {
+        if (!found[j])
+            found[j] = active[j]->findCell(active[j]->m_time);
+    }
+    compactArray(active, found);
+}
+
+void Packet::findCells(Lanes &lanes, const std::vector<Index> &hints, std::vector<Index> &cells) {
+
+    const size_t n = lanes.size();
+    cells.resize(n);
+    std::vector<Vector3> points;
+    for (size_t begin=0, end=0; begin<n; begin=end) {
+        BlockData *block = lanes.block[begin];
+        for (end=begin+1; end<n && lanes.block[end]==block; ++end)
+            ;
+
+        const size_t num = end-begin;
+        points.resize(num);
+        for (size_t j=0; j<num; ++j) {
+            points[j] = Vector3(lanes.y[0][begin+j], lanes.y[1][begin+j], lanes.y[2][begin+j]);
+        }
+        const int flags = lanes.particle[begin]->m_integrator.m_cellSearchFlags;
+        block->getGrid()->findCells(points.data(), num, &cells[begin], &hints[begin], flags);
+    }
+}
+
+// 3rd-order Runge-Kutta with embedded Heun, as in Integrator::StepRK32
+void Packet::stepRK32(const std::vector<Particle *> &active) {
+
+    Lanes lanes;
+    lanes.resize(active.size());
+    for (size_t j=0; j<active.size(); ++j) {
+        auto p = active[j];
+        lanes.particle[j] = p;
+        lanes.block[j] = p->m_block;
+        lanes.sign[j] = p->m_forward ? 1. : -1.;
+        lanes.h[j] = p->m_integrator.m_h;
+        lanes.el[j] = p->m_el;
+        lanes.cellSize[j] = p->m_block->getGrid()->cellDiameter(p->m_el);
+        for (int c=0; c<3; ++c) {
+            lanes.x[c][j] = p->m_x[c];
+            lanes.k0[c][j] = lanes.sign[j]*p->m_v[c];
+        }
+    }
+
+    const Scalar half(0.5), third(1./3.);
+    std::vector<Index> el2;
+    std::vector<char> keep;
+    while (lanes.size() > 0) {
+        size_t n = lanes.size();
+
+        for (int c=0; c<3; ++c) {
+            const Scalar *x = lanes.x[c].data(), *k0 = lanes.k0[c].data(), *h = lanes.h.data();
+            Scalar *y = lanes.y[c].data();
+            for (size_t j=0; j<n; ++j)
+                y[j] = x[j] + half*h[j]*k0[j];
+        }
+        findCells(lanes, lanes.el, lanes.el1);
+
+        keep.assign(n, true);
+        for (size_t j=0; j<n; ++j) {
+            auto p = lanes.particle[j];
+            auto &integ = p->m_integrator;
+            const Vector3 y(lanes.y[0][j], lanes.y[1][j], lanes.y[2][j]);
+            if (lanes.el1[j] == InvalidIndex) {
+                p->m_x = y;
+                integ.m_hact = half*lanes.h[j];
+                keep[j] = false;
+                continue;
+            }
+            if (lanes.el1[j] != lanes.el[j]) {
+                lanes.cellSize[j] = std::min(lanes.block[j]->getGrid()->cellDiameter(lanes.el1[j]), lanes.cellSize[j]);
+            }
+            const Vector3 k1 = integ.m_velTransform*lanes.sign[j]*integ.Interpolator(lanes.block[j], lanes.el1[j], y);
+            for (int c=0; c<3; ++c)
+                lanes.k1[c][j] = k1[c];
+        }
+        lanes.compact(keep);
+        n = lanes.size();
+
+        for (int c=0; c<3; ++c) {
+            const Scalar *x = lanes.x[c].data(), *k0 = lanes.k0[c].data(), *k1 = lanes.k1[c].data(), *h = lanes.h.data();
+            Scalar *y = lanes.y[c].data(), *x2nd = lanes.x2nd[c].data();
+            for (size_t j=0; j<n; ++j) {
+                x2nd[j] = x[j] + h[j]*(k0[j]*half + k1[j]*half);
+                y[j] = x[j] + h[j]*(-k0[j] + 2*k1[j]);
+            }
+        }
+        findCells(lanes, lanes.el1, el2);
+
+        keep.assign(n, true);
+        for (size_t j=0; j<n; ++j) {
+            auto p = lanes.particle[j];
+            auto &integ = p->m_integrator;
+            if (el2[j] == InvalidIndex) {
+                p->m_x = Vector3(lanes.x2nd[0][j], lanes.x2nd[1][j], lanes.x2nd[2][j]);
+                integ.m_hact = lanes.h[j];
+                keep[j] = false;
+                continue;
+            }
+            if (el2[j] != lanes.el1[j]) {
+                lanes.cellSize[j] = std::min(lanes.block[j]->getGrid()->cellDiameter(el2[j]), lanes.cellSize[j]);
+            }
+            const Vector3 y(lanes.y[0][j], lanes.y[1][j], lanes.y[2][j]);
+            const Vector3 k2 = integ.m_velTransform*lanes.sign[j]*integ.Interpolator(lanes.block[j], el2[j], y);
+            for (int c=0; c<3; ++c)
+                lanes.k2[c][j] = k2[c];
+        }
+        lanes.compact(keep);
+        n = lanes.size();
+
+        for (int c=0; c<3; ++c) {
+            const Scalar *x = lanes.x[c].data(), *k0 = lanes.k0[c].data(), *k1 = lanes.k1[c].data(), *k2 = lanes.k2[c].data(), *h = lanes.h.data();
+            Scalar *x3rd = lanes.x3rd[c].data();
+            for (size_t j=0; j<n; ++j)
+                x3rd[j] = x[j] + h[j]*(half*k0[j]*third + 2*k1[j]*third + half*k2[j]*third);
+        }
+
+        keep.assign(n, true);
+        for (size_t j=0; j<n; ++j) {
+            auto p = lanes.particle[j];
+            auto &integ = p->m_integrator;
+            const Vector3 x(lanes.x[0][j], lanes.x[1][j], lanes.x[2][j]);
+            const Vector3 x2nd(lanes.x2nd[0][j], lanes.x2nd[1][j], lanes.x2nd[2][j]);
+            const Vector3 x3rd(lanes.x3rd[0][j], lanes.x3rd[1][j], lanes.x3rd[2][j]);
+            const Vector3 k0(lanes.k0[0][j], lanes.k0[1][j], lanes.k0[2][j]);
+            integ.m_hact = lanes.h[j];
+            bool accept = integ.hNew(x, x3rd, x2nd, k0, lanes.cellSize[j]);
+            lanes.h[j] = integ.m_h;
+            if (accept) {
+                p->m_x = x3rd;
+                keep[j] = false;
+            }
+        }
+        lanes.compact(keep);
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef TRACER_PACKET_H
+#define TRACER_PACKET_H
+
+#include <vector>
+
+#include <vistle/core/index.h>
+#include <vistle/core/scalar.h>
+
+class Particle;
+class BlockData;
+
+//! advances a bundle of particles in lockstep
+/*!
+ * Cell location is batched for all particles within the same block,
+ * and the stages of RK32 integration operate on structure-of-arrays storage,
+ * so that they can be vectorized by the compiler.
+ */
+class Packet {
+
+public:
+    explicit Packet(const std::vector<Particle *> &particles);
+
+    //! trace all particles until they stop or leave the blocks of this rank
+    void trace();
+
+private:
+    //! lanes of a packet in structure-of-arrays layout, sorted by block
+    struct Lanes {
+        std::vector<Particle *> particle;
+        std::vector<BlockData *> block;
+        std::vector<vistle::Scalar> x[3], k0[3], k1[3], k2[3], y[3], x2nd[3], x3rd[3];
+        std::vector<vistle::Scalar> h, sign, cellSize;
+        std::vector<vistle::Index> el, el1;
+
+        void resize(size_t n);
+        size_t size() const { return particle.size(); }
+        //! remove lanes for which keep is false
+        void compact(const std::vector<char> &keep);
+    };
+
+    //! locate particles in their current block, fall back to searching all blocks
+    void locate(std::vector<Particle *> &active);
+    //! find cells containing y of all lanes, using el as hints
+    void findCells(Lanes &lanes, const std::vector<vistle::Index> &hints, std::vector<vistle::Index> &cells);
+    void stepRK32(const std::vector<Particle *> &active);
+
+    std::vector<Particle *> m_particles;
+};
+#endif
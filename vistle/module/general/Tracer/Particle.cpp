@@ -1,12 +1,12 @@
 ﻿#include <limits>
 #include <algorithm>
-#include <boost/mpi/collectives/broadcast.hpp>
 #include <vistle/core/vec.h>
 #include <vistle/util/math.h>
 #include "Tracer.h"
 #include "Integrator.h"
 #include "Particle.h"
 #include "BlockData.h"
+#include "Packet.h"
 
 using namespace vistle;
 
@@ -30,6 +30,7 @@ m_segment(forward ? 0 : -1),
 m_segmentStart(0),
 m_block(nullptr),
 m_el(InvalidIndex),
+m_located(false),
 m_ingrid(true),
 m_integrator(this, forward),
 m_stopReason(StillActive),
@@ -62,32 +63,47 @@ void Particle::enableCelltree(bool value) {
     m_integrator.enableCelltree(value);
 }
 
-int Particle::searchRank(boost::mpi::communicator mpi_comm) {
+bool Particle::claim(int rank) {
 
     assert(!m_tracing);
     assert(!m_currentSegment);
     m_progress = false;
 
-    int rank = -1;
-
-    if (findCell(m_time)) {
-        m_integrator.hInit();
-        rank = mpi_comm.rank();
-    }
+    if (!findCell(m_time))
+        return false;
 
-    rank = boost::mpi::all_reduce(mpi_comm, rank, boost::mpi::maximum<int>());
+    m_integrator.hInit();
     if (m_rank == -1) {
         m_rank = rank;
     }
 
-    return rank;
+    return true;
 }
 
 void Particle::startTracing() {
 
     assert(inGrid());
     m_tracing = true;
-    m_progressFuture =  std::async(std::launch::async, [this]() -> bool { return trace(); });
+    m_progressFuture = std::async(std::launch::async, [this]() { m_progress = trace(); }).share();
+}
+
+void Particle::startTracing(const std::vector<Particle *> &packet) {
+
+    if (packet.size() == 1) {
+        packet[0]->startTracing();
+        return;
+    }
+
+    for (auto p: packet) {
+        assert(p->inGrid());
+        p->m_tracing = true;
+    }
+    auto future = std::async(std::launch::async, [packet]() {
+        Packet bundle(packet);
+        bundle.trace();
+    }).share();
+    for (auto p: packet)
+        p->m_progressFuture = future;
 }
 
 bool Particle::isActive() const {
@@ -138,6 +154,12 @@ bool Particle::findCell(double time) {
 
     if (m_block) {
 
+        if (m_located) {
+            assert(m_el != InvalidIndex);
+            assert(m_currentSegment);
+            return true;
+        }
+
         auto grid = m_block->getGrid();
         if (m_global.int_mode == ConstantVelocity) {
             const auto neigh = grid->getNeighborElements(m_el);
@@ -192,9 +214,12 @@ bool Particle::findCell(double time) {
 
 void Particle::EmitData() {
 
+   const bool movingPoints = m_global.task_type == MovingPoints;
    m_currentSegment->m_xhist.push_back(transformPoint(m_block->transform(), m_xold));
-   m_currentSegment->m_vhist.push_back(m_v);
-   m_currentSegment->m_times.push_back(m_time);
+   if (m_global.computeVector || movingPoints)
+       m_currentSegment->m_vhist.push_back(m_v);
+   if (m_global.computeTime || movingPoints)
+       m_currentSegment->m_times.push_back(m_time);
    if (m_global.computeStep)
        m_currentSegment->m_steps.push_back(m_stp);
    if (m_global.computeScalar)
@@ -223,14 +248,31 @@ void Particle::Deactivate(StopReason reason) {
 
 bool Particle::Step() {
 
+   prepareStep();
+   bool ret = m_integrator.Step();
+   ++m_stp;
+   return ret;
+}
+
+void Particle::prepareStep() {
+
    const auto &grid = m_block->getGrid();
-   auto inter = grid->getInterpolator(m_el, m_x, m_block->m_vecmap);
-   m_v = inter(m_block->m_vx, m_block->m_vy, m_block->m_vz);
-   m_v = m_block->velocityTransform() * m_v;
-   if (m_block->m_p) {
-      if (m_block->m_scamap != m_block->m_vecmap)
-          inter = grid->getInterpolator(m_el, m_x, m_block->m_scamap);
-      m_p = inter(m_block->m_p);
+   if (m_located) {
+      // velocity is known from the last stage of the previous step
+      m_located = false;
+      if (m_block->m_p) {
+         auto inter = grid->getInterpolator(m_el, m_x, m_block->m_scamap);
+         m_p = inter(m_block->m_p);
+      }
+   } else {
+      auto inter = grid->getInterpolator(m_el, m_x, m_block->m_vecmap);
+      m_v = inter(m_block->m_vx, m_block->m_vy, m_block->m_vz);
+      m_v = m_block->velocityTransform() * m_v;
+      if (m_block->m_p) {
+         if (m_block->m_scamap != m_block->m_vecmap)
+             inter = grid->getInterpolator(m_el, m_x, m_block->m_scamap);
+         m_p = inter(m_block->m_p);
+      }
    }
    Scalar ddist = (m_x-m_xold).norm();
    m_xold = m_x;
@@ -244,10 +286,6 @@ bool Particle::Step() {
        m_time -= m_integrator.h();
        m_dist -= ddist;
    }
-
-   bool ret = m_integrator.Step();
-   ++m_stp;
-   return ret;
 }
 
 bool Particle::isTracing(bool wait) {
@@ -272,7 +310,8 @@ bool Particle::isTracing(bool wait) {
 #endif
 
     m_tracing = false;
-    m_progress = m_progressFuture.get();
+    m_progressFuture.get();
+    m_progressFuture = std::shared_future<void>();
     return false;
 }
 
@@ -429,80 +468,57 @@ void Particle::addToOutput() {
            }
        }
    } else {
-       Index numPoints = 0;
-       for (auto &ent: m_segments) {
-           const auto &seg = *ent.second;
-           numPoints += seg.m_xhist.size();
-       }
-
+       // output arrays have been reserved for all particles by Tracer
        int t = m_timestep;
        t = 0;
 
        std::lock_guard<std::mutex> locker(m_global.mutex);
        auto lines = m_global.lines[t];
-       Index sz = lines->getNumVertices();
-       Index nsz = sz+numPoints;
        auto &x = lines->x(), &y = lines->y(), &z = lines->z();
        auto &cl = lines->cl();
-       assert(sz == cl.size());
-       x.reserve(nsz);
-       y.reserve(nsz);
-       z.reserve(nsz);
-       cl.reserve(nsz);
+       assert(lines->getNumVertices() == cl.size());
 
        shm<Scalar>::array *vec_x=nullptr, *vec_y=nullptr, *vec_z=nullptr;
        if (m_global.computeVector) {
            vec_x = &m_global.vecField[t]->x();
            vec_y = &m_global.vecField[t]->y();
            vec_z = &m_global.vecField[t]->z();
-           vec_x->reserve(nsz);
-           vec_y->reserve(nsz);
-           vec_z->reserve(nsz);
        }
        shm<Scalar>::array *scal=nullptr;
        if (m_global.computeScalar) {
            scal = &m_global.scalField[t]->x();
-           scal->reserve(nsz);
        }
        shm<Scalar>::array *stepwidth=nullptr;
        if (m_global.computeStepWidth) {
            stepwidth = &m_global.stepWidthField[t]->x();
-           stepwidth->reserve(nsz);
        }
        shm<Index>::array *id=nullptr;
        if (m_global.computeId) {
            id = &m_global.idField[t]->x();
-           id->reserve(nsz);
        }
        shm<Index>::array *step=nullptr;
        if (m_global.computeStep) {
            step = &m_global.stepField[t]->x();
-           step->reserve(nsz);
        }
        shm<Scalar>::array *time=nullptr;
        if (m_global.computeTime) {
            time = &m_global.timeField[t]->x();
-           time->reserve(nsz);
        }
        shm<Scalar>::array *dist=nullptr;
        if (m_global.computeDist) {
-           auto &dist = m_global.distField[t]->x();
-           dist.reserve(nsz);
+           dist = &m_global.distField[t]->x();
        }
        shm<Index>::array *stopReason=nullptr;
        if (m_global.computeStopReason) {
            stopReason = &m_global.stopReasonField[t]->x();
-           stopReason->reserve(nsz);
        }
        shm<Index>::array *cellIndex=nullptr;
        if (m_global.computeCellIndex) {
            cellIndex = &m_global.cellField[t]->x();
-           cellIndex->reserve(nsz);
        }
        shm<Index>::array *blockIndex=nullptr;
        if (m_global.computeBlockIndex) {
            blockIndex = &m_global.blockField[t]->x();
-           blockIndex->reserve(nsz);
        }
 
        auto addStep = [this, &x, &y, &z, &cl, vec_x, vec_y, vec_z, scal, id, step, stepwidth, time, dist, stopReason, cellIndex, blockIndex](const Segment &seg, Index i){
@@ -512,13 +528,12 @@ void Particle::addToOutput() {
            z.push_back(vec[2]);
            cl.push_back(cl.size());
 
-           const auto &vel = seg.m_vhist[i];
-           if (vec_x)
+           if (vec_x) {
+               const auto &vel = seg.m_vhist[i];
                vec_x->push_back(vel[0]);
-           if (vec_y)
                vec_y->push_back(vel[1]);
-           if (vec_z)
                vec_z->push_back(vel[2]);
+           }
            if (scal)
                scal->push_back(seg.m_pressures[i]);
            if (stepwidth)
@@ -539,6 +554,7 @@ void Particle::addToOutput() {
                blockIndex->push_back(seg.m_blockIndex);
        };
 
+       // release segments as soon as they have been copied to limit peak memory usage
        for (auto &ent: m_segments) {
            const auto &seg = *ent.second;
            auto N = seg.m_xhist.size();
@@ -554,6 +570,7 @@ void Particle::addToOutput() {
                    addStep(seg, i);
                }
            }
+           ent.second.reset();
        }
        lines->el().push_back(cl.size());
    }
@@ -563,6 +580,15 @@ void Particle::addToOutput() {
    m_segments.clear();
 }
 
+Index Particle::numPoints() const {
+
+    Index numPoints = 0;
+    for (auto &ent: m_segments) {
+        numPoints += ent.second->m_xhist.size();
+    }
+    return numPoints;
+}
+
 Scalar Particle::time() const {
 
     return m_time;
@@ -571,57 +597,81 @@ Scalar Particle::time() const {
 
 
 
-void Particle::broadcast(boost::mpi::communicator mpi_comm, int root) {
+Index Particle::timestep() const {
 
-    boost::mpi::broadcast(mpi_comm, *this, root);
-    m_integrator.m_hact = m_integrator.m_h;
-    m_progress = false;
+    return m_timestep;
 }
 
-namespace boost {
-namespace serialization {
+const Vector3 &Particle::position() const {
 
-template<class Archive>
-void save(Archive & ar, const Particle::SegmentMap &segments, const unsigned int version) {
-    int numsegs = segments.size();
-    ar & numsegs;
-    for (auto &seg: segments)
-        ar & *seg.second;
+    assert(!m_block);
+    return m_x;
 }
 
-template<class Archive>
-void load(Archive & ar, Particle::SegmentMap &segments, const unsigned int version) {
-    int numsegs = 0;
-    ar & numsegs;
-    for (int i=0; i<numsegs; ++i) {
-        Particle::Segment seg;
-        ar & seg;
-        segments.emplace(seg.m_num, std::make_shared<Particle::Segment>(std::move(seg)));
-    }
-}
+Particle::State Particle::state() const {
 
-} // namespace serialization
-} // namespace boost
+    assert(!m_tracing);
+    assert(!m_block);
+
+    State state;
+    state.rank = m_rank;
+    state.x = m_x;
+    state.xold = m_xold;
+    state.v = m_v;
+    state.stp = m_stp;
+    state.time = m_time;
+    state.dist = m_dist;
+    state.p = m_p;
+    state.h = m_integrator.m_h;
+    state.ingrid = m_ingrid;
+    state.stopReason = m_stopReason;
+    state.segment = m_segment;
+    return state;
+}
 
-BOOST_SERIALIZATION_SPLIT_FREE(Particle::SegmentMap)
+void Particle::setState(const State &state) {
 
-void Particle::startSendData(boost::mpi::communicator mpi_comm) {
+    assert(!m_tracing);
+    assert(!m_currentSegment);
 
-    assert(rank() != mpi_comm.rank());
-    m_requests.emplace_back(mpi_comm.isend(rank(), id(), m_segments));
+    UpdateBlock(nullptr);
+    m_rank = state.rank;
+    m_x = state.x;
+    m_xold = state.xold;
+    m_v = state.v;
+    m_stp = state.stp;
+    m_time = state.time;
+    m_dist = state.dist;
+    m_p = state.p;
+    m_integrator.m_h = state.h;
+    m_integrator.m_hact = state.h;
+    m_ingrid = state.ingrid;
+    m_stopReason = state.stopReason;
+    m_segment = state.segment;
+    m_progress = false;
 }
 
-void Particle::finishSendData() {
-    mpi::wait_all(m_requests.begin(), m_requests.end());
-    m_requests.clear();
-    m_segments.clear();
+Particle::Result Particle::takeResult(bool final) {
+
+    assert(!m_currentSegment);
+
+    Result result;
+    result.id = id();
+    result.final = final;
+    result.stopReason = m_stopReason;
+    result.time = m_time;
+    std::swap(result.segments, m_segments);
+    return result;
 }
 
-void Particle::receiveData(boost::mpi::communicator mpi_comm, int rank) {
+void Particle::mergeResult(Result &result) {
 
-    SegmentMap segments;
-    mpi_comm.recv(rank, id(), segments);
-    for (auto &segpair: segments) {
+    assert(result.id == id());
+    if (result.final) {
+        m_stopReason = result.stopReason;
+        m_time = result.time;
+    }
+    for (auto &segpair: result.segments) {
         auto &seg = segpair.second;
         m_segments[seg->m_num] = seg;
         if (seg->m_id != id()) {
@@ -633,6 +683,8 @@ void Particle::receiveData(boost::mpi::communicator mpi_comm, int rank) {
 
 void Particle::UpdateBlock(BlockData *block) {
 
+    m_located = false;
+
     if (m_block) {
         m_x = transformPoint(m_block->transform(), m_x);
         m_xold = transformPoint(m_block->transform(), m_xold);
@@ -2,11 +2,13 @@
 #define TRACER_PARTICLE_H
 
 #include <vector>
+#include <algorithm>
+#include <map>
+#include <memory>
 #include <future>
 
-#include <boost/mpi/communicator.hpp>
-
 #include <boost/serialization/split_free.hpp>
+#include <boost/serialization/vector.hpp>
 
 #include <vistle/core/index.h>
 #include <vistle/core/lines.h>
@@ -19,10 +21,56 @@
 class BlockData;
 class GlobalData;
 
+//! append-only storage in chunks of fixed size, so that growing never copies previously stored elements
+/*! the first chunk grows geometrically up to ChunkSize, so that short sequences do not occupy a whole chunk */
+template<typename T>
+class Chunked {
+
+public:
+    static const size_t ChunkSize = 1024;
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    void push_back(const T &value) {
+        if (m_size % ChunkSize == 0) {
+            m_chunks.emplace_back();
+            if (m_chunks.size() > 1)
+                m_chunks.back().reserve(ChunkSize);
+        }
+        auto &chunk = m_chunks.back();
+        if (chunk.size() == chunk.capacity()) {
+            size_t capacity = std::max(2*chunk.capacity(), size_t(4));
+            chunk.reserve(capacity < ChunkSize ? capacity : ChunkSize);
+        }
+        chunk.push_back(value);
+        ++m_size;
+    }
+
+    const T &operator[](size_t i) const {
+        return m_chunks[i/ChunkSize][i%ChunkSize];
+    }
+
+    void clear() {
+        m_chunks.clear();
+        m_size = 0;
+    }
+
+    template<class Archive>
+    void serialize(Archive &ar, const unsigned int version) {
+        ar & m_chunks;
+        ar & m_size;
+    }
+
+private:
+    std::vector<std::vector<T>> m_chunks;
+    size_t m_size = 0;
+};
+
 class Particle {
 
     friend class Integrator;
-    friend class boost::serialization::access;
+    friend class Packet;
 
 public:
     DEFINE_ENUM_WITH_STRING_CONVERSIONS(StopReason,
@@ -46,22 +94,52 @@ public:
     void Deactivate(StopReason reason);
     void EmitData();
     bool Step();
-    void broadcast(boost::mpi::communicator mpi_comm, int root);
-    void startSendData(boost::mpi::communicator mpi_comm);
-    void finishSendData();
-    void receiveData(boost::mpi::communicator mpi_comm, int rank);
+    void prepareStep(); //!< interpolate at current position and record it, before integrating
     void UpdateBlock(BlockData *block);
     StopReason stopReason() const;
     void enableCelltree(bool value);
-    int searchRank(boost::mpi::communicator mpi_comm); //< returns MPI rank of node where tracing occurs
+    bool claim(int rank); //!< returns whether tracing can continue on rank, which becomes owner if there is none yet
     void startTracing();
+    static void startTracing(const std::vector<Particle *> &packet); //!< trace particles in lockstep
     bool isTracing(bool wait);
     bool madeProgress() const;
     bool trace();
     void finishSegment();
     void fetchSegments(Particle &other); //! move segments from other particle to this one
+    vistle::Index numPoints() const; //!< no. of points in segments to be output
     void addToOutput();
     vistle::Scalar time() const;
+    vistle::Index timestep() const;
+    const vistle::Vector3 &position() const; //!< in world coordinates while not tracing
+
+    //! state required for continuing to trace on another rank
+    struct State {
+        int rank = -1;
+        vistle::Vector3 x, xold, v;
+        vistle::Index stp = 0;
+        vistle::Scalar time = 0, dist = 0, p = 0, h = 0;
+        bool ingrid = true;
+        StopReason stopReason = StillActive;
+        int segment = 0;
+
+        template<class Archive>
+        void serialize(Archive &ar, const unsigned int version) {
+            ar & rank;
+            ar & x;
+            ar & xold;
+            ar & v;
+            ar & stp;
+            ar & time;
+            ar & dist;
+            ar & p;
+            ar & h;
+            ar & ingrid;
+            ar & stopReason;
+            ar & segment;
+        }
+    };
+    State state() const;
+    void setState(const State &state);
 
     struct Segment {
         vistle::Index m_id = vistle::InvalidIndex; //! id of particle that was traced
@@ -69,14 +147,15 @@ public:
         int m_num; // >= 0: forward, < 0: backward
         vistle::Index m_blockIndex; //!< index of current block
         vistle::Index m_startStep;
-        std::vector<vistle::Vector3> m_xhist; //!< trajectory
-        std::vector<vistle::Vector3> m_vhist; //!< previous velocities
-        std::vector<vistle::Scalar> m_stepWidth; //!< previous integration stepwidths
-        std::vector<vistle::Scalar> m_pressures; //!< previous pressures
-        std::vector<vistle::Index> m_steps; //!< previous steps
-        std::vector<vistle::Scalar> m_times; //!< previous times
-        std::vector<vistle::Scalar> m_dists; //!< previous times
-        std::vector<vistle::Index> m_cellIndex; //!< previous cell/element indices
+        // only channels required for output are filled
+        Chunked<vistle::Vector3> m_xhist; //!< trajectory
+        Chunked<vistle::Vector3> m_vhist; //!< previous velocities
+        Chunked<vistle::Scalar> m_stepWidth; //!< previous integration stepwidths
+        Chunked<vistle::Scalar> m_pressures; //!< previous pressures
+        Chunked<vistle::Index> m_steps; //!< previous steps
+        Chunked<vistle::Scalar> m_times; //!< previous times
+        Chunked<vistle::Scalar> m_dists; //!< previous distances
+        Chunked<vistle::Index> m_cellIndex; //!< previous cell/element indices
 
         Segment(int num=0)
             : m_rank(-1)
@@ -118,6 +197,27 @@ public:
     };
 
     typedef std::map<int, std::shared_ptr<Segment>> SegmentMap;
+
+    //! segments traced on a rank, sent to the rank assembling the output
+    struct Result {
+        vistle::Index id = vistle::InvalidIndex;
+        bool final = false; //!< particle stopped on the sending rank
+        StopReason stopReason = StillActive;
+        vistle::Scalar time = 0;
+        SegmentMap segments;
+
+        template<class Archive>
+        void serialize(Archive &ar, const unsigned int version) {
+            ar & id;
+            ar & final;
+            ar & stopReason;
+            ar & time;
+            ar & segments;
+        }
+    };
+    Result takeResult(bool final); //!< moves finished segments into result
+    void mergeResult(Result &result);
+
 private:
     bool findCell(double time);
 
@@ -126,8 +226,8 @@ private:
     vistle::Index m_startId; //!< id of start point;
     int m_rank; //! MPI rank where resulting geometry is assembled
     vistle::Index m_timestep; //! timestep of particle for streamlines
-    std::future<bool> m_progressFuture; //!< future on whether particle has made progress during trace()
-    bool m_progress;
+    std::shared_future<void> m_progressFuture; //!< future on trace(), shared by all particles of a packet
+    bool m_progress; //!< whether particle has made progress during trace()
     bool m_tracing; //!< particle is currently tracing on this node
     bool m_forward; //!< trace direction
     vistle::Vector3 m_x; //!< current position
@@ -145,27 +245,38 @@ private:
 
     BlockData *m_block; //!< current block for current particle position
     vistle::Index m_el; //!< index of cell for current particle position
+    bool m_located; //!< m_el and m_v have already been determined for m_x by the integrator
     bool m_ingrid; //!< particle still within domain on some rank
     Integrator m_integrator;
     StopReason m_stopReason; //! reason why particle was deactivated
     bool m_useCelltree; //! whether to use celltree for acceleration
 
-    // just for Boost.MPI
-    template<class Archive>
-    void serialize(Archive &ar, const unsigned int version) {
-        ar & m_x;
-        ar & m_xold;
-        ar & m_v;
-        ar & m_stp;
-        ar & m_time;
-        ar & m_dist;
-        ar & m_p;
-        ar & m_ingrid;
-        ar & m_integrator.m_h;
-        ar & m_stopReason;
-        ar & m_segment;
+};
+
+namespace boost {
+namespace serialization {
+
+template<class Archive>
+void save(Archive & ar, const Particle::SegmentMap &segments, const unsigned int version) {
+    int numsegs = segments.size();
+    ar & numsegs;
+    for (auto &seg: segments)
+        ar & *seg.second;
+}
+
+template<class Archive>
+void load(Archive & ar, Particle::SegmentMap &segments, const unsigned int version) {
+    int numsegs = 0;
+    ar & numsegs;
+    for (int i=0; i<numsegs; ++i) {
+        Particle::Segment seg;
+        ar & seg;
+        segments.emplace(seg.m_num, std::make_shared<Particle::Segment>(std::move(seg)));
     }
+}
 
-    std::vector<boost::mpi::request> m_requests;
-};
+} // namespace serialization
+} // namespace boost
+
+BOOST_SERIALIZATION_SPLIT_FREE(Particle::SegmentMap)
 #endif
@@ -1,13 +1,17 @@
 ﻿#include "Tracer.h"
 #include "BlockData.h"
 #include "Particle.h"
+#include "Migration.h"
 #include <sstream>
 #include <iostream>
 #include <algorithm>
 #include <cmath>
+#include <thread>
+#include <functional>
 #include <boost/mpi/collectives/all_reduce.hpp>
 #include <boost/mpi/collectives/all_gather.hpp>
 #include <boost/mpi/collectives/broadcast.hpp>
+#include <boost/mpi/collectives/reduce.hpp>
 #include <boost/mpi/operations.hpp>
 #include <vistle/core/vec.h>
 #include <vistle/core/paramvector.h>
@@ -124,21 +128,23 @@ Tracer::Tracer(const std::string &name, int moduleID, mpi::communicator comm)
     setCurrentParameterGroup("Step Length Control");
     addFloatParameter("h_init", "fixed step size for euler integration", 1e-03);
     setParameterRange("h_init", 0.0, 1e6);
-    addFloatParameter("h_min","minimum step size for rk32 integration", 1e-04);
+    addFloatParameter("h_min","minimum step size for rk32 and rk45 integration", 1e-04);
     setParameterRange("h_min", 0.0, 1e6);
-    addFloatParameter("h_max", "maximum step size for rk32 integration", .5);
+    addFloatParameter("h_max", "maximum step size for rk32 and rk45 integration", .5);
     setParameterRange("h_max", 0.0, 1e6);
-    addFloatParameter("err_tol_abs", "absolute error tolerance for rk32 integration", 1e-04);
+    addFloatParameter("err_tol_abs", "absolute error tolerance for rk32 and rk45 integration", 1e-04);
     setParameterRange("err_tol_abs", 0.0, 1e6);
-    addFloatParameter("err_tol_rel", "relative error tolerance for rk32 integration", 1e-03);
+    addFloatParameter("err_tol_rel", "relative error tolerance for rk32 and rk45 integration", 1e-03);
     setParameterRange("err_tol_rel", 0.0, 1.0);
     addIntParameter("cell_relative", "whether step length control should take into account cell size", 1, Parameter::Boolean);
     addIntParameter("velocity_relative", "whether step length control should take into account velocity", 1, Parameter::Boolean);
 
     setCurrentParameterGroup("Performance Tuning");
     m_useCelltree = addIntParameter("use_celltree", "use celltree for accelerated cell location", (Integer)1, Parameter::Boolean);
-    auto num_active = addIntParameter("num_active", "number of particles to trace simultaneously on each node (0: no. of cores)", 0);
+    auto num_active = addIntParameter("num_active", "number of particle packets to trace simultaneously on each node (0: no. of cores)", 0);
     setParameterRange(num_active, (Integer)0, (Integer)10000);
+    auto packet_size = addIntParameter("packet_size", "number of particles to advance in lockstep", 16);
+    setParameterRange(packet_size, (Integer)1, (Integer)1024);
 
     m_particlePlacement = addIntParameter("particle_placement", "where a particle's data shall be collected", RankById, Parameter::Choice);
     V_ENUM_SET_CHOICES(m_particlePlacement, ParticlePlacement);
@@ -358,7 +364,8 @@ bool Tracer::reduce(int timestep) {
    if (maxNumActive <= 0) {
        maxNumActive = std::thread::hardware_concurrency();
    }
-   Index maxNumActiveGlobal = mpi::all_reduce(comm(), maxNumActive, mpi::maximum<Index>());
+   const Index packetSize = std::max(Integer(1), getIntParameter("packet_size"));
+   maxNumActive *= packetSize;
    auto taskType = (TraceType)getIntParameter("taskType");
    TraceDirection traceDirection = (TraceDirection)getIntParameter("tdirection");
    if (taskType != Streamlines) {
@@ -517,164 +524,113 @@ bool Tracer::reduce(int timestep) {
        }
    }
 
-   Index nextParticleToStart = 0;
-   auto startParticles = [this, &nextParticleToStart, &allParticles, &activeParticles, &localParticles, maxNumActive](int toStart) -> int {
-       int started = 0;
-       while (nextParticleToStart < allParticles.size()) {
-           if (started >= toStart)
-               break;
-
-           Index idx = nextParticleToStart;
-           ++nextParticleToStart;
-           auto particle = allParticles[idx];
-           int r = particle->searchRank(comm());
-           if (r >= 0) {
-               ++started;
-               if (rank() == r) {
-                   if (activeParticles.size() < maxNumActive) {
-                       activeParticles.emplace(particle);
-                       particle->startTracing();
-                   } else {
-                       localParticles.emplace(particle);
-                   }
-               }
-           } else {
-               particle->Deactivate(Particle::InitiallyOutOfDomain);
-           }
+   Migration migration(comm(), global, allParticles);
+   migration.buildIndex();
+
+   const int mpisize = comm().size();
+   std::vector<char> stoppedHere(allParticles.size(), false);
+   // account for a particle that has been deactivated on this rank
+   auto stop = [&stopReasonCount, &stoppedHere, &migration](Particle &p) {
+       ++stopReasonCount[p.stopReason()];
+       stoppedHere[p.id()] = true;
+       migration.finished();
+   };
+   // continue tracing on this rank or pass particle on to the next rank that might contain it
+   auto place = [this, &migration, &localParticles, &stop](std::shared_ptr<Particle> p, std::vector<int> &candidates, bool initial) {
+       if (p->claim(rank())) {
+           localParticles.emplace(p);
+       } else if (!candidates.empty()) {
+           migration.send(*p, std::move(candidates), initial);
+       } else {
+           p->Deactivate(initial ? Particle::InitiallyOutOfDomain : Particle::OutOfDomain);
+           stop(*p);
        }
-       return started;
    };
 
-   std::vector<Index> datasendlist;
-   std::vector<std::pair<Index, int>> datarecvlist; // particle id, source mpi rank
-   const int mpisize = comm().size();
-   Index numActiveMax = 0, numActiveMin = std::numeric_limits<Index>::max();
-   do {
-      std::vector<Index> sendlist;
-      Index numStart = maxNumActiveGlobal>numActiveMin ? maxNumActiveGlobal-numActiveMin : 0;
-      startParticles(numStart);
+   // the first rank that might contain a start point tries to claim the particle
+   for (auto &p: allParticles) {
+       auto candidates = migration.candidates(*p, -1);
+       if (candidates.empty()) {
+           p->Deactivate(Particle::InitiallyOutOfDomain);
+           // all ranks come to the same conclusion
+           if (rank() == 0)
+               stop(*p);
+           continue;
+       }
+       if (candidates.front() != rank())
+           continue;
+       candidates.erase(candidates.begin());
+       place(p, candidates, true);
+   }
+   migration.flush();
+
+   while (!migration.done()) {
+      auto arrivals = migration.receive();
+      for (auto &a: arrivals) {
+          place(allParticles[a.particle->id()], a.candidates, a.initial);
+      }
 
       bool first = true;
-      int numDeactivated = 0;
-      // build list of particles to send to their owner
       for (auto it = activeParticles.begin(), next=it; it != activeParticles.end(); it=next) {
 
           next = it;
           ++next;
 
-          auto particle = it->get();
+          auto particle = *it;
 
           bool wait = mpisize==1 && first;
           first = false;
           if (!particle->isTracing(wait)) {
-              if (mpisize==1) {
-                  particle->Deactivate(Particle::OutOfDomain);
-              } else if (particle->madeProgress()) {
-                  sendlist.push_back(particle->id());
+              particle->finishSegment();
+              if (!particle->inGrid()) {
+                  stop(*particle);
+              } else {
+                  // particle has left all blocks on this rank
+                  auto candidates = migration.candidates(*particle, rank());
+                  if (candidates.empty()) {
+                      particle->Deactivate(Particle::OutOfDomain);
+                      stop(*particle);
+                  } else {
+                      migration.send(*particle, std::move(candidates));
+                  }
               }
               activeParticles.erase(it);
-              ++numDeactivated;
           }
       }
 
-      while (numDeactivated>0 && !localParticles.empty()) {
-          --numDeactivated;
-          auto p = *localParticles.begin();
-          activeParticles.emplace(p);
-          p->startTracing();
-          localParticles.erase(localParticles.begin());
-      }
-
-      if (mpisize==1) {
-          numActiveMax = numActiveMin = activeParticles.size()+localParticles.size();
-          continue;
-      }
-
-      // communicate
-      Index num_send = sendlist.size();
-      std::vector<Index> num_transmit(mpisize);
-      mpi::all_gather(comm(), num_send, num_transmit);
-      for(int mpirank=0; mpirank<mpisize; mpirank++) {
-          Index num_recv = num_transmit[mpirank];
-          if(num_recv>0) {
-              std::vector<Index> recvlist;
-              auto &curlist = rank()==mpirank ? sendlist : recvlist;
-              mpi::broadcast(comm(), curlist, mpirank);
-              assert(curlist.size() == num_recv);
-              for(Index i=0; i<num_recv; i++){
-                  Index p_index = curlist[i];
-                  auto p = allParticles[p_index];
-                  assert(!p->isTracing(false));
-                  p->broadcast(comm(), mpirank);
-                  if (p->rank() == rank() && rank() != mpirank) {
-                      datarecvlist.emplace_back(p->id(), mpirank);
-                  }
-                  p->finishSegment();
-                  int r = p->searchRank(comm());
-                  if (r < 0) {
-                      p->Deactivate(Particle::OutOfDomain);
-                  } else if (r == rank()) {
-                      if (activeParticles.size() < maxNumActive) {
-                          activeParticles.emplace(p);
-                          p->startTracing();
-                      } else {
-                          localParticles.emplace(p);
-                      }
-                  }
-              }
+      while (activeParticles.size() < maxNumActive && !localParticles.empty()) {
+          std::vector<Particle *> packet;
+          while (packet.size() < packetSize && !localParticles.empty()) {
+              auto p = *localParticles.begin();
+              activeParticles.emplace(p);
+              packet.push_back(p.get());
+              localParticles.erase(localParticles.begin());
           }
+          Particle::startTracing(packet);
       }
 
-      std::copy(sendlist.begin(), sendlist.end(), std::back_inserter(datasendlist));
-
-      numActiveMin = mpi::all_reduce(comm(), activeParticles.size()+localParticles.size(), mpi::minimum<Index>());
-      numActiveMax = mpi::all_reduce(comm(), activeParticles.size()+localParticles.size(), mpi::maximum<Index>());
-      //std::cerr << "recvlist: " << datarecvlist.size() << ", sendlist: " << sendlist.size() << ", #active="<<activeParticles.size() << std::endl;
-   } while (numActiveMax > 0 || nextParticleToStart<allParticles.size());
+      migration.flush();
+      if (activeParticles.empty() && arrivals.empty())
+          std::this_thread::yield();
+   }
 
-   if (mpisize == 1) {
-       for (auto p: allParticles) {
-           p->finishSegment();
-       }
-   } else {
-      // iterate over all other ranks
-      for(int i=1; i<mpisize; ++i) {
-          // start sending particles to owning rank
-          int dst = (rank()+i)%size();
-          for (auto id: datasendlist) {
-              auto p = allParticles[id];
-              if (p->rank() == dst) {
-                  //std::cerr << "initiate sending " << p->id() << " to " << dst << std::endl;
-                  p->startSendData(comm());
-              }
-          }
-      }
-      for(int i=1; i<mpisize; ++i) {
-          // receive locally owned particles
-          int src = (rank()-i+size())%size();
-          for (const auto &part: datarecvlist) {
-              auto id = part.first;
-              auto rank = part.second;
-              auto p = allParticles[id];
-              assert(p->rank() == this->rank());
-              if (rank == src) {
-                  //std::cerr << "receiving " << p->id() << " from " << src << std::endl;
-                  p->receiveData(comm(), src);
-              }
-          }
-      }
-      for(int i=1; i<mpisize; ++i) {
-          // finish sending particles to owning rank
-          int dst = (rank()+i)%size();
-          for (auto id: datasendlist) {
-              auto p = allParticles[id];
-              if (p->rank() == dst) {
-                  //std::cerr << "finish sending " << p->id() << " to " << dst << std::endl;
-                  p->finishSendData();
-              }
-          }
-      }
+   // send segments to the rank assembling the output
+   std::vector<std::vector<Particle::Result>> results(mpisize);
+   for (auto &p: allParticles) {
+       const int owner = p->rank();
+       if (owner < 0 || owner == rank())
+           continue;
+       auto result = p->takeResult(stoppedHere[p->id()]);
+       if (result.final || !result.segments.empty())
+           results[owner].emplace_back(std::move(result));
    }
+   if (mpisize > 1) {
+       migration.collectResults(results);
+   }
+
+   std::vector<Index> totalStopReasonCount(stopReasonCount.size());
+   mpi::reduce(comm(), stopReasonCount.data(), stopReasonCount.size(), totalStopReasonCount.data(), std::plus<Index>(), 0);
+   stopReasonCount = totalStopReasonCount;
 
    Scalar maxTime = 0;
    for (auto &p: allParticles) {
@@ -798,14 +754,48 @@ bool Tracer::reduce(int timestep) {
        }
    }
 
+   Index numPoints = 0;
    for (auto &p: allParticles) {
-       if (rank() == 0)
-           ++stopReasonCount[p->stopReason()];
        if (p->rank() == rank()) {
            if (traceDirection == Both && p->isForward()) {
                auto other = allParticles[p->id()+1];
                p->fetchSegments(*other);
            }
+           numPoints += p->numPoints();
+       }
+   }
+   if (taskType != MovingPoints) {
+       // all particles are added to the first lines object
+       global.lines[0]->x().reserve(numPoints);
+       global.lines[0]->y().reserve(numPoints);
+       global.lines[0]->z().reserve(numPoints);
+       global.lines[0]->cl().reserve(numPoints);
+       if (global.computeVector) {
+           global.vecField[0]->x().reserve(numPoints);
+           global.vecField[0]->y().reserve(numPoints);
+           global.vecField[0]->z().reserve(numPoints);
+       }
+       if (global.computeScalar)
+           global.scalField[0]->x().reserve(numPoints);
+       if (global.computeId)
+           global.idField[0]->x().reserve(numPoints);
+       if (global.computeStep)
+           global.stepField[0]->x().reserve(numPoints);
+       if (global.computeTime)
+           global.timeField[0]->x().reserve(numPoints);
+       if (global.computeStepWidth)
+           global.stepWidthField[0]->x().reserve(numPoints);
+       if (global.computeDist)
+           global.distField[0]->x().reserve(numPoints);
+       if (global.computeStopReason)
+           global.stopReasonField[0]->x().reserve(numPoints);
+       if (global.computeCellIndex)
+           global.cellField[0]->x().reserve(numPoints);
+       if (global.computeBlockIndex)
+           global.blockField[0]->x().reserve(numPoints);
+   }
+   for (auto &p: allParticles) {
+       if (p->rank() == rank()) {
            p->addToOutput();
        }
    }
@@ -28,6 +28,8 @@ class GlobalData {
     friend class Particle;
     friend class Tracer;
     friend class Integrator;
+    friend class Migration;
+    friend class Packet;
 
 public:
 
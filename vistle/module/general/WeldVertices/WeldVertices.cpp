@@ -6,6 +6,16 @@
 #include <vistle/core/grid.h>
 #include <vistle/core/database.h>
 #include <vistle/core/unstr.h>
+#include <vistle/util/enum.h>
+#include <vistle/util/ssize_t.h>
+
+#include <map>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+DEFINE_ENUM_WITH_STRING_CONVERSIONS(Algorithm, (Map)(Hash))
 
 class WeldVertices: public vistle::Module {
   static const int NumPorts = 3;
@@ -17,6 +27,8 @@ class WeldVertices: public vistle::Module {
  private:
    bool compute(std::shared_ptr<vistle::PortTask> task) const override;
    vistle::Port *m_in[NumPorts], *m_out[NumPorts];
+   vistle::IntParameter *m_algorithm = nullptr;
+   vistle::FloatParameter *m_tolerance = nullptr;
 };
 
 using namespace vistle;
@@ -28,12 +40,19 @@ WeldVertices::WeldVertices(const std::string &name, int moduleID, mpi::communica
         m_in[i] = createInputPort("data_in"+std::to_string(i));
         m_out[i] = createOutputPort("data_out"+std::to_string(i));
     }
+
+    m_algorithm = addIntParameter("algorithm", "search for duplicates with ordered map (exact match only) or spatial hash", Hash, Parameter::Choice);
+    V_ENUM_SET_CHOICES(m_algorithm, Algorithm);
+    m_tolerance = addFloatParameter("tolerance", "maximum difference per coordinate and per data component for merging vertices (Hash only)", 0.);
+    setParameterMinimum<Float>(m_tolerance, 0.);
 }
 
 WeldVertices::~WeldVertices()
 {
 }
 
+namespace {
+
 struct Point {
     Point(Scalar x, Scalar y, Scalar z, Index v, const std::vector<const Scalar *> &floats)
         : floats(floats), x(x), y(y), z(z), v(v)
@@ -69,6 +88,320 @@ struct Point {
     }
 };
 
+//! find duplicate vertices by sorting them into an ordered map - exact matches only
+void weldMap(Index num, const Index *cl, const Scalar *x, const Scalar *y, const Scalar *z, const std::vector<const Scalar *> &floats,
+             Index *ncl, std::vector<Index> &remap) {
+
+    std::map<Point, Index> indexMap;
+    Index count = 0;
+    for (Index i=0; i<num; ++i) {
+        Index v = cl ? cl[i] : i;
+        Point p(x[v], y[v], z[v], v, floats);
+        auto &idx = indexMap[p];
+        if (idx == 0) {
+            remap.push_back(v);
+            idx = ++count;
+        }
+        ncl[i] = idx-1;
+    }
+}
+
+typedef uint64_t CellKey;
+
+const unsigned CellBits = 21;
+const int64_t MaxCell = (int64_t(1) << CellBits) - 1;
+const unsigned PartitionBits = 8;
+const unsigned NumPartitions = 1 << PartitionBits;
+const CellKey EmptyKey = ~CellKey(0);
+
+//! find duplicate vertices with a uniform grid stored in a flat open-addressing hash table
+/*!
+ * Vertices are sorted into grid cells with an edge length of at least the tolerance, so that all
+ * candidates for merging reside in the same or in one of the 26 neighboring cells.
+ * Each vertex is mapped to the vertex with the lowest index within tolerance. As all phases are
+ * partitioned into a fixed number of chunks and hash partitions, the result does not depend on
+ * the number of threads.
+ */
+class SpatialHashWelder {
+ public:
+    SpatialHashWelder(Index numCoords, const Scalar *x, const Scalar *y, const Scalar *z,
+                      const std::vector<const Scalar *> &floats, Scalar tolerance)
+        : m_num(numCoords), m_x(x), m_y(y), m_z(z), m_floats(floats), m_tolerance(tolerance)
+    {}
+
+    //! map each vertex to the vertex with the lowest index it is merged with
+    std::vector<Index> representatives();
+
+ private:
+    struct Slot {
+        CellKey key = EmptyKey;
+        Index begin = 0;
+        Index count = 0;
+    };
+
+    static CellKey pack(int64_t ix, int64_t iy, int64_t iz) {
+        return (CellKey(ix) << (2*CellBits)) | (CellKey(iy) << CellBits) | CellKey(iz);
+    }
+
+    static uint64_t mix(uint64_t k) {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdULL;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ULL;
+        k ^= k >> 33;
+        return k;
+    }
+
+    static unsigned partition(CellKey key) {
+        return unsigned(mix(key) >> (64-PartitionBits));
+    }
+
+    int64_t cellCoord(Scalar c, int dim) const {
+        if (!std::isfinite(c))
+            return 0;
+        int64_t i = int64_t(std::floor((c - m_min[dim]) * m_invCellSize));
+        return std::max(int64_t(0), std::min(MaxCell, i));
+    }
+
+    const Slot *lookup(CellKey key) const {
+        unsigned p = partition(key);
+        Index cap = m_tableOffset[p+1] - m_tableOffset[p];
+        if (cap == 0)
+            return nullptr;
+        const Slot *table = &m_slots[m_tableOffset[p]];
+        for (Index s = mix(key) & (cap-1); ; s = (s+1) & (cap-1)) {
+            if (table[s].key == key)
+                return &table[s];
+            if (table[s].key == EmptyKey)
+                return nullptr;
+        }
+    }
+
+    bool similar(Index u, Index v) const {
+        if (m_tolerance == 0) {
+            if (m_x[u] != m_x[v] || m_y[u] != m_y[v] || m_z[u] != m_z[v])
+                return false;
+            for (auto f: m_floats) {
+                if (f[u] != f[v])
+                    return false;
+            }
+            return true;
+        }
+
+        if (std::abs(m_x[u]-m_x[v]) > m_tolerance || std::abs(m_y[u]-m_y[v]) > m_tolerance || std::abs(m_z[u]-m_z[v]) > m_tolerance)
+            return false;
+        for (auto f: m_floats) {
+            if (std::abs(f[u]-f[v]) > m_tolerance)
+                return false;
+        }
+        return true;
+    }
+
+    Index m_num = 0;
+    const Scalar *m_x = nullptr, *m_y = nullptr, *m_z = nullptr;
+    const std::vector<const Scalar *> &m_floats;
+    Scalar m_tolerance = 0;
+
+    Scalar m_min[3] = {0, 0, 0};
+    Scalar m_invCellSize = 1;
+    std::vector<Index> m_tableOffset;
+    std::vector<Slot> m_slots;
+    std::vector<Index> m_cellVerts;
+};
+
+std::vector<Index> SpatialHashWelder::representatives() {
+
+    const Index n = m_num;
+    std::vector<Index> rep(n);
+    if (n == 0)
+        return rep;
+
+    // fixed chunking keeps results independent of thread count
+    const Index numChunks = std::max(Index(1), std::min(Index(64), n/16384));
+    const Index chunkSize = (n+numChunks-1)/numChunks;
+    auto chunkBegin = [chunkSize, n](Index c) -> Index { return std::min(n, c*chunkSize); };
+
+    // bounds of all vertices
+    std::vector<Scalar> cmin(3*numChunks, std::numeric_limits<Scalar>::max());
+    std::vector<Scalar> cmax(3*numChunks, std::numeric_limits<Scalar>::lowest());
+    const Scalar *coords[3] = {m_x, m_y, m_z};
+#pragma omp parallel for schedule(static)
+    for (ssize_t c=0; c<ssize_t(numChunks); ++c) {
+        for (Index v=chunkBegin(c); v<chunkBegin(c+1); ++v) {
+            for (int d=0; d<3; ++d) {
+                const Scalar val = coords[d][v];
+                if (!std::isfinite(val))
+                    continue;
+                cmin[3*c+d] = std::min(cmin[3*c+d], val);
+                cmax[3*c+d] = std::max(cmax[3*c+d], val);
+            }
+        }
+    }
+    Scalar extent = 0;
+    for (int d=0; d<3; ++d) {
+        Scalar mi = std::numeric_limits<Scalar>::max(), ma = std::numeric_limits<Scalar>::lowest();
+        for (Index c=0; c<numChunks; ++c) {
+            mi = std::min(mi, cmin[3*c+d]);
+            ma = std::max(ma, cmax[3*c+d]);
+        }
+        if (mi > ma)
+            mi = ma = 0;
+        m_min[d] = mi;
+        extent = std::max(extent, ma-mi);
+    }
+
+    // cell size has to be at least the tolerance, but cell coordinates have to fit into the key
+    Scalar cellSize = std::max(m_tolerance, extent/Scalar(MaxCell-1));
+    if (cellSize <= 0)
+        cellSize = 1;
+    m_invCellSize = Scalar(1)/cellSize;
+
+    std::vector<CellKey> keys(n);
+#pragma omp parallel for schedule(static)
+    for (ssize_t v=0; v<ssize_t(n); ++v) {
+        keys[v] = pack(cellCoord(m_x[v], 0), cellCoord(m_y[v], 1), cellCoord(m_z[v], 2));
+    }
+
+    // counting sort of vertices into hash partitions, stable with respect to vertex index
+    std::vector<Index> offsets(numChunks*NumPartitions);
+#pragma omp parallel for schedule(static)
+    for (ssize_t c=0; c<ssize_t(numChunks); ++c) {
+        Index *count = &offsets[c*NumPartitions];
+        for (Index v=chunkBegin(c); v<chunkBegin(c+1); ++v) {
+            ++count[partition(keys[v])];
+        }
+    }
+    std::vector<Index> partBegin(NumPartitions+1);
+    Index sum = 0;
+    for (unsigned p=0; p<NumPartitions; ++p) {
+        partBegin[p] = sum;
+        for (Index c=0; c<numChunks; ++c) {
+            Index count = offsets[c*NumPartitions+p];
+            offsets[c*NumPartitions+p] = sum;
+            sum += count;
+        }
+    }
+    partBegin[NumPartitions] = sum;
+
+    std::vector<Index> order(n);
+#pragma omp parallel for schedule(static)
+    for (ssize_t c=0; c<ssize_t(numChunks); ++c) {
+        Index *offset = &offsets[c*NumPartitions];
+        for (Index v=chunkBegin(c); v<chunkBegin(c+1); ++v) {
+            order[offset[partition(keys[v])]++] = v;
+        }
+    }
+    offsets.clear();
+    offsets.shrink_to_fit();
+
+    // one open-addressing table per partition, load factor at most 1/2
+    m_tableOffset.resize(NumPartitions+1);
+    Index numSlots = 0;
+    for (unsigned p=0; p<NumPartitions; ++p) {
+        m_tableOffset[p] = numSlots;
+        Index m = partBegin[p+1]-partBegin[p];
+        Index cap = 0;
+        if (m > 0) {
+            cap = 2;
+            while (cap < 2*m)
+                cap *= 2;
+        }
+        numSlots += cap;
+    }
+    m_tableOffset[NumPartitions] = numSlots;
+    m_slots.resize(numSlots);
+    m_cellVerts.resize(n);
+
+#pragma omp parallel for schedule(dynamic)
+    for (ssize_t p=0; p<ssize_t(NumPartitions); ++p) {
+        Index cap = m_tableOffset[p+1] - m_tableOffset[p];
+        if (cap == 0)
+            continue;
+        Slot *table = &m_slots[m_tableOffset[p]];
+        auto findSlot = [table, cap](CellKey key) -> Slot * {
+            for (Index s = mix(key) & (cap-1); ; s = (s+1) & (cap-1)) {
+                if (table[s].key == key || table[s].key == EmptyKey)
+                    return &table[s];
+            }
+        };
+
+        for (Index i=partBegin[p]; i<partBegin[p+1]; ++i) {
+            Slot *slot = findSlot(keys[order[i]]);
+            slot->key = keys[order[i]];
+            ++slot->count;
+        }
+        Index begin = partBegin[p];
+        for (Index s=0; s<cap; ++s) {
+            table[s].begin = begin;
+            begin += table[s].count;
+            table[s].count = 0;
+        }
+        for (Index i=partBegin[p]; i<partBegin[p+1]; ++i) {
+            Index v = order[i];
+            Slot *slot = findSlot(keys[v]);
+            m_cellVerts[slot->begin + slot->count++] = v;
+        }
+    }
+    order.clear();
+    order.shrink_to_fit();
+
+    // vertices in each cell are sorted by index, so the first match is the lowest one
+    const int range = m_tolerance > 0 ? 1 : 0;
+#pragma omp parallel for schedule(dynamic, 4096)
+    for (ssize_t v=0; v<ssize_t(n); ++v) {
+        const CellKey key = keys[v];
+        const int64_t ix = int64_t(key >> (2*CellBits));
+        const int64_t iy = int64_t((key >> CellBits) & MaxCell);
+        const int64_t iz = int64_t(key & MaxCell);
+        Index best = Index(v);
+        for (int64_t x=std::max(int64_t(0), ix-range); x<=std::min(MaxCell, ix+range); ++x) {
+            for (int64_t y=std::max(int64_t(0), iy-range); y<=std::min(MaxCell, iy+range); ++y) {
+                for (int64_t z=std::max(int64_t(0), iz-range); z<=std::min(MaxCell, iz+range); ++z) {
+                    const Slot *slot = lookup(pack(x, y, z));
+                    if (!slot)
+                        continue;
+                    for (Index i=slot->begin; i<slot->begin+slot->count; ++i) {
+                        Index u = m_cellVerts[i];
+                        if (u >= best)
+                            break;
+                        if (similar(u, v)) {
+                            best = u;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        rep[v] = best;
+    }
+
+    // rep[v] <= v: resolve chains of merged vertices in a single sweep
+    for (Index v=0; v<n; ++v) {
+        rep[v] = rep[rep[v]];
+    }
+
+    return rep;
+}
+
+//! find duplicate vertices with a spatial hash - tolerance may be 0 for exact matches
+void weldHash(Index num, const Index *cl, Index numCoords, const Scalar *x, const Scalar *y, const Scalar *z,
+              const std::vector<const Scalar *> &floats, Scalar tolerance, Index *ncl, std::vector<Index> &remap) {
+
+    std::vector<Index> rep = SpatialHashWelder(numCoords, x, y, z, floats, tolerance).representatives();
+
+    // number output vertices in order of first use, just like the map based variant
+    std::vector<Index> newIndex(numCoords, InvalidIndex);
+    for (Index i=0; i<num; ++i) {
+        Index r = rep[cl ? cl[i] : i];
+        if (newIndex[r] == InvalidIndex) {
+            newIndex[r] = remap.size();
+            remap.push_back(r);
+        }
+        ncl[i] = newIndex[r];
+    }
+}
+
+}
 
 bool WeldVertices::compute(std::shared_ptr<PortTask> task) const {
 
@@ -92,9 +425,9 @@ bool WeldVertices::compute(std::shared_ptr<PortTask> task) const {
                         if (auto s = Vec<Scalar,1>::as(din[i])) {
                             floats.push_back(s->x());
                         } else if (auto v = Vec<Scalar,3>::as(din[i])) {
-                            floats.push_back(s->x());
-                            floats.push_back(s->y());
-                            floats.push_back(s->z());
+                            floats.push_back(v->x());
+                            floats.push_back(v->y());
+                            floats.push_back(v->z());
                         }
                     }
                 }
@@ -130,137 +463,54 @@ bool WeldVertices::compute(std::shared_ptr<PortTask> task) const {
     }
 
     Object::ptr ogrid;
-    std::vector<Index> remap;
-    std::map<Point, Index> indexMap;
+    Index num = 0;
+    const Index *cl = nullptr;
+    Index *ncl = nullptr;
     if (auto tri = Triangles::as(grid)) {
 
-        Index num = tri->getNumCorners();
-        const Index *cl = num>0 ? tri->cl() : nullptr;
+        num = tri->getNumCorners();
+        cl = num>0 ? tri->cl() : nullptr;
         if (!cl)
             num = tri->getNumCoords();
-        remap.reserve(num);
-        const Scalar *x=tri->x(), *y=tri->y(), *z=tri->z();
 
         Triangles::ptr ntri(new Triangles(num, 0));
-        Index *ncl = ntri->cl().data();
-
-        if (cl) {
-            Index count = 0;
-            Index num = tri->getNumCorners();
-            for (Index i=0; i<num; ++i) {
-                Index v = cl[i];
-                Point p(x[v], y[v], z[v], v, floats);
-                auto &idx = indexMap[p];
-                if (idx == 0) {
-                    remap.push_back(v);
-                    idx = ++count;
-                }
-                ncl[i] = idx-1;
-            }
-            //sendInfo("found %d unique vertices among %d", count-1, num);
-        } else {
-            Index count = 0;
-            Index num = tri->getNumCoords();
-            for (Index v=0; v<num; ++v) {
-                Point p(x[v], y[v], z[v], v, floats);
-                auto &idx = indexMap[p];
-                if (idx == 0) {
-                    remap.push_back(v);
-                    idx = ++count;
-                }
-                ncl[v] = idx-1;
-            }
-            //sendInfo("found %d unique vertices among %d", count-1, num);
-        }
-
+        ncl = ntri->cl().data();
         ogrid = ntri;
     } else if (auto quad = Quads::as(grid)) {
 
-        Index num = quad->getNumCorners();
-        const Index *cl = num>0 ? quad->cl() : nullptr;
+        num = quad->getNumCorners();
+        cl = num>0 ? quad->cl() : nullptr;
         if (!cl)
             num = quad->getNumCoords();
-        remap.reserve(num);
-        const Scalar *x=quad->x(), *y=quad->y(), *z=quad->z();
 
         Quads::ptr nquad(new Quads(num, 0));
-        Index *ncl = nquad->cl().data();
-
-        if (cl) {
-            Index count = 0;
-            Index num = quad->getNumCorners();
-            for (Index i=0; i<num; ++i) {
-                Index v = cl[i];
-                Point p(x[v], y[v], z[v], v, floats);
-                auto &idx = indexMap[p];
-                if (idx == 0) {
-                    remap.push_back(v);
-                    idx = ++count;
-                }
-                ncl[i] = idx-1;
-            }
-            //sendInfo("found %d unique vertices among %d", count-1, num);
-        } else {
-            Index count = 0;
-            Index num = quad->getNumCoords();
-            for (Index v=0; v<num; ++v) {
-                Point p(x[v], y[v], z[v], v, floats);
-                auto &idx = indexMap[p];
-                if (idx == 0) {
-                    remap.push_back(v);
-                    idx = ++count;
-                }
-                ncl[v] = idx-1;
-            }
-            //sendInfo("found %d unique vertices among %d", count-1, num);
-        }
-
+        ncl = nquad->cl().data();
         ogrid = nquad;
     } else if (auto idx = Indexed::as(grid)) {
-        Index num = idx->getNumCorners();
-        const Index *cl = num>0 ? idx->cl() : nullptr;
+
+        num = idx->getNumCorners();
+        cl = num>0 ? idx->cl() : nullptr;
         if (!cl)
             num = idx->getNumCoords();
-        const Scalar *x=idx->x(), *y=idx->y(), *z=idx->z();
-        remap.reserve(num);
 
         Indexed::ptr nidx = idx->clone();
         nidx->resetArrays();
         nidx->resetCorners();
         nidx->cl().resize(num);
+        ncl = nidx->cl().data();
+        ogrid = nidx;
+    }
 
-        Index *ncl = nidx->cl().data();
-
-        if (cl) {
-            Index count = 0;
-            Index num = idx->getNumCorners();
-            for (Index i=0; i<num; ++i) {
-                Index v = cl[i];
-                Point p(x[v], y[v], z[v], v, floats);
-                auto &idx = indexMap[p];
-                if (idx == 0) {
-                    remap.push_back(v);
-                    idx = ++count;
-                }
-                ncl[i] = idx-1;
-            }
-            //sendInfo("found %d unique vertices among %d", count-1, num);
+    std::vector<Index> remap;
+    if (ogrid) {
+        remap.reserve(num);
+        const Scalar *x=coord->x(), *y=coord->y(), *z=coord->z();
+        if (m_algorithm->getValue() == Map) {
+            weldMap(num, cl, x, y, z, floats, ncl, remap);
         } else {
-            Index count = 0;
-            Index num = idx->getNumCoords();
-            for (Index v=0; v<num; ++v) {
-                Point p(x[v], y[v], z[v], v, floats);
-                auto &idx = indexMap[p];
-                if (idx == 0) {
-                    remap.push_back(v);
-                    idx = ++count;
-                }
-                ncl[v] = idx-1;
-            }
-            //sendInfo("found %d unique vertices among %d", count-1, num);
+            weldHash(num, cl, coord->getNumCoords(), x, y, z, floats, Scalar(m_tolerance->getValue()), ncl, remap);
         }
-
-        ogrid = nidx;
+        //sendInfo("found %d unique vertices among %d", (int)remap.size(), (int)num);
     }
 
     if (ogrid) {
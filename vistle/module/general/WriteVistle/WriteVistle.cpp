@@ -1,144 +1,70 @@
-#include <cstdio>
-#include <cstdlib>
-#include <fstream>
-#include <iomanip>
-#include <sstream>
-#include <string>
-
-#include <fcntl.h>
-#include <sys/stat.h>
-#include <sys/types.h>
-
-#include <vistle/core/archives.h>
-#include <vistle/core/object.h>
+#include <vistle/core/message.h>
+#include <vistle/util/enum.h>
 
 #include "WriteVistle.h"
 
-namespace ba = boost::archive;
 using namespace vistle;
 
 MODULE_MAIN(WriteVistle)
 
-WriteVistle::WriteVistle(const std::string &shmname, const std::string &name, int moduleID)
-   : Module("WriteVistle", shmname, name, moduleID)
-   , m_ofs(NULL)
-   , m_binAr(NULL)
-   , m_textAr(NULL)
-   , m_xmlAr(NULL)
+WriteVistle::WriteVistle(const std::string &name, int moduleID, mpi::communicator comm)
+: Module("write objects to memory-mappable Vistle files", name, moduleID, comm)
 {
+   setDefaultCacheMode(ObjectCache::CacheNone);
 
-   createInputPort("grid_in");
-   auto fp = addIntParameter("format", "file format", 0, Parameter::Choice);
-   std::vector<std::string> choices;
-   choices.push_back("binary");
-   choices.push_back("ASCII");
-   choices.push_back("XML");
-   setParameterChoices(fp, choices);
-   addStringParameter("filename", "filename of Vistle archive", "vistle.archive", Parameter::Filename);
+   for (int i=0; i<NumPorts; ++i) {
+      m_inPort[i] = createInputPort("data_in"+std::to_string(i), "input data "+std::to_string(i));
+   }
+
+   p_file = addStringParameter("filename", "base name of Vistle file, .<rank>.vslm is appended", "", Parameter::Filename);
+   setParameterFilters(p_file, "Vistle Files (*.vslm)/All Files (*)");
+   p_compression = addIntParameter("array_compression", "lossless compression of arrays, uncompressed arrays can be mapped when reading", message::CompressionNone, Parameter::Choice);
+   V_ENUM_SET_CHOICES(p_compression, message::CompressionMode);
+   p_compressionSpeed = addIntParameter("compression_speed", "speed parameter of compression algorithm", -1);
+   setParameterRange(p_compressionSpeed, Integer(-1), Integer(100));
 }
 
 WriteVistle::~WriteVistle() {
 
-   close();
 }
 
-void WriteVistle::close() {
-
-   delete m_binAr;
-   m_binAr = NULL;
-   delete m_textAr;
-   m_textAr = NULL;
-   delete m_xmlAr;
-   m_xmlAr = NULL;
+bool WriteVistle::prepare() {
 
-   if (m_ofs) {
-      *m_ofs << std::endl;
-      *m_ofs << "vistle separator" << std::endl;
+   std::string file = p_file->getValue() + "." + std::to_string(rank()) + ".vslm";
+   m_writer = std::make_shared<MappedArchiveWriter>(file);
+   if (!m_writer->isOpen()) {
+      sendError("could not open %s for writing", file.c_str());
+      m_writer.reset();
+      return true;
    }
-   delete m_ofs;
-   m_ofs = NULL;
+   m_writer->setArrayCompression(message::CompressionMode(p_compression->getValue()), p_compressionSpeed->getValue());
+
+   return true;
 }
 
 bool WriteVistle::compute() {
 
-   int count = 0;
-   bool trunc = false;
-   bool end = false;
-   std::string format;
-   Object::const_ptr obj = expect<Object>("grid_in");
-   if (!obj)
-      return false;
-
-   std::ios_base::openmode flags = std::ios::out;
-   if (obj->hasAttribute("_mark_begin")) {
-      close();
-      trunc = true;
-      flags |= std::ios::trunc;
-   } else {
-      flags |= std::ios::app;
-   }
-   if (obj->hasAttribute("_mark_end")) {
-      end = true;
-   }
-   switch(getIntParameter("format")) {
-      default:
-      case 0:
-         flags |= std::ios::binary;
-         format = "binary";
-         break;
-      case 1:
-         format = "text";
-         break;
-      case 2:
-         format = "xml";
-         break;
-   }
-   if (!m_ofs) {
-      m_ofs = new std::ofstream(getStringParameter("filename").c_str(), flags);
-   }
-   if (trunc)
-      *m_ofs << "vistle " << format << " 1 start" << std::endl;
-
-   switch(getIntParameter("format")) {
-      default:
-      case 0:
-      {
-         if (!m_binAr)
-            m_binAr = new ba::binary_oarchive(*m_ofs);
-         obj->save(*m_binAr);
-         break;
-      }
-      case 1:
-      {
-         if (!m_textAr)
-            m_textAr = new ba::text_oarchive(*m_ofs);
-         obj->save(*m_textAr);
-         break;
-      }
-      case 2:
-      {
-         if (!m_xmlAr)
-            m_xmlAr = new ba::xml_oarchive(*m_ofs);
-         obj->save(*m_xmlAr);
-         break;
+   for (int i=0; i<NumPorts; ++i) {
+      Object::const_ptr obj = accept<Object>(m_inPort[i]);
+      if (!obj || !m_writer)
+         continue;
+      if (!m_writer->addObject(obj, i)) {
+         sendError("failed to write %s", obj->getName().c_str());
+         m_writer.reset();
       }
    }
-   ++count;
 
-   close();
+   return true;
+}
 
-   //*m_ofs << std::endl << "vistle separator" << std::endl;
+bool WriteVistle::reduce(int timestep) {
 
-   if (trunc) {
-      std::cerr << "saved";
-   } else {
-      std::cerr << "appended";
-   }
-   if (end) {
-      std::cerr << " final";
-      close();
-   }
-   std::cerr << " [" << count << "] to " << getStringParameter("filename") << " (" << format << ")" << std::endl;
+   if (timestep != -1)
+      return true;
+
+   if (m_writer && !m_writer->close())
+      sendError("failed to finish writing %s", p_file->getValue().c_str());
+   m_writer.reset();
 
    return true;
 }
@@ -2,27 +2,30 @@
 #define WRITEVISTLE_H
 
 #include <string>
+#include <memory>
 
-#include <vistle/core/object.h>
 #include <vistle/module/module.h>
+#include <vistle/core/mappedarchive.h>
 
 class WriteVistle: public vistle::Module {
 
  public:
-   WriteVistle(const std::string &shmname, const std::string &name, int moduleID);
+   static const int NumPorts = 5;
+
+   WriteVistle(const std::string &name, int moduleID, mpi::communicator comm);
    ~WriteVistle();
 
  private:
-   virtual bool compute();
-
-   void close();
-
-   std::ofstream *m_ofs;
-   boost::archive::binary_oarchive *m_binAr;
-   boost::archive::text_oarchive *m_textAr;
-   boost::archive::xml_oarchive *m_xmlAr;
+   bool prepare() override;
+   bool compute() override;
+   bool reduce(int timestep) override;
 
+   vistle::StringParameter *p_file = nullptr;
+   vistle::IntParameter *p_compression = nullptr;
+   vistle::IntParameter *p_compressionSpeed = nullptr;
+   vistle::Port *m_inPort[NumPorts];
 
+   std::shared_ptr<vistle::MappedArchiveWriter> m_writer;
 };
 
 #endif
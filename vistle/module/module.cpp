@@ -35,14 +35,18 @@
 #include <vistle/core/messagepayload.h>
 #include <vistle/core/parameter.h>
 #include <vistle/core/shm.h>
+#include <vistle/core/shmspill.h>
 #include <vistle/core/port.h>
+#include <vistle/core/profiler.h>
 #include <vistle/core/statetracker.h>
 
 #include "objectcache.h"
 
 #include "module.h"
+#include "taskpool.h"
 
 #include <boost/serialization/vector.hpp>
+#include <boost/serialization/string.hpp>
 #include <vistle/core/shm_reference.h>
 #include <vistle/core/archive_saver.h>
 #include <vistle/core/archive_loader.h>
@@ -273,9 +277,11 @@ Module::Module(const std::string &desc,
    auto openmp_threads = addIntParameter("_openmp_threads", "number of OpenMP threads (0: system default)", 0);
    setParameterRange<Integer>(openmp_threads, 0, 4096);
    addIntParameter("_benchmark", "show timing information", m_benchmark ? 1 : 0, Parameter::Boolean);
+   addIntParameter("_trace", "record execution trace in Chrome trace format", m_trace, Parameter::Boolean);
 
    m_concurrency = addIntParameter("_concurrency", "number of tasks to keep in flight per MPI rank (-1: #cores/2)", -1);
    setParameterRange(m_concurrency, Integer(-1), Integer(hardware_concurrency()));
+   m_streaming = addIntParameter("_streaming", "pass on output of each block as soon as it is available and reduce incrementally", false, Parameter::Boolean);
 }
 
 void Module::prepareQuit() {
@@ -706,16 +712,60 @@ void Module::updateOutputMode() {
 #endif
 }
 
-void Module::waitAllTasks() {
+bool Module::waitAllTasks() {
 
+    bool ok = true;
     while (!m_tasks.empty()) {
-        m_tasks.front()->wait();
+        auto task = m_tasks.front();
         m_tasks.pop_front();
+        task->wait();
+        if (streaming())
+            ok &= reduceIncremental(task->m_timestep);
     }
     if (m_lastTask) {
         m_lastTask->wait();
         m_lastTask.reset();
     }
+    return ok;
+}
+
+TaskPool &Module::taskPool() {
+
+    if (!m_taskPool)
+        m_taskPool.reset(new TaskPool(hardware_concurrency()));
+    return *m_taskPool;
+}
+
+void Module::runTask(std::shared_ptr<PortTask> task) const {
+
+    int expected = PortTask::Queued;
+    if (!task->m_state.compare_exchange_strong(expected, PortTask::Running))
+        return;
+
+    Profiler::setOwner(id());
+    ProfileSpan span("task", Profiler::Task, task->m_timestep);
+    try {
+        task->m_result = compute(task);
+    } catch (...) {
+        task->m_result = false;
+        task->m_exception = std::current_exception();
+    }
+    task->m_state = PortTask::Computed;
+    task->finish();
+}
+
+bool Module::publishCompletedTasks() {
+
+    bool ok = true;
+    while (!m_tasks.empty() && m_tasks.front()->finish()) {
+        auto task = m_tasks.front();
+        m_tasks.pop_front();
+        if (task->m_exception)
+            std::rethrow_exception(task->m_exception);
+        if (streaming())
+            ok &= reduceIncremental(task->m_timestep);
+    }
+    return ok;
 }
 
 void Module::updateMeta(vistle::Object::ptr obj) const {
@@ -945,6 +995,13 @@ bool Module::changeParameter(const Parameter *p) {
       } else if (name == "_prioritize_visible") {
 
           m_prioritizeVisible = getIntParameter("_prioritize_visible");
+      } else if (name == "_trace") {
+
+          bool trace = getIntParameter(name);
+          if (trace != m_trace) {
+              m_trace = trace;
+              Profiler::the().enable(m_trace);
+          }
       }
 
    }
@@ -1121,6 +1178,8 @@ void Module::sendParameterMessage(const message::Message &message, const buffer
 
 bool Module::sendMessage(const message::Message &message, const buffer *payload) const {
 
+   ProfileSpan span("send", Profiler::Message, message.type());
+
    // exclude SendText messages to avoid circular calls
    if (message.type() != message::SENDTEXT
          && (m_traceMessages == message::ANY || m_traceMessages == message.type())) {
@@ -1163,6 +1222,10 @@ bool Module::handleMessage(const vistle::message::Message *message, const Messag
       CERR << "RECV: " << *message << std::endl;
    }
 
+   Profiler::setOwner(id());
+   // execution is covered by detailed spans, and its trace is written before handling of the message completes
+   ProfileSpan span(message->type() == EXECUTE ? nullptr : toString(message->type()), Profiler::Message, message->senderId());
+
    switch (message->type()) {
 
       case vistle::message::PING: {
@@ -1822,8 +1885,9 @@ bool Module::handleExecute(const vistle::message::Execute *exec) {
 #ifdef REDUCE_DEBUG
             CERR << "runReduce(t=" << timestep << "): exec count = " << m_executionCount << std::endl;
 #endif
-            waitAllTasks();
-            return reduce(timestep);
+            bool ok = waitAllTasks();
+            ProfileSpan span("reduce", Profiler::Execute, timestep);
+            return reduce(timestep) && ok;
         };
         bool computeOk = false;
         for (Index i=0; i<numObject; ++i) {
@@ -1867,7 +1931,14 @@ bool Module::handleExecute(const vistle::message::Execute *exec) {
                     }
                     computeOk = true;
                 } else {
+                    ProfileSpan span("compute", Profiler::Execute, timestep);
+                    // spill retained objects before building new ones, not from within allocations
+                    ShmSpill::the().relieveIfNeeded();
                     computeOk = compute();
+                    if (computeOk && streaming() && !m_lastTask) {
+                        // tasks report their blocks once their output has been published
+                        computeOk = reduceIncremental(timestep);
+                    }
                 }
 
                 if (reordered && timestep>=0 && m_numTimesteps>0 && reducePerTimestep) {
@@ -1966,7 +2037,7 @@ bool Module::handleExecute(const vistle::message::Execute *exec) {
 
     if (exec->what() == Execute::ComputeExecute
             || exec->what() == Execute::Reduce) {
-        waitAllTasks();
+        ret &= waitAllTasks();
         ret &= reduceWrapper(exec, reordered);
         m_cache.clearOld();
     }
@@ -1987,6 +2058,9 @@ std::string Module::getModuleName(int id) const {
 
 Module::~Module() {
 
+   if (m_trace)
+      Profiler::the().enable(false);
+
 #ifndef MODULE_THREAD
     Shm::the().detach();
 #endif
@@ -2197,6 +2271,7 @@ bool Module::prepareWrapper(const message::Execute *exec) {
    if (reducePolicy() == message::ReducePolicy::Never)
       return true;
 
+   ProfileSpan span("prepare", Profiler::Execute);
    return prepare();
 }
 
@@ -2223,14 +2298,25 @@ bool Module::compute() {
     if (concurrency <= 1)
         concurrency = 1;
 
-    while (m_tasks.size() >= concurrency) {
-        m_tasks.front()->wait();
-        m_tasks.pop_front();
-    }
+    // bound no. of tasks in flight without waiting for a particular one,
+    // and limit output buffered while waiting for the oldest task
+    bool ok = true;
+    auto &pool = taskPool();
+    pool.helpUntil([this, concurrency, &ok]() -> bool {
+        ok &= publishCompletedTasks();
+        if (m_tasks.size() >= 4*size_t(concurrency))
+            return false;
+        int running = 0;
+        for (const auto &t: m_tasks) {
+            if (t->m_state < PortTask::Computed)
+                ++running;
+        }
+        return running < concurrency;
+    });
     m_tasks.push_back(task);
 
-    task->m_future = std::async(std::launch::async, [this, task]{ return compute(task); });
-    return true;
+    pool.submit([this, task](){ runTask(task); });
+    return ok;
 }
 
 bool Module::compute(std::shared_ptr<PortTask> task) const {
@@ -2266,6 +2352,7 @@ bool Module::reduceWrapper(const message::Execute *exec, bool reordered) {
 
    bool ret = true;
    try {
+       ProfileSpan span("reduce", Profiler::Execute, -1);
        switch(reducePolicy()) {
        case message::ReducePolicy::Never: {
            break;
@@ -2326,6 +2413,9 @@ bool Module::reduceWrapper(const message::Execute *exec, bool reordered) {
       }
    }
 
+   if (m_trace)
+      writeTrace();
+
    message::ExecutionProgress fin(message::ExecutionProgress::Finish, m_executionCount);
    fin.setReferrer(exec->uuid());
    fin.setDestId(Id::LocalManager);
@@ -2344,6 +2434,26 @@ bool Module::reduceWrapper(const message::Execute *exec, bool reordered) {
    return ret;
 }
 
+void Module::writeTrace() {
+
+   std::stringstream process;
+   process << name() << "_" << id() << " rank " << rank();
+   // unique within a session as long as module ids stay below 32768
+   const int pid = id()*65536 + rank();
+   std::string fragment = Profiler::toJson(Profiler::the().collect(id()), pid, process.str());
+
+   std::vector<std::string> fragments;
+   boost::mpi::gather(comm(), fragment, fragments, 0);
+   if (rank() == 0) {
+      std::stringstream filename;
+      filename << Profiler::traceDirectory() << "/vistle-trace-" << name() << "_" << id() << "-" << m_executionCount << ".json";
+      if (Profiler::writeTrace(filename.str(), fragments))
+         sendInfo("execution trace written to %s", filename.str().c_str());
+      else
+         sendWarning("failed to write execution trace to %s", filename.str().c_str());
+   }
+}
+
 bool Module::reduce(int timestep) {
 
 #ifndef NDEBUG
@@ -2353,6 +2463,12 @@ bool Module::reduce(int timestep) {
    return true;
 }
 
+bool Module::reduceIncremental(int timestep) {
+
+   (void)timestep;
+   return true;
+}
+
 bool Module::cancelExecute() {
 
     std::cerr << "canceling execution" << std::endl;
@@ -2367,6 +2483,11 @@ int Module::numTimesteps() const {
     return m_numTimesteps;
 }
 
+bool Module::streaming() const {
+
+    return m_streaming && m_streaming->getValue();
+}
+
 void Module::setStatus(const std::string &text, message::UpdateStatus::Importance prio) {
 
     message::UpdateStatus status(text, prio);
@@ -2435,7 +2556,11 @@ PortTask::PortTask(Module *module)
     for (auto &p: module->inputPorts) {
         m_portsByString[p.first] = &p.second;
         if (module->hasObject(&p.second)) {
-            m_input[&p.second] = module->takeFirstObject(&p.second);
+            auto obj = module->takeFirstObject(&p.second);
+            int t = getTimestep(obj);
+            if (t != -1)
+                m_timestep = t;
+            m_input[&p.second] = obj;
         }
     }
     for (auto &p: module->outputPorts) {
@@ -2446,8 +2571,10 @@ PortTask::PortTask(Module *module)
 
 PortTask::~PortTask()
 {
-    waitDependencies();
-    addAllObjects();
+    if (m_state != Done) {
+        waitDependencies();
+        addAllObjects();
+    }
 }
 
 bool PortTask::hasObject(const Port *p) {
@@ -2554,10 +2681,7 @@ void PortTask::addAllObjects() {
 
 bool PortTask::isDone() {
 
-    if (!m_future.valid())
-        return false;
-
-    return dependenciesDone();
+    return m_state == Done;
 }
 
 bool PortTask::dependenciesDone() {
@@ -2573,27 +2697,57 @@ bool PortTask::dependenciesDone() {
 
 bool PortTask::wait() {
 
+    m_module->taskPool().helpUntil([this]() -> bool { return m_state >= Computed; });
     waitDependencies();
-    return m_future.get();
+    finish();
+    if (m_exception) {
+        auto ex = m_exception;
+        m_exception = nullptr;
+        std::rethrow_exception(ex);
+    }
+    return m_result;
 }
 
 bool PortTask::waitDependencies() {
 
-    std::unique_lock<std::mutex> guard(m_mutex);
-    for (auto it = m_dependencies.begin(); it != m_dependencies.end(); ++it) {
-        auto &d = *it;
+    std::vector<std::shared_ptr<PortTask>> deps;
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        deps.assign(m_dependencies.begin(), m_dependencies.end());
+    }
+    for (auto &d: deps) {
         if (!d->isDone()) {
-            guard.unlock();
+            // run dependency right away if no thread has picked it up yet
+            m_module->runTask(d);
             d->wait();
-            guard.lock();
         }
     }
 
+    std::lock_guard<std::mutex> guard(m_mutex);
     m_dependencies.clear();
 
     return true;
 }
 
+bool PortTask::finish() {
+
+    if (m_state < Computed)
+        return false;
+    if (!dependenciesDone())
+        return false;
+
+    std::lock_guard<std::mutex> guard(m_finishMutex);
+    if (m_state == Done)
+        return true;
+    addAllObjects();
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_dependencies.clear();
+    }
+    m_state = Done;
+    return true;
+}
+
 template<class Payload>
 bool Module::sendMessage(message::Message &message, Payload &payload) const {
 
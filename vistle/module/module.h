@@ -27,6 +27,8 @@
 #include <deque>
 #include <mutex>
 #include <future>
+#include <atomic>
+#include <exception>
 
 #include <vistle/core/paramvector.h>
 #include <vistle/core/object.h>
@@ -68,6 +70,8 @@ class RemoveParameter;
 class MessageQueue;
 }
 
+class TaskPool;
+
 class V_MODULEEXPORT PortTask {
 
     friend class Module;
@@ -87,6 +91,7 @@ public:
     template<class Type>
     typename Type::const_ptr expect(const std::string &port);
 
+    //! output of this task is published only after all output of dep
     void addDependency(std::shared_ptr<PortTask> dep);
     void addObject(Port *port, Object::ptr obj);
     void addObject(const std::string &port, Object::ptr obj);
@@ -95,13 +100,24 @@ public:
 
     void addAllObjects();
 
+    //! whether computation has finished and all output has been published
     bool isDone();
     bool dependenciesDone();
 
+    //! wait for task to finish while helping with other tasks, returns result of compute
     bool wait();
     bool waitDependencies();
 
 protected:
+    enum State {
+        Queued,
+        Running,
+        Computed, //!< compute has returned
+        Done, //!< output has been published
+    };
+    //! publish output buffered while waiting for dependencies, returns whether task is done
+    bool finish();
+
     Module *m_module = nullptr;
     std::map<const Port *, Object::const_ptr> m_input;
     std::set<Port *> m_ports;
@@ -111,7 +127,11 @@ protected:
     std::map<Port *, std::deque<bool>> m_passThrough;
 
     std::mutex m_mutex;
-    std::shared_future<bool> m_future;
+    std::mutex m_finishMutex;
+    std::atomic<int> m_state{Queued};
+    int m_timestep = -1; //!< timestep of input objects
+    bool m_result = false;
+    std::exception_ptr m_exception;
 };
 
 class V_MODULEEXPORT Module: public ParameterManager, public MessageSender {
@@ -289,8 +309,10 @@ protected:
 
    virtual bool prepare(); //< prepare execution - called on each rank individually
    virtual bool reduce(int timestep); //< do reduction for timestep (-1: global) - called on all ranks
+   virtual bool reduceIncremental(int timestep); //< update reduction with block of timestep after its output has been published - called on each rank individually, only when streaming
    virtual bool cancelExecute(); //< if execution has been canceled early before all objects have been processed
    int numTimesteps() const;
+   bool streaming() const; //< whether output of each block is passed on as soon as it is available
 
    void setStatus(const std::string &text, message::UpdateStatus::Importance prio=message::UpdateStatus::Low);
    void clearStatus();
@@ -340,6 +362,9 @@ protected:
 
    int m_traceMessages;
    bool m_benchmark;
+   bool m_trace = false;
+   //! gather recorded events from all ranks and write them to a trace file on rank 0
+   void writeTrace();
    double m_benchmarkStart;
    double m_avgComputeTime;
    mpi::communicator m_comm;
@@ -350,9 +375,18 @@ protected:
    bool m_readyForQuit;
 
    IntParameter *m_concurrency = nullptr;
-   void waitAllTasks();
+   IntParameter *m_streaming = nullptr;
+   //! wait for all tasks and publish their output, returns whether incremental reductions succeeded
+   bool waitAllTasks();
+   //! pool executing tasks, created on first use
+   TaskPool &taskPool();
+   //! execute task unless another thread already has started it
+   void runTask(std::shared_ptr<PortTask> task) const;
+   //! remove tasks from front of m_tasks as long as they have published their output, returns whether incremental reductions succeeded
+   bool publishCompletedTasks();
    std::shared_ptr<PortTask> m_lastTask;
-   std::deque<std::shared_ptr<PortTask>> m_tasks;
+   std::deque<std::shared_ptr<PortTask>> m_tasks; //!< tasks in order of creation, output is published in this order
+   std::unique_ptr<TaskPool> m_taskPool;
 
    unsigned m_hardware_concurrency = 1;
 };
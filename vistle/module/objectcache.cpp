@@ -54,26 +54,35 @@ void ObjectCache::addObject(const std::string &portname, Object::const_ptr objec
    if (m_cacheMode == CacheNone)
       return;
 
-   ObjectList &objs = m_cache[portname];
-   if (!objs.empty()) {
-      const Meta &oldmeta = objs.front()->meta();
-      const Meta &newmeta = object->meta();
-      if (oldmeta.creator() != newmeta.creator()
-            || oldmeta.executionCounter() != newmeta.executionCounter()
-            || oldmeta.iteration() != newmeta.iteration()) {
-         objs.clear();
+   Entry &ent = m_cache[portname];
+   const Meta &newmeta = object->meta();
+   if (!ent.objects.empty()) {
+      if (ent.creator != newmeta.creator()
+            || ent.executionCounter != newmeta.executionCounter()
+            || ent.iteration != newmeta.iteration()) {
+         ent.objects.clear();
       }
    }
-   objs.push_back(object);
+   if (ent.objects.empty()) {
+      ent.creator = newmeta.creator();
+      ent.executionCounter = newmeta.executionCounter();
+      ent.iteration = newmeta.iteration();
+   }
+   ent.objects.push_back(ShmSpill::the().retain(object));
 }
 
-const ObjectList &ObjectCache::getObjects(const std::string &portname) const {
+ObjectList ObjectCache::getObjects(const std::string &portname) const {
 
-   std::map<std::string, ObjectList>::const_iterator it = m_cache.find(portname);
+   ObjectList objs;
+   auto it = m_cache.find(portname);
    if (it == m_cache.end())
-      return m_emptyList;
+      return objs;
 
-   return it->second;
+   for (const auto &handle: it->second.objects) {
+      if (auto obj = ShmSpill::the().access(handle))
+         objs.push_back(obj);
+   }
+   return objs;
 }
 
 } // namespace vistle
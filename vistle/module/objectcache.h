@@ -7,6 +7,7 @@
 
 #include <vistle/util/enum.h>
 #include <vistle/core/object.h>
+#include <vistle/core/shmspill.h>
 
 namespace vistle {
 
@@ -32,12 +33,18 @@ class ObjectCache {
       void setCacheMode(CacheMode mode);
 
       void addObject(const std::string &portname, Object::const_ptr object);
-      const ObjectList &getObjects(const std::string &portname) const;
+      //! objects spilled to disk because of shared memory pressure are restored
+      ObjectList getObjects(const std::string &portname) const;
 
    private:
+      struct Entry {
+         int creator = -1;
+         int executionCounter = -1;
+         int iteration = -1;
+         std::deque<ShmSpill::Handle> objects;
+      };
       CacheMode m_cacheMode;
-      std::map<std::string, ObjectList> m_cache, m_oldCache;
-      ObjectList m_emptyList;
+      std::map<std::string, Entry> m_cache, m_oldCache;
 };
 
 V_ENUM_OUTPUT_OP(CacheMode, ObjectCache)
@@ -0,0 +1,128 @@
+#include "taskpool.h"
+
+#include <chrono>
+#include <cassert>
+
+namespace vistle {
+
+namespace {
+
+thread_local const TaskPool *t_pool = nullptr; //!< pool the current thread is a worker of
+thread_local unsigned t_queue = 0; //!< queue of the current worker thread
+
+}
+
+TaskPool::TaskPool(unsigned numThreads)
+: m_nextQueue(0)
+, m_numQueued(0)
+{
+   if (numThreads < 1)
+      numThreads = 1;
+
+   for (unsigned i=0; i<numThreads; ++i)
+      m_queues.emplace_back(new Queue);
+   for (unsigned i=0; i<numThreads; ++i)
+      m_threads.emplace_back([this, i](){ workerLoop(i); });
+}
+
+TaskPool::~TaskPool() {
+
+   {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_quit = true;
+   }
+   m_workAvailable.notify_all();
+   for (auto &t: m_threads)
+      t.join();
+   assert(m_numQueued == 0);
+}
+
+unsigned TaskPool::numThreads() const {
+
+   return m_threads.size();
+}
+
+void TaskPool::submit(Task task) {
+
+   const unsigned q = t_pool == this ? t_queue : m_nextQueue++ % m_queues.size();
+   {
+      std::lock_guard<std::mutex> guard(m_queues[q]->mutex);
+      m_queues[q]->tasks.emplace_back(std::move(task));
+   }
+   ++m_numQueued;
+
+   {
+      // workers check m_numQueued while holding m_mutex
+      std::lock_guard<std::mutex> guard(m_mutex);
+   }
+   m_workAvailable.notify_one();
+   m_taskDone.notify_all();
+}
+
+bool TaskPool::runOne(unsigned queue) {
+
+   Task task;
+   const unsigned n = m_queues.size();
+   for (unsigned i=0; i<n && !task; ++i) {
+      auto &q = *m_queues[(queue+i)%n];
+      std::lock_guard<std::mutex> guard(q.mutex);
+      if (q.tasks.empty())
+         continue;
+      if (i == 0) {
+         task = std::move(q.tasks.front());
+         q.tasks.pop_front();
+      } else {
+         // steal the most recently queued task
+         task = std::move(q.tasks.back());
+         q.tasks.pop_back();
+      }
+   }
+   if (!task)
+      return false;
+
+   --m_numQueued;
+   task();
+   notifyDone();
+   return true;
+}
+
+void TaskPool::helpUntil(const std::function<bool()> &done) {
+
+   const unsigned queue = t_pool == this ? t_queue : 0;
+   while (!done()) {
+      if (runOne(queue))
+         continue;
+
+      // not all conditions are tied to task completion, so check again after a while
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if (m_numQueued > 0)
+         continue;
+      m_taskDone.wait_for(lock, std::chrono::milliseconds(1));
+   }
+}
+
+void TaskPool::workerLoop(unsigned idx) {
+
+   t_pool = this;
+   t_queue = idx;
+
+   for (;;) {
+      if (runOne(idx))
+         continue;
+
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_workAvailable.wait(lock, [this](){ return m_quit || m_numQueued > 0; });
+      if (m_quit && m_numQueued == 0)
+         break;
+   }
+}
+
+void TaskPool::notifyDone() {
+
+   {
+      std::lock_guard<std::mutex> guard(m_mutex);
+   }
+   m_taskDone.notify_all();
+}
+
+} // namespace vistle
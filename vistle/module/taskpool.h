@@ -0,0 +1,58 @@
+#ifndef VISTLE_TASKPOOL_H
+#define VISTLE_TASKPOOL_H
+
+#include "export.h"
+
+#include <functional>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace vistle {
+
+//! persistent pool of worker threads with one task queue per worker
+/*!
+ * Workers take tasks from the front of their own queue and steal from the back of other queues when theirs is empty.
+ * Threads waiting for a condition can help with queued tasks instead of blocking.
+ */
+class V_MODULEEXPORT TaskPool {
+
+ public:
+   typedef std::function<void()> Task;
+
+   explicit TaskPool(unsigned numThreads);
+   ~TaskPool();
+
+   unsigned numThreads() const;
+   //! queue task for execution, tasks submitted from a worker are queued for this worker
+   void submit(Task task);
+   //! execute queued tasks on the calling thread until done returns true
+   void helpUntil(const std::function<bool()> &done);
+
+ private:
+   struct Queue {
+      std::mutex mutex;
+      std::deque<Task> tasks;
+   };
+
+   //! run one task, preferably from queue, returns false if none was available
+   bool runOne(unsigned queue);
+   void workerLoop(unsigned idx);
+   void notifyDone();
+
+   std::vector<std::unique_ptr<Queue>> m_queues;
+   std::vector<std::thread> m_threads;
+   std::atomic<unsigned> m_nextQueue;
+   std::atomic<size_t> m_numQueued;
+
+   std::mutex m_mutex;
+   std::condition_variable m_workAvailable, m_taskDone;
+   bool m_quit = false;
+};
+
+} // namespace vistle
+#endif
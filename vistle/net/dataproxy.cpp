@@ -1,7 +1,11 @@
 #include "dataproxy.h"
 #include <vistle/core/tcpmessage.h>
 #include <vistle/core/message.h>
+#include <vistle/core/messages.h>
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
 #include <vistle/core/statetracker.h>
 #include <condition_variable>
 #include <boost/asio/deadline_timer.hpp>
@@ -12,6 +16,7 @@
 static const bool store_and_forward = true;
 static const int min_num_sockets = 2;
 static const int max_num_sockets = 12;
+static const auto stripe_timeout = std::chrono::seconds(120); // incomplete striped transfers without progress are discarded
 
 namespace asio = boost::asio;
 using boost::system::error_code;
@@ -37,6 +42,13 @@ DataProxy::DataProxy(io_service &io, StateTracker &state, unsigned short basePor
 , m_acceptorv6(m_io)
 , m_boost_archive_version(0)
 {
+   if (const char *streams = getenv("VISTLE_DATA_STREAMS")) {
+       m_numStreams = std::max(0, atoi(streams));
+   }
+   if (const char *stripe = getenv("VISTLE_DATA_STRIPE_SIZE")) {
+       m_stripeSize = strtoull(stripe, nullptr, 10);
+   }
+
    if (m_port == 0) {
        if (!changePort)
            return;
@@ -99,6 +111,13 @@ void DataProxy::setTrace(message::Type type) {
     m_traceMessages = type;
 }
 
+void DataProxy::setStriping(int numStreams, size_t stripeSize) {
+
+    lock_guard lock(m_mutex);
+    m_numStreams = numStreams;
+    m_stripeSize = stripeSize;
+}
+
 asio::io_service &DataProxy::io() {
     return m_io;
 }
@@ -218,6 +237,7 @@ bool DataProxy::removeSocket(std::shared_ptr<DataProxy::tcp_socket> sock) {
     sock->close();
 
     lock_guard lock(m_mutex);
+    abortStripedTransfers(sock);
 
     for (auto it = m_localDataSocket.begin(); it != m_localDataSocket.end(); ++it) {
         if (it->second != sock)
@@ -241,6 +261,29 @@ bool DataProxy::removeSocket(std::shared_ptr<DataProxy::tcp_socket> sock) {
     return false;
 }
 
+void DataProxy::abortStripedTransfers(std::shared_ptr<DataProxy::tcp_socket> sock) {
+
+    lock_guard lock(m_mutex);
+
+    // stripes are distributed over all connections, so none of the transfers in flight can complete
+    for (const auto &conn: m_remoteDataSocket) {
+        const auto &socks = conn.second.sockets;
+        if (std::find(socks.begin(), socks.end(), sock) == socks.end())
+            continue;
+
+        const int hubId = conn.first;
+        for (auto it = m_stripedTransfers.begin(); it != m_stripedTransfers.end(); ) {
+            if (it->first.first == hubId) {
+                CERR << "aborting striped transfer " << it->first.second << " from " << hubId << ": connection lost" << std::endl;
+                it = m_stripedTransfers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        break;
+    }
+}
+
 void DataProxy::startThread() {
    lock_guard lock(m_mutex);
    if (true || m_threads.size() < std::thread::hardware_concurrency()) {
@@ -382,6 +425,7 @@ void DataProxy::msgForward(std::shared_ptr<tcp_socket> sock, EndPointType type)
         async_recv(*sock, *msg, [this, sock, msg, type](error_code ec, std::shared_ptr<buffer> payload){
             if (ec) {
                 CERR << "msgForward, dest=" << toString(type) << ": error " << ec.message() << std::endl;
+                abortStripedTransfers(sock);
                 return;
             }
 
@@ -405,6 +449,11 @@ void DataProxy::msgForward(std::shared_ptr<tcp_socket> sock, EndPointType type)
 
             msgForward(sock, type);
 
+            if (msg->type() == PAYLOADSTRIPE) {
+                receiveStripe(msg->as<PayloadStripe>(), payload);
+                return;
+            }
+
             bool needPayload = false;
             bool forward = false;
             switch(msg->type()) {
@@ -447,7 +496,9 @@ void DataProxy::msgForward(std::shared_ptr<tcp_socket> sock, EndPointType type)
                 needPayload = true;
             }
 
-            if (forward) {
+            if (forward && type == Remote && sendStriped(*msg, payload)) {
+                // payload is returned once all stripes have been sent
+            } else if (forward) {
                 auto dest = type==Local ? getLocalDataSock(*msg) : getRemoteDataSock(*msg);
                 if (dest) {
                     async_send(*dest, *msg, payload, [type, dest, payload](error_code ec) mutable {
@@ -621,6 +672,8 @@ bool DataProxy::connectRemoteData(const message::AddHub &remote) {
    unsigned short dataPort = remote.dataPort() ? remote.dataPort() : remote.port();
 
    size_t numconn = std::min(max_num_sockets, std::max(min_num_sockets, std::max(m_numRanks, remote.numRanks())));
+   if (m_numStreams > 0)
+       numconn = std::max(numconn, size_t(m_numStreams));
    size_t numtries = numconn - m_remoteDataSocket[hubId].sockets.size();
    CERR << "establishing data connection from hub " << m_hubId << " with " << m_numRanks << " ranks to " << remote.id() << " with " << remote.numRanks() << " ranks, "
         << numtries << " tries for " << numconn << " parallel connections to " << remote.address() << ":" << dataPort << std::flush;
@@ -737,4 +790,204 @@ std::shared_ptr<boost::asio::ip::tcp::socket> DataProxy::getRemoteDataSock(const
    return socks[idx++];
 }
 
+std::vector<std::shared_ptr<boost::asio::ip::tcp::socket>> DataProxy::getRemoteDataSocks(const message::Message &msg) {
+
+   int hubId = idToHub(msg.destId());
+
+   lock_guard lock(m_mutex);
+   std::vector<std::shared_ptr<tcp_socket>> result;
+   auto it = m_remoteDataSocket.find(hubId);
+   if (it == m_remoteDataSocket.end())
+       return result;
+   auto &socks = it->second.sockets;
+   if (socks.empty())
+       return result;
+   size_t num = socks.size();
+   if (m_numStreams > 0)
+       num = std::min(num, size_t(m_numStreams));
+   // rotate starting connection, so that concurrent transfers start on different connections
+   auto &idx = it->second.next_socket;
+   for (size_t i=0; i<num; ++i) {
+       idx %= socks.size();
+       result.emplace_back(socks[idx++]);
+   }
+   return result;
+}
+
+bool DataProxy::sendStriped(const message::Message &msg, std::shared_ptr<buffer> payload) {
+
+    using namespace vistle::message;
+
+    size_t stripeSize = 0;
+    {
+        lock_guard lock(m_mutex);
+        stripeSize = m_stripeSize;
+    }
+    if (!payload || stripeSize == 0 || payload->size() <= stripeSize)
+        return false;
+    auto socks = getRemoteDataSocks(msg);
+    if (socks.size() < 2)
+        return false;
+
+    uint64_t transferId = 0;
+    {
+        lock_guard lock(m_mutex);
+        transferId = ++m_numStripedTransfers;
+    }
+
+    const size_t total = payload->size();
+    const int numStripes = (total+stripeSize-1)/stripeSize;
+
+    struct SendState {
+        std::atomic<int> remaining;
+        std::chrono::steady_clock::time_point start;
+    };
+    auto state = std::make_shared<SendState>();
+    state->remaining = numStripes+1;
+    state->start = std::chrono::steady_clock::now();
+    const bool trace = m_traceMessages == message::ANY || m_traceMessages == msg.type() || m_traceMessages == PAYLOADSTRIPE;
+    const size_t numSocks = socks.size();
+    std::stringstream desc;
+    if (trace)
+        desc << msg;
+    auto done = [state, payload, total, numStripes, numSocks, trace, desc=desc.str()](error_code ec) mutable {
+        if (ec) {
+            CERR << "error in striped write to remote: " << ec.message() << std::endl;
+        }
+        if (--state->remaining > 0)
+            return;
+        if (trace) {
+            double sec = std::chrono::duration<double>(std::chrono::steady_clock::now()-state->start).count();
+            CERR << "sent " << total << " bytes in " << numStripes << " stripes over " << numSocks << " connections in " << sec << " s: "
+                 << (sec > 0. ? total/sec/1e6 : 0.) << " MB/s, " << desc << std::endl;
+        }
+        message::return_buffer(payload);
+    };
+
+    // message the payload belongs to travels as payload of stripe -1
+    auto header = std::make_shared<buffer>(msg.size());
+    memcpy(header->data(), &msg, msg.size());
+    auto hdr = make.message<PayloadStripe>(transferId, -1, numStripes, 0, total, header->size());
+    hdr.setDestId(msg.destId());
+    hdr.setDestRank(msg.destRank());
+    async_send(*socks[0], hdr, header, done);
+
+    for (int i=0; i<numStripes; ++i) {
+        const size_t offset = i*stripeSize;
+        const size_t size = std::min(stripeSize, total-offset);
+        auto stripe = make.message<PayloadStripe>(transferId, i, numStripes, offset, total, size);
+        stripe.setDestId(msg.destId());
+        stripe.setDestRank(msg.destRank());
+        async_send(*socks[(i+1)%numSocks], stripe, payload, offset, size, done);
+    }
+
+    return true;
+}
+
+void DataProxy::receiveStripe(const message::PayloadStripe &stripe, std::shared_ptr<buffer> payload) {
+
+    using namespace vistle::message;
+
+    const auto key = std::make_pair(stripe.senderId(), stripe.transferId());
+    const size_t size = payload ? payload->size() : 0;
+    std::shared_ptr<message::Buffer> header;
+    std::shared_ptr<buffer> data;
+    {
+        lock_guard lock(m_mutex);
+        const auto now = std::chrono::steady_clock::now();
+        auto it = m_stripedTransfers.find(key);
+        if (it == m_stripedTransfers.end()) {
+            // discard transfers which have not made progress for a long time, their sender might have vanished
+            for (auto it2 = m_stripedTransfers.begin(); it2 != m_stripedTransfers.end(); ) {
+                if (now-it2->second.last > stripe_timeout) {
+                    CERR << "striped transfer " << it2->first.second << " from " << it2->first.first << " timed out" << std::endl;
+                    it2 = m_stripedTransfers.erase(it2);
+                } else {
+                    ++it2;
+                }
+            }
+            it = m_stripedTransfers.emplace(key, StripedTransfer()).first;
+            auto &t = it->second;
+            t.numStripes = stripe.numStripes();
+            t.start = now;
+            t.payload = message::get_buffer(stripe.totalSize());
+            t.payload->resize(stripe.totalSize());
+        }
+        auto &t = it->second;
+        t.last = now;
+        bool invalid = false;
+        if (!t.failed) {
+            if (stripe.index() < 0) {
+                if (size < sizeof(Message) || size > Message::MESSAGE_SIZE) {
+                    CERR << "invalid header of striped transfer: " << stripe << std::endl;
+                    invalid = true;
+                } else {
+                    t.header = std::make_shared<message::Buffer>();
+                }
+            } else if (stripe.offset()+size > t.payload->size()) {
+                CERR << "stripe exceeds payload: " << stripe << std::endl;
+                invalid = true;
+            }
+        }
+        if (invalid) {
+            // keep entry, so that remaining stripes of this transfer are recognized and discarded
+            t.failed = true;
+            t.header.reset();
+            t.payload.reset();
+        }
+        if (t.failed) {
+            message::return_buffer(payload);
+            if (++t.numReceived >= t.numStripes+1)
+                m_stripedTransfers.erase(it);
+            return;
+        }
+        header = t.header;
+        data = t.payload;
+    }
+
+    // copy outside of lock, stripes arrive concurrently on several connections
+    if (stripe.index() < 0) {
+        memcpy(header->data(), payload->data(), size);
+    } else if (size > 0) {
+        memcpy(data->data()+stripe.offset(), payload->data(), size);
+    }
+    message::return_buffer(payload);
+
+    StripedTransfer t;
+    {
+        lock_guard lock(m_mutex);
+        auto it = m_stripedTransfers.find(key);
+        if (it == m_stripedTransfers.end())
+            return;
+        ++it->second.numReceived;
+        if (it->second.numReceived < it->second.numStripes+1)
+            return;
+        t = it->second;
+        m_stripedTransfers.erase(it);
+        if (t.failed)
+            return;
+    }
+
+    if (m_traceMessages == message::ANY || m_traceMessages == t.header->type() || m_traceMessages == PAYLOADSTRIPE) {
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now()-t.start).count();
+        CERR << "received " << t.payload->size() << " bytes in " << t.numStripes << " stripes in " << sec << " s: "
+             << (sec > 0. ? t.payload->size()/sec/1e6 : 0.) << " MB/s, " << *t.header << std::endl;
+    }
+
+    auto dest = getLocalDataSock(*t.header);
+    if (!dest) {
+        CERR << "no destination socket for striped transfer of " << *t.header << std::endl;
+        message::return_buffer(t.payload);
+        return;
+    }
+    auto pl = t.payload;
+    async_send(*dest, *t.header, pl, [dest, pl](error_code ec) mutable {
+        message::return_buffer(pl);
+        if (ec) {
+            CERR << "error in write to local: " << ec.message() << std::endl;
+            return;
+        }
+    });
+}
+
 }
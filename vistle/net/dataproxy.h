@@ -6,6 +6,8 @@
 #include <mutex>
 #include <thread>
 #include <set>
+#include <map>
+#include <chrono>
 
 #include <vistle/core/message.h>
 #include <vistle/util/enum.h>
@@ -19,6 +21,7 @@ class StateTracker;
 namespace message {
 class Identify;
 class AddHub;
+class PayloadStripe;
 }
 
 class V_NETEXPORT DataProxy {
@@ -36,6 +39,8 @@ public:
     void setBoostArchiveVersion(int ver);
     unsigned short port() const;
     void setTrace(message::Type type);
+    //! split payloads larger than stripeSize bytes (0: never) across up to numStreams (0: all) parallel connections to remote hubs
+    void setStriping(int numStreams, size_t stripeSize);
 
    bool connectRemoteData(const message::AddHub &hub);
    bool addSocket(const message::Identify &id, std::shared_ptr<tcp_socket> sock);
@@ -60,6 +65,24 @@ private:
    };
    std::map<int, ConnectionData> m_remoteDataSocket; // hub id -> socket
    int m_boost_archive_version;
+
+   int m_numStreams = 0;
+   size_t m_stripeSize = 4*1024*1024;
+   uint64_t m_numStripedTransfers = 0;
+   struct StripedTransfer {
+       std::shared_ptr<message::Buffer> header;
+       std::shared_ptr<buffer> payload;
+       int numStripes = 0;
+       int numReceived = 0; //!< including header
+       bool failed = false; //!< remaining stripes are discarded
+       std::chrono::steady_clock::time_point start, last;
+   };
+   std::map<std::pair<int, uint64_t>, StripedTransfer> m_stripedTransfers; // (sender hub, transfer id) -> reassembly state
+   //! discard incomplete transfers from the hub connected via sock
+   void abortStripedTransfers(std::shared_ptr<tcp_socket> sock);
+   std::vector<std::shared_ptr<tcp_socket>> getRemoteDataSocks(const message::Message &msg);
+   bool sendStriped(const message::Message &msg, std::shared_ptr<buffer> payload);
+   void receiveStripe(const message::PayloadStripe &stripe, std::shared_ptr<buffer> payload);
    void startAccept(acceptor &a);
    void handleAccept(acceptor &a, const boost::system::error_code &error, std::shared_ptr<tcp_socket> sock);
    void handleConnect(std::shared_ptr<tcp_socket> sock0, std::shared_ptr<tcp_socket> sock1, const boost::system::error_code &error);
@@ -32,6 +32,7 @@
 #include <iostream>
 #include <vector>
 #include <cstdlib>
+#include <cmath>
 #include <cstring>
 #include <algorithm>
 #include <map>
@@ -331,7 +332,13 @@ void COVER::prepareQuit() {
 
 bool COVER::executeAll() const {
 
-   message::Execute exec; // execute all sources in data flow graph
+   auto &anim = *coVRAnimationManager::instance();
+   double dt = 0.;
+   if (anim.animationRunning() && std::abs(anim.getCurrentSpeed()) > 0.) {
+       dt = 1. / anim.getCurrentSpeed();
+   }
+   // execute all sources in data flow graph, starting with the timestep currently shown
+   message::Execute exec(message::Id::Broadcast, anim.getAnimationFrame(), dt);
    exec.setDestId(message::Id::MasterHub);
    sendMessage(exec);
    return true;
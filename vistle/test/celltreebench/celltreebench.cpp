@@ -0,0 +1,238 @@
+/*
+ * compare construction and query times of serial and parallel celltree builders
+ *
+ * The serial builder refines with 5 bins per dimension, the parallel builder with 16.
+ * The parallel builder is therefore also run on a single thread, so that the effect of the bin count
+ * can be told apart from the effect of parallelism.
+ * The trees of the parallel builder have to be identical for any number of threads,
+ * and all trees have to locate the same query points. Otherwise, the exit status is 1.
+ *
+ * usage: vistle_celltreebench [cells per dimension] [number of queries] [number of threads]
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <limits>
+#include <cstdlib>
+#include <algorithm>
+
+#include <vistle/core/shm.h>
+#include <vistle/core/unstr.h>
+#include <vistle/core/celltree.h>
+#include <vistle/core/cellalgorithm.h>
+
+using namespace vistle;
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds(Clock::time_point start) {
+   return std::chrono::duration<double>(Clock::now()-start).count();
+}
+
+static UnstructuredGrid::ptr createGrid(Index dim) {
+
+   const Index nvert = (dim+1)*(dim+1)*(dim+1);
+   const Index nelem = dim*dim*dim;
+   UnstructuredGrid::ptr grid(new UnstructuredGrid(nelem, 8*nelem, nvert));
+
+   // perturbed vertices of a uniform grid
+   std::mt19937 gen(0);
+   std::uniform_real_distribution<Scalar> jitter(-0.2, 0.2);
+   Scalar *x = grid->x().data(), *y = grid->y().data(), *z = grid->z().data();
+   auto vidx = [dim](Index i, Index j, Index k) -> Index { return (i*(dim+1)+j)*(dim+1)+k; };
+   for (Index i=0; i<=dim; ++i) {
+      for (Index j=0; j<=dim; ++j) {
+         for (Index k=0; k<=dim; ++k) {
+            Index v = vidx(i, j, k);
+            x[v] = i + (i>0 && i<dim ? jitter(gen) : 0);
+            y[v] = j + (j>0 && j<dim ? jitter(gen) : 0);
+            z[v] = k + (k>0 && k<dim ? jitter(gen) : 0);
+         }
+      }
+   }
+
+   Index *el = grid->el().data(), *cl = grid->cl().data();
+   Byte *tl = grid->tl().data();
+   Index elem = 0;
+   for (Index i=0; i<dim; ++i) {
+      for (Index j=0; j<dim; ++j) {
+         for (Index k=0; k<dim; ++k) {
+            el[elem] = 8*elem;
+            tl[elem] = UnstructuredGrid::HEXAHEDRON;
+            Index *c = &cl[8*elem];
+            c[0] = vidx(i, j, k);
+            c[1] = vidx(i+1, j, k);
+            c[2] = vidx(i+1, j+1, k);
+            c[3] = vidx(i, j+1, k);
+            c[4] = vidx(i, j, k+1);
+            c[5] = vidx(i+1, j, k+1);
+            c[6] = vidx(i+1, j+1, k+1);
+            c[7] = vidx(i, j+1, k+1);
+            ++elem;
+         }
+      }
+   }
+   el[nelem] = 8*nelem;
+
+   return grid;
+}
+
+//! numThreads=0: use all hardware threads, serial: use Celltree::initSerial
+static Celltree3::ptr build(UnstructuredGrid::const_ptr grid, bool serial, unsigned numThreads, double &time) {
+
+   const Index nelem = grid->getNumElements();
+   const Index *el = grid->el(), *cl = grid->cl();
+   const Scalar *coords[3] = { grid->x(), grid->y(), grid->z() };
+
+   const Scalar smax = std::numeric_limits<Scalar>::max();
+   Vector vmin, vmax;
+   vmin.fill(-smax);
+   vmax.fill(smax);
+   std::vector<Vector> min(nelem, vmax), max(nelem, vmin);
+   Vector gmin=vmax, gmax=vmin;
+   for (Index i=0; i<nelem; ++i) {
+      for (Index c=el[i]; c<el[i+1]; ++c) {
+         const Index v = cl[c];
+         for (int d=0; d<3; ++d) {
+            min[i][d] = std::min(min[i][d], coords[d][v]);
+            max[i][d] = std::max(max[i][d], coords[d][v]);
+         }
+      }
+      for (int d=0; d<3; ++d) {
+         gmin[d] = std::min(gmin[d], min[i][d]);
+         gmax[d] = std::max(gmax[d], max[i][d]);
+      }
+   }
+
+   auto start = Clock::now();
+   Celltree3::ptr ct(new Celltree3(nelem));
+   if (serial)
+      ct->initSerial(min.data(), max.data(), gmin, gmax);
+   else
+      ct->init(min.data(), max.data(), gmin, gmax, numThreads);
+   time = seconds(start);
+
+   return ct;
+}
+
+//! locate points, cells[i] is the cell containing points[i] or InvalidIndex
+static Index query(UnstructuredGrid::const_ptr grid, Celltree3::const_ptr ct, const std::vector<Vector> &points, std::vector<Index> &cells, double &time) {
+
+   Index found = 0;
+   cells.resize(points.size());
+   auto start = Clock::now();
+   for (size_t i=0; i<points.size(); ++i) {
+      const auto &p = points[i];
+      PointVisitationFunctor<Scalar, Index> nodeFunc(p);
+      PointInclusionFunctor<UnstructuredGrid, Scalar, Index> elemFunc(grid.get(), p);
+      ct->traverse(nodeFunc, elemFunc);
+      cells[i] = elemFunc.cell;
+      if (elemFunc.cell != InvalidIndex)
+         ++found;
+   }
+   time = seconds(start);
+   return found;
+}
+
+//! whether both trees have the same nodes and cell order
+static bool equal(Celltree3::const_ptr a, Celltree3::const_ptr b) {
+
+   const auto &na = a->nodes(), &nb = b->nodes();
+   if (na.size() != nb.size())
+      return false;
+   for (size_t i=0; i<na.size(); ++i) {
+      const auto &x = na[i], &y = nb[i];
+      if (x.dim != y.dim)
+         return false;
+      if (x.isLeaf()) {
+         if (x.start != y.start || x.size != y.size)
+            return false;
+      } else {
+         if (x.Lmax != y.Lmax || x.Rmin != y.Rmin || x.child != y.child)
+            return false;
+      }
+   }
+
+   const auto &ca = a->cells(), &cb = b->cells();
+   return ca.size() == cb.size() && std::equal(ca.begin(), ca.end(), cb.begin());
+}
+
+int main(int argc, char *argv[]) {
+
+   vistle::registerTypes();
+
+   Index dim = 100;
+   if (argc > 1)
+      dim = atol(argv[1]);
+   size_t numQueries = 1000000;
+   if (argc > 2)
+      numQueries = atol(argv[2]);
+   unsigned numThreads = 0;
+   if (argc > 3)
+      numThreads = atoi(argv[3]);
+
+   std::string shmname = "vistle_celltreebench";
+   Shm::remove(shmname, 1, 0);
+   Shm::create(shmname, 1, 0);
+
+   bool ok = true;
+   {
+      auto grid = createGrid(dim);
+      std::cerr << "grid: " << grid->getNumElements() << " hexahedra" << std::endl;
+
+      std::mt19937 gen(1);
+      std::uniform_real_distribution<Scalar> coord(0, dim);
+      std::vector<Vector> points(numQueries);
+      for (auto &p: points)
+         p = Vector(coord(gen), coord(gen), coord(gen));
+
+      struct Run {
+         std::string tag;
+         bool serial;
+         unsigned numThreads;
+      };
+      const Run runs[] = {
+         { "serial, 5 bins", true, 1 },
+         { "parallel builder on 1 thread, 16 bins", false, 1 },
+         { "parallel builder, 16 bins", false, numThreads },
+      };
+      std::vector<Celltree3::const_ptr> trees;
+      std::vector<std::vector<Index>> located;
+      for (const auto &run: runs) {
+         const std::string &tag = run.tag;
+         double buildTime = 0., queryTime = 0.;
+         auto ct = build(grid, run.serial, run.numThreads, buildTime);
+         located.emplace_back();
+         Index found = query(grid, ct, points, located.back(), queryTime);
+         std::cerr << tag << ": " << ct->nodes().size() << " nodes"
+                   << ", build: " << buildTime << " s"
+                   << ", query: " << queryTime << " s for " << points.size() << " points"
+                   << " (" << found << " found)" << std::endl;
+         trees.push_back(ct);
+      }
+
+      if (!equal(trees[1], trees[2])) {
+         std::cerr << "ERROR: parallel builder on 1 thread and on " << numThreads << " threads created different trees" << std::endl;
+         ok = false;
+      }
+      // points on faces may be assigned to either neighbor, but all trees have to find a cell
+      for (size_t r=1; r<located.size(); ++r) {
+         size_t mismatch = 0;
+         for (size_t i=0; i<points.size(); ++i) {
+            if ((located[0][i] == InvalidIndex) != (located[r][i] == InvalidIndex))
+               ++mismatch;
+         }
+         if (mismatch > 0) {
+            std::cerr << "ERROR: " << runs[r].tag << ": " << mismatch << " points located differently than with " << runs[0].tag << std::endl;
+            ok = false;
+         }
+      }
+   }
+
+   Shm::remove(shmname, 1, 0);
+
+   return ok ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+// check that modifying a clone does not change the arrays it shares with its source
+
+#include <iostream>
+#include <string>
+
+#include <boost/interprocess/shared_memory_object.hpp>
+
+#include <vistle/core/shm.h>
+#include <vistle/core/vec.h>
+#include <vistle/core/coordswradius.h>
+
+using namespace vistle;
+
+namespace bi = boost::interprocess;
+
+static int failures = 0;
+
+static void check(bool ok, const std::string &what) {
+   if (!ok) {
+      std::cerr << "FAILED: " << what << std::endl;
+      ++failures;
+   }
+}
+
+static void testVec() {
+
+   const Index size = 10;
+   Vec<Scalar,3>::ptr src(new Vec<Scalar,3>(size));
+   for (int c=0; c<3; ++c)
+      for (Index i=0; i<size; ++i)
+         src->x(c)[i] = c*size+i;
+
+   // read source through const pointer: mutable accessors would unshare its arrays
+   Vec<Scalar,3>::const_ptr csrc = src;
+
+   auto clone = src->clone();
+   clone->setSize(size/2);
+   check(clone->getSize() == size/2, "clone resized");
+   check(csrc->getSize() == size, "source size unchanged after resizing clone");
+   for (int c=0; c<3; ++c)
+      for (Index i=0; i<size; ++i)
+         check(csrc->x(c)[i] == c*size+i, "source data unchanged after resizing clone");
+
+   auto exact = src->clone();
+   exact->setExact(true);
+   for (int c=0; c<3; ++c)
+      check(!csrc->d()->x[c]->exact(), "source not flagged exact by clone");
+}
+
+static void testCoordsWithRadius() {
+
+   const Index size = 10;
+   CoordsWithRadius::ptr src(new CoordsWithRadius(size));
+   for (Index i=0; i<size; ++i)
+      src->r()[i] = i;
+
+   CoordsWithRadius::const_ptr csrc = src;
+
+   auto clone = src->clone();
+   clone->setSize(2*size);
+   check(clone->getNumVertices() == 2*size, "clone with radius resized");
+   check(csrc->getNumVertices() == size, "source coordinates unchanged after resizing clone");
+   check(csrc->d()->r->size() == size, "source radius unchanged after resizing clone");
+   for (Index i=0; i<size; ++i)
+      check(csrc->r()[i] == i, "source radius data unchanged after resizing clone");
+}
+
+int main(int argc, char *argv[]) {
+
+   vistle::registerTypes();
+
+   std::string shmname = "vistle_cowtest";
+   bi::shared_memory_object::remove(shmname.c_str());
+   Shm::create(shmname, 1, 0);
+
+   testVec();
+   testCoordsWithRadius();
+
+   Shm::remove(shmname, 1, 0);
+
+   if (failures > 0) {
+      std::cerr << failures << " checks failed" << std::endl;
+      return 1;
+   }
+   std::cerr << "success" << std::endl;
+   return 0;
+}
@@ -72,6 +72,7 @@ int main() {
          M(REMOTERENDERING, RemoteRenderMessage)
          M(FILEQUERY, FileQuery)
          M(FILEQUERYRESULT, FileQueryResult)
+         M(PAYLOADSTRIPE, PayloadStripe)
 
          default: {
             std::cerr << i << " unhandled: " << type << std::endl;
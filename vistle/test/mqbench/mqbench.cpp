@@ -0,0 +1,106 @@
+// latency and throughput of message queues between two processes for all MessageQueue backends
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <vistle/core/message.h>
+#include <vistle/core/messages.h>
+#include <vistle/core/messagequeue.h>
+
+using namespace vistle;
+using namespace vistle::message;
+
+typedef std::chrono::steady_clock Clock;
+
+double seconds(Clock::time_point start) {
+   return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// child: echo everything received on ping to pong, stop after count messages
+int echo(const std::string &pingName, const std::string &pongName, int count) {
+
+   MessageQueue *ping = MessageQueue::open(pingName);
+   MessageQueue *pong = MessageQueue::open(pongName);
+   Buffer buf;
+   for (int i=0; i<count; ++i) {
+      ping->receive(buf);
+      pong->send(buf);
+   }
+   delete ping;
+   delete pong;
+   return 0;
+}
+
+// child: consume count messages
+int sink(const std::string &name, int count) {
+
+   MessageQueue *mq = MessageQueue::open(name);
+   Buffer buf;
+   for (int i=0; i<count; ++i) {
+      mq->receive(buf);
+   }
+   delete mq;
+   return 0;
+}
+
+void bench(MessageQueue::Backend backend, const std::string &tag, int count) {
+
+   const std::string prefix = "vistle_mqbench_" + std::to_string(getpid()) + "_";
+   Ping msg('x');
+   Buffer buf;
+
+   {
+      const std::string pingName = prefix + "ping", pongName = prefix + "pong";
+      MessageQueue *ping = MessageQueue::create(pingName, backend);
+      MessageQueue *pong = MessageQueue::create(pongName, backend);
+      pid_t pid = fork();
+      if (pid == 0)
+         exit(echo(pingName, pongName, count));
+
+      auto start = Clock::now();
+      for (int i=0; i<count; ++i) {
+         ping->send(msg);
+         pong->receive(buf);
+      }
+      double t = seconds(start);
+      waitpid(pid, nullptr, 0);
+      delete ping;
+      delete pong;
+      std::cerr << std::setw(6) << tag << " latency:    " << t/count*1e6/2 << " us per hop (" << count << " round trips)" << std::endl;
+   }
+
+   {
+      const std::string name = prefix + "stream";
+      MessageQueue *mq = MessageQueue::create(name, backend);
+      pid_t pid = fork();
+      if (pid == 0)
+         exit(sink(name, count));
+
+      auto start = Clock::now();
+      for (int i=0; i<count; ++i) {
+         mq->send(msg);
+      }
+      waitpid(pid, nullptr, 0);
+      double t = seconds(start);
+      delete mq;
+      std::cerr << std::setw(6) << tag << " throughput: " << count/t << " messages/s (" << count << " messages of " << msg.size() << " bytes)" << std::endl;
+   }
+}
+
+int main(int argc, char *argv[]) {
+
+   int count = 100000;
+   if (argc > 1)
+      count = atoi(argv[1]);
+
+   bench(MessageQueue::BoostQueue, "boost", count);
+   bench(MessageQueue::Ring, "ring", count);
+
+   return 0;
+}
@@ -12,6 +12,7 @@
 #include <vistle/core/shm.h>
 #include <vistle/core/object.h>
 #include <vistle/core/shmvector.h>
+#include <vistle/core/shmconfig.h>
 
 using namespace vistle;
 
@@ -77,6 +78,16 @@ int main(int argc, char ** argv) {
             exit(1);
         }
 
+        std::cout << "rank " << (forceRank >= 0 ? forceRank : rank) << ": " << ShmConfig::current().toString() << std::endl;
+#ifdef __linux__
+        {
+            std::ifstream thp("/sys/kernel/mm/transparent_hugepage/shmem_enabled");
+            std::string mode;
+            if (thp && std::getline(thp, mode))
+                std::cout << "transparent huge pages for shared memory: " << mode << std::endl;
+        }
+#endif
+
 #ifdef SHMDEBUG
        for (size_t i=0; i<Shm::s_shmdebug->size(); ++i) {
            const ShmDebugInfo &info = (*Shm::s_shmdebug)[i];
@@ -11,11 +11,14 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <thread>
+#include <chrono>
 
 #include <mpi.h>
 
 #include <vistle/core/shm_array.h>
 #include <vistle/core/shm.h>
+#include <vistle/core/shmslab.h>
 #include <vistle/core/vec.h>
 
 #include <vistle/util/allocator.h>
@@ -122,6 +125,35 @@ namespace bi = boost::interprocess;
 
 using namespace vistle;
 
+// allocate and release many small blocks of varying size from several threads concurrently
+template<class Alloc, class Dealloc>
+void time_small_alloc(const std::string &tag, int numThreads, Index count, Alloc alloc, Dealloc dealloc) {
+
+   const size_t live = 256;
+   auto start = std::chrono::steady_clock::now();
+   std::vector<std::thread> threads;
+   for (int t=0; t<numThreads; ++t) {
+      threads.emplace_back([=, &alloc, &dealloc](){
+         std::vector<std::pair<void *, size_t>> blocks(live, std::make_pair(nullptr, size_t(0)));
+         for (Index i=0; i<count; ++i) {
+            auto &b = blocks[i%live];
+            if (b.first)
+               dealloc(b.first, b.second);
+            b.second = 8 + ((i*7919+t*104729) % ShmSlab::MaxBytes)/8*8;
+            b.first = alloc(b.second);
+         }
+         for (auto &b: blocks) {
+            if (b.first)
+               dealloc(b.first, b.second);
+         }
+      });
+   }
+   for (auto &t: threads)
+      t.join();
+   std::chrono::duration<double> elapsed = std::chrono::steady_clock::now()-start;
+   std::cerr << count << " " << tag << " " << numThreads << " threads: " << elapsed.count() << std::endl;
+}
+
 int main(int argc, char *argv[]) {
 
    vistle::registerTypes();
@@ -217,6 +249,26 @@ int main(int argc, char *argv[]) {
       vistle::Shm::remove(shmname, 1, 0);
    }
 
+   {
+      bi::shared_memory_object::remove(shmname.c_str());
+      vistle::Shm::create(shmname, 1, 0);
+      const Index count = 1L << (shift-4);
+      std::vector<int> numThreads{1};
+      if (std::thread::hardware_concurrency() > 1)
+         numThreads.push_back(std::thread::hardware_concurrency());
+      for (int nt: numThreads) {
+         time_small_alloc("small alloc segment manager", nt, count,
+                          [](size_t bytes){ return Shm::the().shm().allocate(bytes); },
+                          [](void *p, size_t){ Shm::the().shm().deallocate(p); });
+         if (ShmSlab::enabled()) {
+            time_small_alloc("small alloc slab", nt, count,
+                             [](size_t bytes){ return ShmSlab::allocate(bytes); },
+                             [](void *p, size_t bytes){ ShmSlab::deallocate(p, bytes); });
+         }
+      }
+      vistle::Shm::remove(shmname, 1, 0);
+   }
+
 #if 0
    { 
       bi::shared_memory_object::remove(shmname.c_str());
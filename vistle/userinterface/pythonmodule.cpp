@@ -16,6 +16,7 @@
 #include <vistle/core/message.h>
 #include <vistle/core/parameter.h>
 #include <vistle/core/port.h>
+#include <vistle/core/profiler.h>
 
 #include "pythonmodule.h"
 #ifdef EMBED_PYTHON
@@ -517,6 +518,27 @@ static void setIntParam(int id, const char *name, Integer value, bool delayed) {
    sendMessage(m);
 }
 
+static void profile(int id=message::Id::Broadcast, bool onoff=true) {
+
+#ifdef DEBUG
+   auto cerrflags = std::cerr.flags();
+   std::cerr << "Python: profile " << id << ": " << std::boolalpha << onoff << std::endl;
+   std::cerr.flags(cerrflags);
+#endif
+   std::vector<int> modules;
+   if (id == message::Id::Broadcast)
+      modules = getRunning();
+   else
+      modules.push_back(id);
+   for (int mod: modules)
+      setIntParam(mod, "_trace", onoff, false);
+}
+
+static bool mergeTraces(const std::vector<std::string> &files, const std::string &filename) {
+
+   return Profiler::mergeTraces(files, filename);
+}
+
 static void setFloatParam(int id, const char *name, Float value, bool delayed) {
 
 #ifdef DEBUG
@@ -1084,6 +1106,10 @@ PY_MODULE(_vistle, m) {
           "id"_a, "data"_a="p");
     m.def("trace", trace, "enable/disable message tracing for module `id`",
           "id"_a=message::Id::Broadcast, "type"_a=message::ANY, "enable"_a=true);
+    m.def("profile", profile, "enable/disable writing of a Chrome trace per execution for module `id`",
+          "id"_a=message::Id::Broadcast, "enable"_a=true);
+    m.def("mergeTraces", mergeTraces, "combine trace files written by modules and managers into `output`",
+          "files"_a, "output"_a);
     m.def("barrier", barrier, "wait until all modules reply");
     m.def("requestTunnel", requestTunnel, "start TCP tunnel listening on port `arg1` on hub forwarding incoming connections to `arg2`:`arg3`",
           "listen port"_a, "dest port"_a, "dest addr"_a);
@@ -0,0 +1,119 @@
+#include "contenthash.h"
+
+#include <cstring>
+
+namespace vistle {
+
+namespace {
+
+const uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+const uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t Prime3 = 0x165667B19E3779F9ULL;
+const uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(uint64_t x, int r) {
+   return (x << r) | (x >> (64-r));
+}
+
+inline uint64_t read64(const unsigned char *p) {
+   uint64_t v;
+   memcpy(&v, p, sizeof(v));
+   return v;
+}
+
+inline uint32_t read32(const unsigned char *p) {
+   uint32_t v;
+   memcpy(&v, p, sizeof(v));
+   return v;
+}
+
+inline uint64_t round(uint64_t acc, uint64_t input) {
+   acc += input * Prime2;
+   acc = rotl(acc, 31);
+   acc *= Prime1;
+   return acc;
+}
+
+inline uint64_t mergeRound(uint64_t acc, uint64_t val) {
+   val = round(0, val);
+   acc ^= val;
+   acc = acc * Prime1 + Prime4;
+   return acc;
+}
+
+} // anonymous namespace
+
+uint64_t contentHash(const void *data, size_t length, uint64_t seed) {
+
+   const unsigned char *p = static_cast<const unsigned char *>(data);
+   const unsigned char *end = p + length;
+   uint64_t h = 0;
+
+   if (length >= 32) {
+      const unsigned char *limit = end - 32;
+      uint64_t v1 = seed + Prime1 + Prime2;
+      uint64_t v2 = seed + Prime2;
+      uint64_t v3 = seed;
+      uint64_t v4 = seed - Prime1;
+      do {
+         v1 = round(v1, read64(p));
+         v2 = round(v2, read64(p+8));
+         v3 = round(v3, read64(p+16));
+         v4 = round(v4, read64(p+24));
+         p += 32;
+      } while (p <= limit);
+
+      h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+      h = mergeRound(h, v1);
+      h = mergeRound(h, v2);
+      h = mergeRound(h, v3);
+      h = mergeRound(h, v4);
+   } else {
+      h = seed + Prime5;
+   }
+
+   h += uint64_t(length);
+
+   while (p+8 <= end) {
+      h ^= round(0, read64(p));
+      h = rotl(h, 27) * Prime1 + Prime4;
+      p += 8;
+   }
+   if (p+4 <= end) {
+      h ^= uint64_t(read32(p)) * Prime1;
+      h = rotl(h, 23) * Prime2 + Prime3;
+      p += 4;
+   }
+   while (p < end) {
+      h ^= uint64_t(*p) * Prime5;
+      h = rotl(h, 11) * Prime1;
+      ++p;
+   }
+
+   h ^= h >> 33;
+   h *= Prime2;
+   h ^= h >> 29;
+   h *= Prime3;
+   h ^= h >> 32;
+
+   return h;
+}
+
+ContentHasher::ContentHasher(uint64_t seed)
+: m_hash(seed)
+{
+}
+
+ContentHasher &ContentHasher::add(const void *data, size_t length) {
+
+   m_hash = contentHash(data, length, m_hash);
+   return *this;
+}
+
+uint64_t ContentHasher::hash() const {
+
+   return m_hash;
+}
+
+} // namespace vistle
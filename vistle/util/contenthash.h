@@ -0,0 +1,28 @@
+#ifndef VISTLE_UTIL_CONTENTHASH_H
+#define VISTLE_UTIL_CONTENTHASH_H
+
+#include "export.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+namespace vistle {
+
+//! fast non-cryptographic 64 bit hash of a memory block (xxHash64 algorithm)
+V_UTILEXPORT uint64_t contentHash(const void *data, size_t length, uint64_t seed=0);
+
+//! incrementally hash several memory blocks
+class V_UTILEXPORT ContentHasher {
+ public:
+   ContentHasher(uint64_t seed=0);
+   ContentHasher &add(const void *data, size_t length);
+   template<typename T>
+   ContentHasher &add(const T &value) { return add(&value, sizeof(value)); }
+   uint64_t hash() const;
+
+ private:
+   uint64_t m_hash;
+};
+
+} // namespace vistle
+#endif